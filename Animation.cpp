@@ -0,0 +1,214 @@
+#include <algorithm>
+#include <cmath>
+
+#include "Animation.h"
+
+namespace procgui
+{
+    using namespace drawing;
+
+    namespace
+    {
+        bool operator==(const DrawingParameters& lhs, const DrawingParameters& rhs)
+        {
+            return lhs.starting_position == rhs.starting_position &&
+                   lhs.starting_angle == rhs.starting_angle &&
+                   lhs.delta_angle == rhs.delta_angle &&
+                   lhs.step == rhs.step &&
+                   lhs.n_iter == rhs.n_iter;
+        }
+    }
+
+    void Animation::set_view(LSystemView* view)
+    {
+        if (view != view_)
+        {
+            stop();
+            view_ = view;
+        }
+    }
+
+    LSystemView* Animation::get_view() const
+    {
+        return view_;
+    }
+
+    void Animation::add_keyframe(const Keyframe& keyframe)
+    {
+        auto it = std::upper_bound(keyframes_.begin(), keyframes_.end(), keyframe,
+                                   [](const Keyframe& a, const Keyframe& b)
+                                   { return a.time < b.time; });
+        keyframes_.insert(it, keyframe);
+    }
+
+    void Animation::remove_keyframe(std::size_t i)
+    {
+        Expects(i < keyframes_.size());
+        keyframes_.erase(keyframes_.begin() + i);
+        if (keyframes_.empty())
+        {
+            stop();
+        }
+    }
+
+    const std::vector<Keyframe>& Animation::get_keyframes() const
+    {
+        return keyframes_;
+    }
+
+    void Animation::set_target_frame_time(double seconds)
+    {
+        Expects(seconds > 0);
+        target_frame_time_ = seconds;
+    }
+
+    double Animation::get_target_frame_time() const
+    {
+        return target_frame_time_;
+    }
+
+    void Animation::play()
+    {
+        if (!view_ || keyframes_.empty())
+        {
+            return;
+        }
+
+        if (!is_playing_)
+        {
+            base_parameters_ = view_->get_parameters();
+            base_pixel_error_ = view_->get_max_pixel_error();
+        }
+        max_pixel_error_ = base_pixel_error_;
+        n_iter_reduction_ = 0;
+        slow_frames_ = 0;
+        fast_frames_ = 0;
+        degradations_.clear();
+        time_ = 0.f;
+        is_playing_ = true;
+    }
+
+    void Animation::stop()
+    {
+        if (is_playing_)
+        {
+            view_->set_max_pixel_error(base_pixel_error_);
+            if (!(view_->get_parameters() == base_parameters_))
+            {
+                view_->get_parameters() = base_parameters_;
+                view_->request_vertices();
+            }
+            is_playing_ = false;
+        }
+    }
+
+    bool Animation::is_playing() const
+    {
+        return is_playing_;
+    }
+
+    void Animation::update(float delta_time, double draw_time)
+    {
+        if (!is_playing_)
+        {
+            return;
+        }
+
+        float duration = keyframes_.back().time;
+        time_ = duration > 0 ? std::fmod(time_ + delta_time, duration) : 0.f;
+
+        auto parameters = interpolate(keyframes_, time_);
+        parameters.n_iter = std::max(0, parameters.n_iter - n_iter_reduction_);
+
+        // The vertices are only computed if the parameters changed, for
+        // example not between two identical keyframes, and if the previous
+        // computation is applied. No preview is requested: it would flicker
+        // between the frames.
+        double compute_time = 0;
+        if (!(parameters == view_->get_parameters()))
+        {
+            if (!view_->is_computing())
+            {
+                view_->get_parameters() = parameters;
+                view_->request_vertices(false);
+            }
+            compute_time = view_->get_compute_time();
+        }
+        view_->set_max_pixel_error(max_pixel_error_);
+
+        // Adapt the quality to the cost of the frame. Isolated slow or fast
+        // frames are ignored.
+        double cost = compute_time + draw_time;
+        if (cost > target_frame_time_)
+        {
+            fast_frames_ = 0;
+            if (++slow_frames_ >= FRAMES_BEFORE_DEGRADING)
+            {
+                degrade(cost);
+                slow_frames_ = 0;
+            }
+        }
+        else if (cost < target_frame_time_ / 2)
+        {
+            slow_frames_ = 0;
+            if (++fast_frames_ >= FRAMES_BEFORE_RESTORING)
+            {
+                restore(cost);
+                fast_frames_ = 0;
+            }
+        }
+        else
+        {
+            slow_frames_ = 0;
+            fast_frames_ = 0;
+        }
+    }
+
+    const std::vector<Animation::Degradation>& Animation::get_degradations() const
+    {
+        return degradations_;
+    }
+
+    void Animation::degrade(double cost)
+    {
+        // Coarser levels of detail only make the drawing cheaper, so they are
+        // tried before the iterations which also make the computation
+        // cheaper, but change the drawing.
+        int max_n_iter = std::max_element(keyframes_.begin(), keyframes_.end(),
+                                          [](const Keyframe& a, const Keyframe& b)
+                                          { return a.parameters.n_iter < b.parameters.n_iter; })
+                         ->parameters.n_iter;
+        if (max_pixel_error_ < base_pixel_error_ * MAX_PIXEL_ERROR_FACTOR)
+        {
+            max_pixel_error_ *= 2;
+        }
+        else if (n_iter_reduction_ < max_n_iter)
+        {
+            ++n_iter_reduction_;
+        }
+        else
+        {
+            // Nothing left to degrade.
+            return;
+        }
+        degradations_.push_back({time_, n_iter_reduction_, max_pixel_error_, cost});
+    }
+
+    void Animation::restore(double cost)
+    {
+        if (n_iter_reduction_ > 0)
+        {
+            --n_iter_reduction_;
+        }
+        else if (max_pixel_error_ > base_pixel_error_)
+        {
+            max_pixel_error_ /= 2;
+        }
+        else
+        {
+            // Nothing left to restore.
+            return;
+        }
+        degradations_.push_back({time_, n_iter_reduction_, max_pixel_error_, cost});
+    }
+}
@@ -0,0 +1,121 @@
+#ifndef ANIMATION_H
+#define ANIMATION_H
+
+
+#include <vector>
+
+#include "DrawingParameters.h"
+#include "LSystemView.h"
+
+namespace procgui
+{
+    // An Animation plays keyframes of DrawingParameters on a LSystemView: at
+    // each frame, the parameters of the View are interpolated (see
+    // 'drawing::interpolate()') and its vertices are requested to the shared
+    // 'ThreadPool', from the cached production of its LSystem. While a
+    // computation runs, the View keeps drawing its last vertices and the
+    // intermediate parameters are skipped: the frames never wait for the
+    // index or the levels of detail to be rebuilt.
+    //
+    // To hold the target frame time, the Animation measures its own cost: the
+    // drawing of the View plus the computation of its last vertices, as the
+    // drawing is refreshed at most once per computation. When the
+    // cost exceeds the target for several frames, the Animation degrades the
+    // drawing: first by drawing coarser levels of detail, then by lowering
+    // the number of iterations. When the cost stays far under the target, the
+    // degradations are undone in the reverse order. Each change of quality is
+    // recorded.
+    //
+    // Note: the Animation does not own its View. It must stay valid while it
+    // is set.
+    class Animation
+    {
+    public:
+        // A change of the quality of the Animation.
+        struct Degradation
+        {
+            // The time of the Animation when the quality changed.
+            float time;
+
+            // The number of iterations removed from the keyframes, and the
+            // maximum error in pixels of the levels of detail, after the
+            // change.
+            int n_iter_reduction;
+            float max_pixel_error;
+
+            // The cost of the frame that triggered the change, in seconds.
+            double cost;
+        };
+
+        Animation() = default;
+
+        // Set the View to animate. Stop the current animation if any.
+        void set_view(LSystemView* view);
+        LSystemView* get_view() const;
+
+        // Add a keyframe, keeping the keyframes sorted by time.
+        void add_keyframe(const drawing::Keyframe& keyframe);
+        // Exception:
+        //   - Precondition: 'i' is the index of a keyframe.
+        void remove_keyframe(std::size_t i);
+        const std::vector<drawing::Keyframe>& get_keyframes() const;
+
+        // Set the maximum cost of a frame, in seconds.
+        // Exception:
+        //   - Precondition: 'seconds' is positive.
+        void set_target_frame_time(double seconds);
+        double get_target_frame_time() const;
+
+        // Play the keyframes from the beginning, in loop. Do nothing if there
+        // is no View or no keyframe.
+        void play();
+
+        // Stop the animation, restore the DrawingParameters and the quality
+        // the View had before 'play()', and request its vertices.
+        void stop();
+        bool is_playing() const;
+
+        // Advance the animation of 'delta_time' seconds and request the
+        // vertices of the View. 'draw_time' is the time spent drawing the
+        // View during the last frame, in seconds.
+        void update(float delta_time, double draw_time);
+
+        // Get the changes of quality since the last 'play()'.
+        const std::vector<Degradation>& get_degradations() const;
+
+    private:
+        // Lower or restore the quality by one level.
+        void degrade(double cost);
+        void restore(double cost);
+
+        // The number of consecutive frames over the target before degrading
+        // the quality, and under half the target before restoring it.
+        static constexpr int FRAMES_BEFORE_DEGRADING = 3;
+        static constexpr int FRAMES_BEFORE_RESTORING = 60;
+
+        // The coarsest levels of detail drawn, as a multiple of the maximum
+        // pixel error of the View.
+        static constexpr float MAX_PIXEL_ERROR_FACTOR = 8.f;
+
+        LSystemView* view_ { nullptr };
+        std::vector<drawing::Keyframe> keyframes_ { };
+        double target_frame_time_ { 1. / 60. };
+
+        bool is_playing_ { false };
+        float time_ { 0.f };
+
+        // The DrawingParameters of the View before 'play()'.
+        drawing::DrawingParameters base_parameters_ { };
+
+        // The quality of the animation.
+        float base_pixel_error_ { 0.f };
+        float max_pixel_error_ { 0.f };
+        int n_iter_reduction_ { 0 };
+        int slow_frames_ { 0 };
+        int fast_frames_ { 0 };
+        std::vector<Degradation> degradations_ { };
+    };
+}
+
+
+#endif // ANIMATION_H
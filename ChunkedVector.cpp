@@ -0,0 +1,116 @@
+#include <cstdlib>
+#include <limits>
+#include <new>
+
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include "ChunkedVector.h"
+
+std::atomic<std::size_t> ChunkStorage::ram_budget_ {std::numeric_limits<std::size_t>::max()};
+std::atomic<std::size_t> ChunkStorage::ram_usage_ {0};
+std::atomic<std::size_t> ChunkStorage::mapped_usage_ {0};
+std::mutex ChunkStorage::spill_mutex_ {};
+std::string ChunkStorage::spill_directory_ {};
+
+void ChunkStorage::set_ram_budget(std::size_t bytes)
+{
+    ram_budget_ = bytes;
+}
+
+std::size_t ChunkStorage::get_ram_budget()
+{
+    return ram_budget_;
+}
+
+void ChunkStorage::set_spill_directory(const std::string& directory)
+{
+    std::lock_guard<std::mutex> lock (spill_mutex_);
+    spill_directory_ = directory;
+}
+
+std::string ChunkStorage::get_spill_directory()
+{
+    std::lock_guard<std::mutex> lock (spill_mutex_);
+    return spill_directory_;
+}
+
+std::size_t ChunkStorage::get_ram_usage()
+{
+    return ram_usage_;
+}
+
+std::size_t ChunkStorage::get_mapped_usage()
+{
+    return mapped_usage_;
+}
+
+ChunkStorage::Block ChunkStorage::allocate(std::size_t bytes)
+{
+    // Reserve the bytes in the budget first, so concurrent allocations can
+    // not exceed it together.
+    std::size_t usage = ram_usage_.fetch_add(bytes) + bytes;
+    if (usage > ram_budget_)
+    {
+        ram_usage_ -= bytes;
+        return allocate_mapped(bytes);
+    }
+
+    void* data = std::malloc(bytes);
+    if (!data)
+    {
+        ram_usage_ -= bytes;
+        throw std::bad_alloc();
+    }
+    return { data, bytes, false };
+}
+
+ChunkStorage::Block ChunkStorage::allocate_mapped(std::size_t bytes)
+{
+    std::string directory = get_spill_directory();
+
+    void* data = MAP_FAILED;
+    if (directory.empty())
+    {
+        data = mmap(nullptr, bytes, PROT_READ | PROT_WRITE,
+                    MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    }
+    else
+    {
+        // The file is unlinked right away: it disappears with the map, even
+        // if the process crashes.
+        std::string path = directory + "/procgen-chunk-XXXXXX";
+        int fd = mkstemp(&path[0]);
+        if (fd < 0)
+        {
+            throw std::bad_alloc();
+        }
+        unlink(path.c_str());
+        if (ftruncate(fd, bytes) == 0)
+        {
+            data = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        }
+        close(fd);
+    }
+
+    if (data == MAP_FAILED)
+    {
+        throw std::bad_alloc();
+    }
+    mapped_usage_ += bytes;
+    return { data, bytes, true };
+}
+
+void ChunkStorage::deallocate(const Block& block)
+{
+    if (block.is_mapped)
+    {
+        munmap(block.data, block.bytes);
+        mapped_usage_ -= block.bytes;
+    }
+    else
+    {
+        std::free(block.data);
+        ram_usage_ -= block.bytes;
+    }
+}
@@ -0,0 +1,280 @@
+#ifndef CHUNKED_VECTOR_H
+#define CHUNKED_VECTOR_H
+
+
+#include <atomic>
+#include <iterator>
+#include <mutex>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#include <gsl/gsl>
+
+// ChunkStorage allocates the chunks of all the ChunkedVectors of the process.
+// While the memory allocated stays under the RAM budget, the chunks are
+// allocated on the heap. Past the budget, the chunks are spilled to memory
+// maps: anonymous ones by default, or backed by temporary files in the spill
+// directory, so the kernel can write them back to the disk under memory
+// pressure.
+//
+// All the functions can be called from any thread.
+class ChunkStorage
+{
+public:
+    // A block of memory allocated by 'allocate()'.
+    struct Block
+    {
+        void* data;
+        std::size_t bytes;
+        bool is_mapped;
+    };
+
+    // Set the maximum number of bytes of chunks allocated on the heap. By
+    // default, it is unlimited.
+    static void set_ram_budget(std::size_t bytes);
+    static std::size_t get_ram_budget();
+
+    // Set the directory of the files backing the spilled chunks. An empty
+    // 'directory' (the default) spills the chunks to anonymous maps.
+    static void set_spill_directory(const std::string& directory);
+    static std::string get_spill_directory();
+
+    // Get the number of bytes currently allocated on the heap and in memory
+    // maps.
+    static std::size_t get_ram_usage();
+    static std::size_t get_mapped_usage();
+
+    // Allocate a block of 'bytes' bytes.
+    // Exception:
+    //   - Throws 'std::bad_alloc' if the block can not be allocated.
+    static Block allocate(std::size_t bytes);
+
+    // Free a block allocated by 'allocate()'.
+    static void deallocate(const Block& block);
+
+private:
+    static Block allocate_mapped(std::size_t bytes);
+
+    static std::atomic<std::size_t> ram_budget_;
+    static std::atomic<std::size_t> ram_usage_;
+    static std::atomic<std::size_t> mapped_usage_;
+    static std::mutex spill_mutex_;
+    static std::string spill_directory_;
+};
+
+
+// A ChunkedVector is a sequence container of trivially copyable elements,
+// stored in fixed-size chunks that are never relocated: the addresses of the
+// elements are stable, and the container never has the peak memory and copy
+// of a 'std::vector' reallocation. It is made to store huge drawings.
+//
+// The size of the chunks doubles from 'first_chunk_size' to
+// 'max_chunk_size' elements (rounded up to powers of two), so small
+// containers stay small. The chunks are allocated by 'ChunkStorage' and can
+// be spilled to memory maps.
+//
+// The elements can be accessed by index, or more efficiently chunk by chunk
+// with 'chunks()', which iterates over contiguous arrays: the hot loops
+// iterate over the chunks, and the random accesses keep the chunk of their
+// last element with 'chunk_of()'.
+template<typename T>
+class ChunkedVector
+{
+    static_assert(std::is_trivially_copyable<T>::value,
+                  "ChunkedVector only supports trivially copyable types");
+
+public:
+    using value_type = T;
+    using size_type = std::size_t;
+
+    // A contiguous part of the elements: 'size' elements starting at 'data',
+    // the first one being at the index 'offset' of the container.
+    struct Chunk
+    {
+        const T* data;
+        std::size_t size;
+        std::size_t offset;
+
+        const T* begin() const { return data; }
+        const T* end() const { return data + size; }
+    };
+
+    // Iterate over the chunks of a ChunkedVector.
+    class chunk_iterator
+    {
+    public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = Chunk;
+        using difference_type = std::ptrdiff_t;
+        using pointer = const Chunk*;
+        using reference = Chunk;
+
+        // Iterate from the chunk 'index', the chunks being clipped to the
+        // elements [first, last).
+        chunk_iterator(const ChunkedVector& container, std::size_t index,
+                       std::size_t first, std::size_t last);
+        Chunk operator*() const;
+        chunk_iterator& operator++();
+        chunk_iterator operator++(int);
+        bool operator==(const chunk_iterator& other) const;
+        bool operator!=(const chunk_iterator& other) const;
+    private:
+        const ChunkedVector* container_;
+        std::size_t index_;
+        std::size_t first_;
+        std::size_t last_;
+    };
+
+    // The range of the chunks, for range-based for loops.
+    struct ChunkRange
+    {
+        chunk_iterator first;
+        chunk_iterator last;
+        chunk_iterator begin() const { return first; }
+        chunk_iterator end() const { return last; }
+    };
+
+    // Iterate over the elements of a ChunkedVector.
+    class const_iterator
+    {
+    public:
+        using iterator_category = std::random_access_iterator_tag;
+        using value_type = T;
+        using difference_type = std::ptrdiff_t;
+        using pointer = const T*;
+        using reference = const T&;
+
+        const_iterator() = default;
+        const_iterator(const ChunkedVector& container, std::size_t index);
+        const T& operator*() const;
+        const T* operator->() const;
+        const T& operator[](std::ptrdiff_t n) const;
+        const_iterator& operator++();
+        const_iterator operator++(int);
+        const_iterator& operator--();
+        const_iterator operator--(int);
+        const_iterator& operator+=(std::ptrdiff_t n);
+        const_iterator& operator-=(std::ptrdiff_t n);
+        const_iterator operator+(std::ptrdiff_t n) const;
+        const_iterator operator-(std::ptrdiff_t n) const;
+        std::ptrdiff_t operator-(const const_iterator& other) const;
+        bool operator==(const const_iterator& other) const;
+        bool operator!=(const const_iterator& other) const;
+        bool operator<(const const_iterator& other) const;
+        bool operator>(const const_iterator& other) const;
+        bool operator<=(const const_iterator& other) const;
+        bool operator>=(const const_iterator& other) const;
+    private:
+        const ChunkedVector* container_ { nullptr };
+        std::size_t index_ { 0 };
+    };
+
+    // The default sizes of the chunks, in bytes.
+    static constexpr std::size_t default_first_chunk_bytes = 4 * 1024;
+    static constexpr std::size_t default_max_chunk_bytes = 1024 * 1024;
+
+    ChunkedVector();
+    ChunkedVector(std::size_t first_chunk_size, std::size_t max_chunk_size);
+    ChunkedVector(std::initializer_list<T> init);
+    ChunkedVector(const ChunkedVector& other);
+    ChunkedVector(ChunkedVector&& other);
+    ChunkedVector& operator=(const ChunkedVector& other);
+    ChunkedVector& operator=(ChunkedVector&& other);
+    ~ChunkedVector();
+
+    // --- Capacity ---
+    std::size_t size() const;
+    bool empty() const;
+
+    // Get the number of elements a chunk can contain.
+    std::size_t chunk_capacity(std::size_t chunk) const;
+
+    // Get the number of bytes allocated by the container: its chunks, on the
+    // heap or mapped, and their list.
+    std::size_t memory_usage() const;
+
+    // --- Element access ---
+    // Note: as for 'std::vector', the index is not checked.
+    T& operator[](std::size_t i);
+    const T& operator[](std::size_t i) const;
+
+    // Exception:
+    //   - Throws 'std::out_of_range' if 'i' is not lower than 'size()'.
+    T& at(std::size_t i);
+    const T& at(std::size_t i) const;
+
+    // Exception:
+    //   - Precondition: the container is not empty.
+    T& back();
+    const T& back() const;
+
+    // --- Iteration ---
+    const_iterator begin() const;
+    const_iterator end() const;
+    ChunkRange chunks() const;
+
+    // Get the chunks of the elements [first, last), the first and last
+    // chunks being clipped to them.
+    // Exception:
+    //   - Precondition: 'first <= last <= size()'.
+    ChunkRange chunks(std::size_t first, std::size_t last) const;
+
+    // Get the whole chunk containing the element 'i'.
+    // Exception:
+    //   - Precondition: 'i' is lower than 'size()'.
+    Chunk chunk_of(std::size_t i) const;
+
+    // --- Modifiers ---
+    // Add 'value' at the end, allocating a new chunk if necessary. The
+    // elements already in the container never move.
+    void push_back(const T& value);
+
+    // Exception:
+    //   - Precondition: the container is not empty.
+    void pop_back();
+
+    // Remove all the elements and free all the chunks.
+    void clear();
+
+private:
+    // The index of the most significant bit of 'n', and the exponent of the
+    // smallest power of two greater or equal to 'n'. 'n' must not be 0.
+    static unsigned floor_log2(std::size_t n);
+    static unsigned ceil_log2(std::size_t n);
+
+    // Compute the chunk of the element 'i' and its index in the chunk.
+    std::pair<std::size_t, std::size_t> locate(std::size_t i) const;
+
+    // Compute the index of the first element of a chunk.
+    std::size_t chunk_offset(std::size_t chunk) const;
+
+    // The number of chunks whose size doubles, and their total capacity.
+    std::size_t growing_chunks() const;
+    std::size_t growing_capacity() const;
+
+    // Free all the chunks.
+    void release();
+
+    // Copy the chunks of 'other'.
+    void copy_from(const ChunkedVector& other);
+
+    // The chunks, each one of 'chunk_capacity(i)' elements.
+    std::vector<ChunkStorage::Block> chunks_;
+
+    std::size_t size_;
+    std::size_t capacity_;
+
+    // The sizes of the chunks, as powers of two.
+    unsigned first_shift_;
+    unsigned max_shift_;
+};
+
+template<typename T>
+bool operator==(const ChunkedVector<T>& lhs, const ChunkedVector<T>& rhs);
+template<typename T>
+bool operator!=(const ChunkedVector<T>& lhs, const ChunkedVector<T>& rhs);
+
+#include "ChunkedVector.tpp"
+
+#endif // CHUNKED_VECTOR_H
@@ -0,0 +1,515 @@
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+template<typename T>
+unsigned ChunkedVector<T>::floor_log2(std::size_t n)
+{
+#if defined(__GNUC__)
+    return (sizeof(unsigned long long) * 8 - 1) - __builtin_clzll(n);
+#else
+    unsigned log = 0;
+    while (n >>= 1)
+    {
+        ++log;
+    }
+    return log;
+#endif
+}
+
+template<typename T>
+unsigned ChunkedVector<T>::ceil_log2(std::size_t n)
+{
+    unsigned log = floor_log2(n);
+    return (std::size_t(1) << log) < n ? log + 1 : log;
+}
+
+template<typename T>
+constexpr std::size_t ChunkedVector<T>::default_first_chunk_bytes;
+template<typename T>
+constexpr std::size_t ChunkedVector<T>::default_max_chunk_bytes;
+
+
+// --- chunk_iterator ---
+template<typename T>
+ChunkedVector<T>::chunk_iterator::chunk_iterator(const ChunkedVector& container, std::size_t index,
+                                                 std::size_t first, std::size_t last)
+    : container_ {&container}
+    , index_ {index}
+    , first_ {first}
+    , last_ {last}
+{
+}
+
+template<typename T>
+typename ChunkedVector<T>::Chunk ChunkedVector<T>::chunk_iterator::operator*() const
+{
+    std::size_t offset = container_->chunk_offset(index_);
+    std::size_t first = std::max(offset, first_);
+    std::size_t last = std::min(offset + container_->chunk_capacity(index_), last_);
+    return { static_cast<const T*>(container_->chunks_[index_].data) + (first - offset), last - first, first };
+}
+
+template<typename T>
+typename ChunkedVector<T>::chunk_iterator& ChunkedVector<T>::chunk_iterator::operator++()
+{
+    ++index_;
+    return *this;
+}
+
+template<typename T>
+typename ChunkedVector<T>::chunk_iterator ChunkedVector<T>::chunk_iterator::operator++(int)
+{
+    auto copy = *this;
+    ++index_;
+    return copy;
+}
+
+template<typename T>
+bool ChunkedVector<T>::chunk_iterator::operator==(const chunk_iterator& other) const
+{
+    return container_ == other.container_ && index_ == other.index_;
+}
+
+template<typename T>
+bool ChunkedVector<T>::chunk_iterator::operator!=(const chunk_iterator& other) const
+{
+    return !(*this == other);
+}
+
+
+// --- const_iterator ---
+template<typename T>
+ChunkedVector<T>::const_iterator::const_iterator(const ChunkedVector& container, std::size_t index)
+    : container_ {&container}
+    , index_ {index}
+{
+}
+
+template<typename T>
+const T& ChunkedVector<T>::const_iterator::operator*() const
+{
+    return (*container_)[index_];
+}
+
+template<typename T>
+const T* ChunkedVector<T>::const_iterator::operator->() const
+{
+    return &(*container_)[index_];
+}
+
+template<typename T>
+const T& ChunkedVector<T>::const_iterator::operator[](std::ptrdiff_t n) const
+{
+    return (*container_)[index_ + n];
+}
+
+template<typename T>
+typename ChunkedVector<T>::const_iterator& ChunkedVector<T>::const_iterator::operator++()
+{
+    ++index_;
+    return *this;
+}
+
+template<typename T>
+typename ChunkedVector<T>::const_iterator ChunkedVector<T>::const_iterator::operator++(int)
+{
+    auto copy = *this;
+    ++index_;
+    return copy;
+}
+
+template<typename T>
+typename ChunkedVector<T>::const_iterator& ChunkedVector<T>::const_iterator::operator--()
+{
+    --index_;
+    return *this;
+}
+
+template<typename T>
+typename ChunkedVector<T>::const_iterator ChunkedVector<T>::const_iterator::operator--(int)
+{
+    auto copy = *this;
+    --index_;
+    return copy;
+}
+
+template<typename T>
+typename ChunkedVector<T>::const_iterator& ChunkedVector<T>::const_iterator::operator+=(std::ptrdiff_t n)
+{
+    index_ += n;
+    return *this;
+}
+
+template<typename T>
+typename ChunkedVector<T>::const_iterator& ChunkedVector<T>::const_iterator::operator-=(std::ptrdiff_t n)
+{
+    index_ -= n;
+    return *this;
+}
+
+template<typename T>
+typename ChunkedVector<T>::const_iterator ChunkedVector<T>::const_iterator::operator+(std::ptrdiff_t n) const
+{
+    return const_iterator(*container_, index_ + n);
+}
+
+template<typename T>
+typename ChunkedVector<T>::const_iterator ChunkedVector<T>::const_iterator::operator-(std::ptrdiff_t n) const
+{
+    return const_iterator(*container_, index_ - n);
+}
+
+template<typename T>
+std::ptrdiff_t ChunkedVector<T>::const_iterator::operator-(const const_iterator& other) const
+{
+    return static_cast<std::ptrdiff_t>(index_) - static_cast<std::ptrdiff_t>(other.index_);
+}
+
+template<typename T>
+bool ChunkedVector<T>::const_iterator::operator==(const const_iterator& other) const
+{
+    return container_ == other.container_ && index_ == other.index_;
+}
+
+template<typename T>
+bool ChunkedVector<T>::const_iterator::operator!=(const const_iterator& other) const
+{
+    return !(*this == other);
+}
+
+template<typename T>
+bool ChunkedVector<T>::const_iterator::operator<(const const_iterator& other) const
+{
+    return index_ < other.index_;
+}
+
+template<typename T>
+bool ChunkedVector<T>::const_iterator::operator>(const const_iterator& other) const
+{
+    return index_ > other.index_;
+}
+
+template<typename T>
+bool ChunkedVector<T>::const_iterator::operator<=(const const_iterator& other) const
+{
+    return index_ <= other.index_;
+}
+
+template<typename T>
+bool ChunkedVector<T>::const_iterator::operator>=(const const_iterator& other) const
+{
+    return index_ >= other.index_;
+}
+
+
+// --- ChunkedVector ---
+template<typename T>
+ChunkedVector<T>::ChunkedVector()
+    : ChunkedVector(std::max<std::size_t>(1, default_first_chunk_bytes / sizeof(T)),
+                    std::max<std::size_t>(1, default_max_chunk_bytes / sizeof(T)))
+{
+}
+
+template<typename T>
+ChunkedVector<T>::ChunkedVector(std::size_t first_chunk_size, std::size_t max_chunk_size)
+    : chunks_ {}
+    , size_ {0}
+    , capacity_ {0}
+    , first_shift_ {0}
+    , max_shift_ {0}
+{
+    Expects(first_chunk_size > 0 && first_chunk_size <= max_chunk_size);
+    first_shift_ = ceil_log2(first_chunk_size);
+    max_shift_ = ceil_log2(max_chunk_size);
+}
+
+template<typename T>
+ChunkedVector<T>::ChunkedVector(std::initializer_list<T> init)
+    : ChunkedVector()
+{
+    for (const auto& value : init)
+    {
+        push_back(value);
+    }
+}
+
+template<typename T>
+ChunkedVector<T>::ChunkedVector(const ChunkedVector& other)
+    : chunks_ {}
+    , size_ {0}
+    , capacity_ {0}
+    , first_shift_ {other.first_shift_}
+    , max_shift_ {other.max_shift_}
+{
+    copy_from(other);
+}
+
+template<typename T>
+ChunkedVector<T>::ChunkedVector(ChunkedVector&& other)
+    : chunks_ {std::move(other.chunks_)}
+    , size_ {other.size_}
+    , capacity_ {other.capacity_}
+    , first_shift_ {other.first_shift_}
+    , max_shift_ {other.max_shift_}
+{
+    other.chunks_.clear();
+    other.size_ = 0;
+    other.capacity_ = 0;
+}
+
+template<typename T>
+ChunkedVector<T>& ChunkedVector<T>::operator=(const ChunkedVector& other)
+{
+    if (this != &other)
+    {
+        release();
+        first_shift_ = other.first_shift_;
+        max_shift_ = other.max_shift_;
+        copy_from(other);
+    }
+    return *this;
+}
+
+template<typename T>
+ChunkedVector<T>& ChunkedVector<T>::operator=(ChunkedVector&& other)
+{
+    if (this != &other)
+    {
+        release();
+        chunks_ = std::move(other.chunks_);
+        size_ = other.size_;
+        capacity_ = other.capacity_;
+        first_shift_ = other.first_shift_;
+        max_shift_ = other.max_shift_;
+        other.chunks_.clear();
+        other.size_ = 0;
+        other.capacity_ = 0;
+    }
+    return *this;
+}
+
+template<typename T>
+ChunkedVector<T>::~ChunkedVector()
+{
+    release();
+}
+
+template<typename T>
+std::size_t ChunkedVector<T>::size() const
+{
+    return size_;
+}
+
+template<typename T>
+bool ChunkedVector<T>::empty() const
+{
+    return size_ == 0;
+}
+
+template<typename T>
+std::size_t ChunkedVector<T>::memory_usage() const
+{
+    std::size_t bytes = chunks_.capacity() * sizeof(ChunkStorage::Block);
+    for (const auto& block : chunks_)
+    {
+        bytes += block.bytes;
+    }
+    return bytes;
+}
+
+template<typename T>
+std::size_t ChunkedVector<T>::chunk_capacity(std::size_t chunk) const
+{
+    if (chunk < growing_chunks())
+    {
+        return std::size_t(1) << (first_shift_ + chunk);
+    }
+    return std::size_t(1) << max_shift_;
+}
+
+template<typename T>
+T& ChunkedVector<T>::operator[](std::size_t i)
+{
+    auto location = locate(i);
+    return static_cast<T*>(chunks_[location.first].data)[location.second];
+}
+
+template<typename T>
+const T& ChunkedVector<T>::operator[](std::size_t i) const
+{
+    auto location = locate(i);
+    return static_cast<const T*>(chunks_[location.first].data)[location.second];
+}
+
+template<typename T>
+T& ChunkedVector<T>::at(std::size_t i)
+{
+    if (i >= size_)
+    {
+        throw std::out_of_range("ChunkedVector::at");
+    }
+    return (*this)[i];
+}
+
+template<typename T>
+const T& ChunkedVector<T>::at(std::size_t i) const
+{
+    if (i >= size_)
+    {
+        throw std::out_of_range("ChunkedVector::at");
+    }
+    return (*this)[i];
+}
+
+template<typename T>
+T& ChunkedVector<T>::back()
+{
+    Expects(size_ > 0);
+    return (*this)[size_ - 1];
+}
+
+template<typename T>
+const T& ChunkedVector<T>::back() const
+{
+    Expects(size_ > 0);
+    return (*this)[size_ - 1];
+}
+
+template<typename T>
+typename ChunkedVector<T>::const_iterator ChunkedVector<T>::begin() const
+{
+    return const_iterator(*this, 0);
+}
+
+template<typename T>
+typename ChunkedVector<T>::const_iterator ChunkedVector<T>::end() const
+{
+    return const_iterator(*this, size_);
+}
+
+template<typename T>
+typename ChunkedVector<T>::ChunkRange ChunkedVector<T>::chunks() const
+{
+    return chunks(0, size_);
+}
+
+template<typename T>
+typename ChunkedVector<T>::ChunkRange ChunkedVector<T>::chunks(std::size_t first, std::size_t last) const
+{
+    Expects(first <= last && last <= size_);
+    // Only the chunks containing elements are iterated.
+    std::size_t first_chunk = first == last ? 0 : locate(first).first;
+    std::size_t last_chunk = first == last ? 0 : locate(last - 1).first + 1;
+    return { chunk_iterator(*this, first_chunk, first, last), chunk_iterator(*this, last_chunk, first, last) };
+}
+
+template<typename T>
+typename ChunkedVector<T>::Chunk ChunkedVector<T>::chunk_of(std::size_t i) const
+{
+    Expects(i < size_);
+    return *chunk_iterator(*this, locate(i).first, 0, size_);
+}
+
+template<typename T>
+void ChunkedVector<T>::push_back(const T& value)
+{
+    if (size_ == capacity_)
+    {
+        std::size_t capacity = chunk_capacity(chunks_.size());
+        chunks_.push_back(ChunkStorage::allocate(capacity * sizeof(T)));
+        capacity_ += capacity;
+    }
+    (*this)[size_] = value;
+    ++size_;
+}
+
+template<typename T>
+void ChunkedVector<T>::pop_back()
+{
+    Expects(size_ > 0);
+    --size_;
+}
+
+template<typename T>
+void ChunkedVector<T>::clear()
+{
+    release();
+}
+
+template<typename T>
+std::pair<std::size_t, std::size_t> ChunkedVector<T>::locate(std::size_t i) const
+{
+    // In the growing chunks, the chunk 'k' starts at the index
+    // '(2^k - 1) * first_chunk_size'.
+    std::size_t growing = growing_capacity();
+    if (i < growing)
+    {
+        std::size_t chunk = floor_log2((i >> first_shift_) + 1);
+        return { chunk, i - (((std::size_t(1) << chunk) - 1) << first_shift_) };
+    }
+
+    // Then all the chunks have the maximal size.
+    std::size_t j = i - growing;
+    return { growing_chunks() + (j >> max_shift_), j & ((std::size_t(1) << max_shift_) - 1) };
+}
+
+template<typename T>
+std::size_t ChunkedVector<T>::chunk_offset(std::size_t chunk) const
+{
+    if (chunk < growing_chunks())
+    {
+        return ((std::size_t(1) << chunk) - 1) << first_shift_;
+    }
+    return growing_capacity() + ((chunk - growing_chunks()) << max_shift_);
+}
+
+template<typename T>
+std::size_t ChunkedVector<T>::growing_chunks() const
+{
+    return max_shift_ - first_shift_ + 1;
+}
+
+template<typename T>
+std::size_t ChunkedVector<T>::growing_capacity() const
+{
+    return (std::size_t(2) << max_shift_) - (std::size_t(1) << first_shift_);
+}
+
+template<typename T>
+void ChunkedVector<T>::release()
+{
+    for (const auto& chunk : chunks_)
+    {
+        ChunkStorage::deallocate(chunk);
+    }
+    chunks_.clear();
+    size_ = 0;
+    capacity_ = 0;
+}
+
+template<typename T>
+void ChunkedVector<T>::copy_from(const ChunkedVector& other)
+{
+    // Only the chunks containing elements are copied.
+    for (const auto& chunk : other.chunks())
+    {
+        std::size_t capacity = chunk_capacity(chunks_.size());
+        chunks_.push_back(ChunkStorage::allocate(capacity * sizeof(T)));
+        capacity_ += capacity;
+        std::memcpy(chunks_.back().data, chunk.data, chunk.size * sizeof(T));
+        size_ += chunk.size;
+    }
+}
+
+template<typename T>
+bool operator==(const ChunkedVector<T>& lhs, const ChunkedVector<T>& rhs)
+{
+    return lhs.size() == rhs.size() && std::equal(lhs.begin(), lhs.end(), rhs.begin());
+}
+
+template<typename T>
+bool operator!=(const ChunkedVector<T>& lhs, const ChunkedVector<T>& rhs)
+{
+    return !(lhs == rhs);
+}
@@ -0,0 +1,31 @@
+#ifndef COLOR_H
+#define COLOR_H
+
+
+#include <cstdint>
+
+// A color with 8-bit red, green, blue and alpha components, opaque by default.
+//
+// The core (rasterization, export, gallery) uses it instead of 'sf::Color',
+// which is defined in the SFML graphics module: the command-line tools link
+// without any window or graphics library.
+struct Color
+{
+    constexpr Color() = default;
+    constexpr Color(std::uint8_t red, std::uint8_t green, std::uint8_t blue,
+                    std::uint8_t alpha = 255)
+        : r {red}, g {green}, b {blue}, a {alpha}
+    {
+    }
+
+    std::uint8_t r { 0 };
+    std::uint8_t g { 0 };
+    std::uint8_t b { 0 };
+    std::uint8_t a { 255 };
+
+    static constexpr Color black() { return {0, 0, 0}; }
+    static constexpr Color white() { return {255, 255, 255}; }
+};
+
+
+#endif // COLOR_H
@@ -0,0 +1,41 @@
+#include <algorithm>
+#include <cmath>
+
+#include <gsl/gsl>
+
+#include "DrawingParameters.h"
+
+namespace drawing
+{
+    DrawingParameters interpolate(const std::vector<Keyframe>& keyframes, float time)
+    {
+        Expects(!keyframes.empty());
+        Expects(std::is_sorted(keyframes.begin(), keyframes.end(),
+                               [](const Keyframe& a, const Keyframe& b)
+                               { return a.time < b.time; }));
+
+        // The first keyframe after 'time'.
+        auto next = std::upper_bound(keyframes.begin(), keyframes.end(), time,
+                                     [](float t, const Keyframe& k)
+                                     { return t < k.time; });
+        if (next == keyframes.begin())
+        {
+            return keyframes.front().parameters;
+        }
+        if (next == keyframes.end())
+        {
+            return keyframes.back().parameters;
+        }
+
+        const auto& from = std::prev(next)->parameters;
+        const auto& to = next->parameters;
+        float t = (time - std::prev(next)->time) / (next->time - std::prev(next)->time);
+
+        DrawingParameters parameters = from;
+        parameters.starting_position = from.starting_position + t * (to.starting_position - from.starting_position);
+        parameters.starting_angle = from.starting_angle + t * (to.starting_angle - from.starting_angle);
+        parameters.delta_angle = from.delta_angle + t * (to.delta_angle - from.delta_angle);
+        parameters.step = static_cast<int>(std::lround(from.step + t * (to.step - from.step)));
+        return parameters;
+    }
+}
@@ -3,6 +3,8 @@
 
 
 
+#include <vector>
+
 #include <SFML/Graphics.hpp>
 #include <SFML/Window.hpp>
 
@@ -37,6 +39,22 @@ namespace drawing
         // The number of iterations done by the L-system.
         int n_iter { 0 };
     };
+
+    // A Keyframe of an animation: the DrawingParameters at 'time' seconds.
+    struct Keyframe
+    {
+        float time;
+        DrawingParameters parameters;
+    };
+
+    // Compute the DrawingParameters at 'time' seconds of an animation defined
+    // by 'keyframes'. The attributes are linearly interpolated between the
+    // two keyframes around 'time', except 'n_iter' which is the one of the
+    // previous keyframe. Before the first keyframe and after the last one,
+    // the parameters are the ones of these keyframes.
+    // Exception:
+    //   - Precondition: 'keyframes' is not empty and sorted by 'time'.
+    DrawingParameters interpolate(const std::vector<Keyframe>& keyframes, float time);
 }
 
 #endif
@@ -0,0 +1,349 @@
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstring>
+
+#include "gsl/gsl"
+
+#include "Export.h"
+
+namespace exporter
+{
+    constexpr std::size_t BufferedWriter::DEFAULT_CAPACITY;
+
+    BufferedWriter::BufferedWriter(std::ostream& os, std::size_t capacity)
+        : os_ {os}
+        , buffer_(capacity)
+    {
+        Expects(capacity > 0);
+    }
+
+    BufferedWriter::~BufferedWriter()
+    {
+        flush();
+    }
+
+    void BufferedWriter::write(char c)
+    {
+        if (used_ == buffer_.size())
+        {
+            flush();
+        }
+        buffer_[used_++] = c;
+    }
+
+    void BufferedWriter::write(const char* str)
+    {
+        write(str, std::strlen(str));
+    }
+
+    void BufferedWriter::write(const std::string& str)
+    {
+        write(str.data(), str.size());
+    }
+
+    void BufferedWriter::write(const char* str, std::size_t size)
+    {
+        while (size > 0)
+        {
+            if (used_ == buffer_.size())
+            {
+                flush();
+            }
+            auto n = std::min(size, buffer_.size() - used_);
+            std::memcpy(&buffer_[used_], str, n);
+            used_ += n;
+            str += n;
+            size -= n;
+        }
+    }
+
+    void BufferedWriter::write_number(double value, int decimals)
+    {
+        Expects(decimals >= 0 && decimals <= 6);
+
+        // The number is formatted from its rounded integer multiple of
+        // 10^-decimals, much faster than with the streams.
+        long long scale = 1;
+        for (int i = 0; i < decimals; ++i)
+        {
+            scale *= 10;
+        }
+        long long scaled = std::llround(value * scale);
+        if (scaled < 0)
+        {
+            write('-');
+            scaled = -scaled;
+        }
+
+        char digits[32];
+        char* end = digits + sizeof(digits);
+        char* begin = end;
+        long long integer = scaled / scale;
+        do
+        {
+            *--begin = static_cast<char>('0' + integer % 10);
+            integer /= 10;
+        } while (integer > 0);
+
+        long long fraction = scaled % scale;
+        if (fraction > 0)
+        {
+            int n_digits = decimals;
+            while (fraction % 10 == 0)
+            {
+                fraction /= 10;
+                --n_digits;
+            }
+            char fraction_digits[8];
+            for (int i = n_digits - 1; i >= 0; --i)
+            {
+                fraction_digits[i] = static_cast<char>('0' + fraction % 10);
+                fraction /= 10;
+            }
+            write(begin, end - begin);
+            write('.');
+            write(fraction_digits, n_digits);
+        }
+        else
+        {
+            write(begin, end - begin);
+        }
+    }
+
+    void BufferedWriter::flush()
+    {
+        os_.write(buffer_.data(), used_);
+        flushed_ += used_;
+        used_ = 0;
+    }
+
+    std::size_t BufferedWriter::get_size() const
+    {
+        return flushed_ + used_;
+    }
+
+
+    void BoundsSink::move_to(const sf::Vector2f& position)
+    {
+        boxes_.add(position);
+    }
+
+    void BoundsSink::line_to(const sf::Vector2f& position)
+    {
+        boxes_.add(position);
+    }
+
+    sf::FloatRect BoundsSink::get_bounding_box() const
+    {
+        return boxes_.get_bounding_box();
+    }
+
+
+    namespace
+    {
+        // Write 'color' as "#rrggbb".
+        void write_hex_color(BufferedWriter& writer, const Color& color)
+        {
+            const char* digits = "0123456789abcdef";
+            writer.write('#');
+            for (auto component : {color.r, color.g, color.b})
+            {
+                writer.write(digits[component >> 4]);
+                writer.write(digits[component & 0xf]);
+            }
+        }
+    }
+
+    SvgWriter::SvgWriter(std::ostream& os, const sf::FloatRect& view,
+                         const ExportParameters& parameters)
+        : parameters_ {parameters}
+        , writer_ {os}
+    {
+        writer_.write("<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
+                      "<svg xmlns=\"http://www.w3.org/2000/svg\" viewBox=\"");
+        writer_.write_number(view.left, parameters_.decimals);
+        writer_.write(' ');
+        writer_.write_number(view.top, parameters_.decimals);
+        writer_.write(' ');
+        writer_.write_number(view.width, parameters_.decimals);
+        writer_.write(' ');
+        writer_.write_number(view.height, parameters_.decimals);
+        writer_.write("\" width=\"");
+        writer_.write_number(std::ceil(view.width), 0);
+        writer_.write("\" height=\"");
+        writer_.write_number(std::ceil(view.height), 0);
+        writer_.write("\">\n<g fill=\"none\" stroke=\"");
+        write_hex_color(writer_, parameters_.color);
+        if (parameters_.color.a < 255)
+        {
+            writer_.write("\" stroke-opacity=\"");
+            writer_.write_number(parameters_.color.a / 255., 3);
+        }
+        writer_.write("\" stroke-width=\"");
+        writer_.write_number(parameters_.line_width, parameters_.decimals);
+        writer_.write("\" stroke-linecap=\"round\" stroke-linejoin=\"round\">\n");
+    }
+
+    SvgWriter::~SvgWriter()
+    {
+        finish();
+    }
+
+    void SvgWriter::move_to(const sf::Vector2f& position)
+    {
+        if (is_path_open_ && n_commands_ >= parameters_.max_path_commands)
+        {
+            writer_.write("\"/>\n");
+            is_path_open_ = false;
+        }
+        if (!is_path_open_)
+        {
+            writer_.write("<path d=\"");
+            is_path_open_ = true;
+            n_commands_ = 0;
+        }
+        else
+        {
+            writer_.write('\n');
+        }
+        write_position('M', position);
+    }
+
+    void SvgWriter::line_to(const sf::Vector2f& position)
+    {
+        if (n_commands_ >= parameters_.max_path_commands)
+        {
+            // The polyline continues in a new path.
+            move_to(last_);
+        }
+        write_position('L', position);
+    }
+
+    void SvgWriter::write_position(char command, const sf::Vector2f& position)
+    {
+        writer_.write(command);
+        writer_.write_number(position.x, parameters_.decimals);
+        writer_.write(' ');
+        writer_.write_number(position.y, parameters_.decimals);
+        last_ = position;
+        ++n_commands_;
+    }
+
+    void SvgWriter::finish()
+    {
+        if (is_finished_)
+        {
+            return;
+        }
+        if (is_path_open_)
+        {
+            writer_.write("\"/>\n");
+            is_path_open_ = false;
+        }
+        writer_.write("</g>\n</svg>\n");
+        writer_.flush();
+        is_finished_ = true;
+    }
+
+    std::size_t SvgWriter::get_size() const
+    {
+        return writer_.get_size();
+    }
+
+
+    EpsWriter::EpsWriter(std::ostream& os, const ExportParameters& parameters)
+        : parameters_ {parameters}
+        , writer_ {os}
+    {
+        writer_.write("%!PS-Adobe-3.0 EPSF-3.0\n"
+                      "%%Creator: procgen\n"
+                      "%%BoundingBox: (atend)\n"
+                      "%%HiResBoundingBox: (atend)\n"
+                      "%%EndComments\n"
+                      "/m { moveto } bind def\n"
+                      "/l { lineto } bind def\n");
+        writer_.write_number(parameters_.line_width, parameters_.decimals);
+        writer_.write(" setlinewidth 1 setlinecap 1 setlinejoin\n");
+        for (auto component : {parameters_.color.r, parameters_.color.g, parameters_.color.b})
+        {
+            writer_.write_number(component / 255., 3);
+            writer_.write(' ');
+        }
+        writer_.write("setrgbcolor\n");
+    }
+
+    EpsWriter::~EpsWriter()
+    {
+        finish();
+    }
+
+    void EpsWriter::move_to(const sf::Vector2f& position)
+    {
+        write_position(position, " m\n");
+    }
+
+    void EpsWriter::line_to(const sf::Vector2f& position)
+    {
+        if (n_commands_ >= parameters_.max_path_commands)
+        {
+            // The current path is stroked, and the polyline continues in a
+            // new one.
+            writer_.write("stroke\n");
+            n_commands_ = 0;
+            write_position(last_, " m\n");
+        }
+        write_position(position, " l\n");
+    }
+
+    void EpsWriter::write_position(const sf::Vector2f& position, const char* command)
+    {
+        sf::Vector2f flipped {position.x, -position.y};
+        bounds_.line_to(flipped);
+        writer_.write_number(flipped.x, parameters_.decimals);
+        writer_.write(' ');
+        writer_.write_number(flipped.y, parameters_.decimals);
+        writer_.write(command);
+        last_ = position;
+        ++n_commands_;
+    }
+
+    void EpsWriter::finish()
+    {
+        if (is_finished_)
+        {
+            return;
+        }
+        if (n_commands_ > 0)
+        {
+            writer_.write("stroke\n");
+        }
+
+        // The bounding box includes the width of the lines.
+        auto box = bounds_.get_bounding_box();
+        float margin = parameters_.line_width / 2;
+        std::array<double, 4> corners
+        {{ box.left - margin, box.top - margin,
+           box.left + box.width + margin, box.top + box.height + margin }};
+        writer_.write("%%Trailer\n%%BoundingBox:");
+        for (int i = 0; i < 4; ++i)
+        {
+            writer_.write(' ');
+            writer_.write_number(i < 2 ? std::floor(corners[i]) : std::ceil(corners[i]), 0);
+        }
+        writer_.write("\n%%HiResBoundingBox:");
+        for (auto corner : corners)
+        {
+            writer_.write(' ');
+            writer_.write_number(corner, parameters_.decimals);
+        }
+        writer_.write("\n%%EOF\n");
+        writer_.flush();
+        is_finished_ = true;
+    }
+
+    std::size_t EpsWriter::get_size() const
+    {
+        return writer_.get_size();
+    }
+}
@@ -0,0 +1,167 @@
+#ifndef EXPORT_H
+#define EXPORT_H
+
+
+#include <cstddef>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include <SFML/Graphics/Rect.hpp>
+
+#include "Color.h"
+#include "geometry.h"
+
+// Vector exporters of the paths of the turtle, in SVG and EPS. They are sinks
+// of 'drawing::stream_paths()': the documents are written while the turtle
+// moves, through a buffer of fixed size, so the drawings are exported in
+// bounded memory whatever their size.
+namespace exporter
+{
+    // A writer of text in a stream through a buffer of fixed capacity. The
+    // buffer is flushed when full and at the destruction.
+    class BufferedWriter
+    {
+    public:
+        static constexpr std::size_t DEFAULT_CAPACITY = 1 << 16;
+
+        // Write in 'os', which must outlive the writer.
+        // Exception:
+        //   - Precondition: 'capacity' is greater than 0.
+        explicit BufferedWriter(std::ostream& os, std::size_t capacity = DEFAULT_CAPACITY);
+        ~BufferedWriter();
+
+        BufferedWriter(const BufferedWriter&) = delete;
+        BufferedWriter& operator=(const BufferedWriter&) = delete;
+
+        void write(char c);
+        void write(const char* str);
+        void write(const std::string& str);
+
+        // Write 'value' rounded to 'decimals' decimals, without the trailing
+        // zeros: "12.5", "-3", ...
+        // Exception:
+        //   - Precondition: 'decimals' is between 0 and 6.
+        void write_number(double value, int decimals);
+
+        // Write the buffer in the stream.
+        void flush();
+
+        // Get the number of bytes written, including the buffered ones.
+        std::size_t get_size() const;
+
+    private:
+        void write(const char* str, std::size_t size);
+
+        std::ostream& os_;
+        std::vector<char> buffer_;
+        std::size_t used_ { 0 };
+        std::size_t flushed_ { 0 };
+    };
+
+    // The style of the exported lines.
+    struct ExportParameters
+    {
+        Color color { Color::black() };
+        float line_width { 1 };
+
+        // The coordinates are rounded to 'decimals' decimals.
+        int decimals { 2 };
+
+        // The maximum number of commands of a SVG '<path>' or of an EPS path
+        // before it is stroked: the viewers handle huge paths poorly.
+        std::size_t max_path_commands { 10000 };
+    };
+
+    // A sink of 'drawing::stream_paths()' computing the bounding box of the
+    // streamed positions, to size a SVG document before writing it.
+    class BoundsSink
+    {
+    public:
+        void move_to(const sf::Vector2f& position);
+        void line_to(const sf::Vector2f& position);
+
+        // Get the bounding box of the positions, an empty box at (0, 0) if
+        // there is none.
+        sf::FloatRect get_bounding_box() const;
+
+    private:
+        geometry::BoxAccumulator boxes_ { };
+    };
+
+    // A sink of 'drawing::stream_paths()' writing a SVG document, with the
+    // paths as '<path>' elements of 'M' and 'L' commands. The SVG coordinates
+    // are the coordinates of the turtle: their y axis goes down, as on the
+    // screen.
+    class SvgWriter
+    {
+    public:
+        // Write the header of a document showing the rectangle 'view' of the
+        // world in 'os', which must outlive the writer. SVG documents declare
+        // their view before their content: 'view' is computed beforehand,
+        // with a 'BoundsSink' for example.
+        SvgWriter(std::ostream& os, const sf::FloatRect& view,
+                  const ExportParameters& parameters = {});
+
+        // The document is finished at the destruction.
+        ~SvgWriter();
+
+        void move_to(const sf::Vector2f& position);
+        void line_to(const sf::Vector2f& position);
+
+        // Write the end of the document, and flush it. Do nothing if it is
+        // already finished.
+        void finish();
+
+        // Get the number of bytes of the document.
+        std::size_t get_size() const;
+
+    private:
+        void write_position(char command, const sf::Vector2f& position);
+
+        ExportParameters parameters_;
+        BufferedWriter writer_;
+        std::size_t n_commands_ { 0 };
+        bool is_path_open_ { false };
+        bool is_finished_ { false };
+        sf::Vector2f last_ { };
+    };
+
+    // A sink of 'drawing::stream_paths()' writing an Encapsulated PostScript
+    // document. The bounding box is computed during the export and written
+    // in the trailer ("%%BoundingBox: (atend)"): the document is written in a
+    // single pass. The y axis is flipped, PostScript's going up.
+    class EpsWriter
+    {
+    public:
+        // Write the header of a document in 'os', which must outlive the
+        // writer.
+        explicit EpsWriter(std::ostream& os, const ExportParameters& parameters = {});
+
+        // The document is finished at the destruction.
+        ~EpsWriter();
+
+        void move_to(const sf::Vector2f& position);
+        void line_to(const sf::Vector2f& position);
+
+        // Write the trailer of the document, and flush it. Do nothing if it
+        // is already finished.
+        void finish();
+
+        // Get the number of bytes of the document.
+        std::size_t get_size() const;
+
+    private:
+        void write_position(const sf::Vector2f& position, const char* command);
+
+        ExportParameters parameters_;
+        BufferedWriter writer_;
+        BoundsSink bounds_ { };
+        std::size_t n_commands_ { 0 };
+        bool is_finished_ { false };
+        sf::Vector2f last_ { };
+    };
+}
+
+
+#endif // EXPORT_H
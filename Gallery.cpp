@@ -0,0 +1,259 @@
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstring>
+#include <exception>
+#include <map>
+#include <memory>
+#include <mutex>
+
+#include "gsl/gsl"
+
+#include "Trace.h"
+#include "Turtle.h"
+#include "helper_math.h"
+#include "Gallery.h"
+
+namespace
+{
+    double milliseconds_since(std::chrono::steady_clock::time_point start)
+    {
+        return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    }
+
+    // The state of a gallery shared by its tasks. The tasks account for the
+    // cells they complete, and the production task for itself: the gallery
+    // is finished, and its arguments can be released, when nothing remains.
+    struct GalleryJob
+    {
+        explicit GalleryJob(std::size_t size)
+            : cells(size)
+            , remaining {size + 1}
+        {
+        }
+
+        void fail(std::exception_ptr exception)
+        {
+            std::lock_guard<std::mutex> lock (mutex);
+            if (!error)
+            {
+                error = exception;
+            }
+        }
+
+        void finish(std::size_t count)
+        {
+            std::lock_guard<std::mutex> lock (mutex);
+            remaining -= count;
+            if (remaining == 0)
+            {
+                finished.notify_all();
+            }
+        }
+
+        std::vector<GalleryCell> cells;
+        std::mutex mutex { };
+        std::condition_variable finished { };
+        std::size_t remaining;
+        std::exception_ptr error { };
+    };
+
+    // Interpret and render the cells 'batch' of 'job', which have all the
+    // same number of iterations.
+    void compute_batch(GalleryJob& job,
+                       const std::vector<std::size_t>& batch,
+                       const LSystem::Snapshot& lsys,
+                       const drawing::InterpretationMap::Snapshot& interpretation,
+                       const GalleryParameters& parameters)
+    {
+        TRACE_SCOPE_ARG("gallery", "batch", "size", batch.size());
+
+        std::vector<drawing::DrawingParameters> batch_parameters;
+        batch_parameters.reserve(batch.size());
+        for (auto i : batch)
+        {
+            batch_parameters.push_back(job.cells[i].parameters);
+        }
+        auto start = std::chrono::steady_clock::now();
+        auto paths = drawing::compute_paths(lsys, interpretation, batch_parameters);
+        double interpretation_duration = milliseconds_since(start) / batch.size();
+
+        for (std::size_t j = 0; j < batch.size(); ++j)
+        {
+            auto& cell = job.cells[batch[j]];
+            cell.interpretation = interpretation_duration;
+            cell.n_positions = paths[j].positions.size();
+            cell.n_polylines = paths[j].breaks.size() + (cell.n_positions > 0 ? 1 : 0);
+
+            // The batch is already a task of the pool: the thumbnail is
+            // rendered by this thread only.
+            start = std::chrono::steady_clock::now();
+            auto thumbnail = parameters.thumbnail;
+            thumbnail.view = raster::fit_view(geometry::compute_bounding_box(paths[j].positions),
+                                              thumbnail.width, thumbnail.height);
+            cell.thumbnail = raster::rasterize(paths[j], thumbnail, nullptr);
+            cell.rendering = milliseconds_since(start);
+
+            // The paths are released as soon as possible, the thumbnails
+            // being much smaller.
+            paths[j] = geometry::Polylines();
+        }
+    }
+}
+
+std::size_t ParameterSweep::size() const
+{
+    return delta_angles.size() * steps.size() * n_iters.size();
+}
+
+drawing::DrawingParameters ParameterSweep::at(std::size_t i) const
+{
+    Expects(i < size());
+    auto parameters = base;
+    parameters.delta_angle = delta_angles[i % delta_angles.size()];
+    i /= delta_angles.size();
+    parameters.step = steps[i % steps.size()];
+    i /= steps.size();
+    parameters.n_iter = n_iters[i];
+    return parameters;
+}
+
+std::vector<double> linear_range(double first, double last, int count)
+{
+    Expects(count > 0);
+    std::vector<double> values;
+    values.reserve(count);
+    for (int i = 0; i < count; ++i)
+    {
+        values.push_back(count == 1 ? first : first + (last - first) * i / (count - 1));
+    }
+    return values;
+}
+
+std::vector<GalleryCell> compute_gallery(const LSystem::Snapshot& lsys,
+                                         const drawing::InterpretationMap::Snapshot& interpretation,
+                                         const ParameterSweep& sweep,
+                                         const GalleryParameters& parameters,
+                                         ThreadPool& pool)
+{
+    Expects(parameters.batch_size > 0);
+    TRACE_SCOPE_ARG("gallery", "compute_gallery", "cells", sweep.size());
+
+    auto job = std::make_shared<GalleryJob>(sweep.size());
+    // The cells grouped by number of iterations, in increasing order.
+    std::map<int, std::vector<std::size_t>> groups;
+    for (std::size_t i = 0; i < sweep.size(); ++i)
+    {
+        job->cells[i].parameters = sweep.at(i);
+        groups[job->cells[i].parameters.n_iter].push_back(i);
+    }
+
+    pool.submit([job, &groups, &lsys, &interpretation, &parameters, &pool]()
+        {
+            // The cells not submitted yet, because of an exception. A batch
+            // is only accounted for once submitted: if 'submit()' throws, its
+            // task never finishes it.
+            std::size_t pending = job->cells.size();
+            try
+            {
+                for (const auto& group : groups)
+                {
+                    auto start = std::chrono::steady_clock::now();
+                    const auto& production = lsys.produce(group.first);
+                    double duration = milliseconds_since(start);
+                    for (auto i : group.second)
+                    {
+                        job->cells[i].production = duration;
+                        job->cells[i].n_symbols = production.size();
+                    }
+
+                    const auto& cells = group.second;
+                    for (std::size_t first = 0; first < cells.size(); first += parameters.batch_size)
+                    {
+                        auto last = std::min(first + parameters.batch_size, cells.size());
+                        std::vector<std::size_t> batch (cells.begin() + first, cells.begin() + last);
+                        pool.submit([job, batch, &lsys, &interpretation, &parameters]()
+                            {
+                                try
+                                {
+                                    compute_batch(*job, batch, lsys, interpretation, parameters);
+                                }
+                                catch (...)
+                                {
+                                    job->fail(std::current_exception());
+                                }
+                                job->finish(batch.size());
+                            });
+                        pending -= batch.size();
+                    }
+                }
+            }
+            catch (...)
+            {
+                job->fail(std::current_exception());
+            }
+            job->finish(pending + 1);
+        });
+
+    std::unique_lock<std::mutex> lock (job->mutex);
+    job->finished.wait(lock, [&job]() { return job->remaining == 0; });
+    if (job->error)
+    {
+        std::rethrow_exception(job->error);
+    }
+    return std::move(job->cells);
+}
+
+raster::Image make_contact_sheet(const std::vector<GalleryCell>& cells,
+                                 unsigned columns,
+                                 unsigned spacing,
+                                 Color background)
+{
+    Expects(columns > 0);
+
+    unsigned width = cells.empty() ? 0 : cells.front().thumbnail.width;
+    unsigned height = cells.empty() ? 0 : cells.front().thumbnail.height;
+    auto rows = static_cast<unsigned>((cells.size() + columns - 1) / columns);
+
+    raster::Image sheet;
+    sheet.width = columns * width + (columns + 1) * spacing;
+    sheet.height = rows * height + (rows + 1) * spacing;
+    sheet.pixels.resize(static_cast<std::size_t>(sheet.width) * sheet.height * 4);
+    const std::uint8_t color[4] = { background.r, background.g, background.b, background.a };
+    for (std::size_t i = 0; i < sheet.pixels.size(); i += 4)
+    {
+        std::memcpy(&sheet.pixels[i], color, 4);
+    }
+
+    for (std::size_t i = 0; i < cells.size(); ++i)
+    {
+        const auto& thumbnail = cells[i].thumbnail;
+        Expects(thumbnail.width == width && thumbnail.height == height);
+        std::size_t left = spacing + (i % columns) * (width + spacing);
+        std::size_t top = spacing + (i / columns) * (height + spacing);
+        for (unsigned y = 0; y < height; ++y)
+        {
+            std::memcpy(&sheet.pixels[((top + y) * sheet.width + left) * 4],
+                        &thumbnail.pixels[static_cast<std::size_t>(y) * width * 4],
+                        width * 4);
+        }
+    }
+    return sheet;
+}
+
+void write_gallery_csv(std::ostream& os, const std::vector<GalleryCell>& cells, unsigned columns)
+{
+    Expects(columns > 0);
+
+    os << "row,column,n_iter,step,delta_angle,symbols,positions,polylines,"
+       << "production_ms,interpretation_ms,rendering_ms\n";
+    for (std::size_t i = 0; i < cells.size(); ++i)
+    {
+        const auto& cell = cells[i];
+        os << i / columns << ',' << i % columns << ','
+           << cell.parameters.n_iter << ',' << cell.parameters.step << ','
+           << math::rad_to_degree(cell.parameters.delta_angle) << ','
+           << cell.n_symbols << ',' << cell.n_positions << ',' << cell.n_polylines << ','
+           << cell.production << ',' << cell.interpretation << ',' << cell.rendering << '\n';
+    }
+}
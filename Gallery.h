@@ -0,0 +1,119 @@
+#ifndef GALLERY_H
+#define GALLERY_H
+
+
+#include <cstddef>
+#include <ostream>
+#include <vector>
+
+#include "LSystem.h"
+#include "InterpretationMap.h"
+#include "DrawingParameters.h"
+#include "Raster.h"
+#include "ThreadPool.h"
+
+// A gallery renders a thumbnail of a L-system for each combination of a sweep
+// of its DrawingParameters, to tune a grammar at a glance instead of one value
+// at a time in the GUI. The thumbnails are assembled in a contact sheet, and
+// the timings and counts of each cell are written as CSV.
+
+// The values of the DrawingParameters swept by a gallery. The cells are all
+// the combinations of the values, ordered by 'n_iters', then 'steps', then
+// 'delta_angles': in a contact sheet, each row of cells sweeps 'delta_angles'.
+struct ParameterSweep
+{
+    // The other attributes of the cells.
+    drawing::DrawingParameters base { };
+
+    // In radian.
+    std::vector<double> delta_angles { };
+    std::vector<int> steps { };
+    std::vector<int> n_iters { };
+
+    // Get the number of cells.
+    std::size_t size() const;
+
+    // Get the DrawingParameters of the cell 'i'.
+    // Exception:
+    //   - Precondition: 'i' is lower than 'size()'.
+    drawing::DrawingParameters at(std::size_t i) const;
+};
+
+// Get 'count' values evenly spaced from 'first' to 'last' included. If
+// 'count' is 1, get 'first'.
+// Exception:
+//   - Precondition: 'count' is greater than 0.
+std::vector<double> linear_range(double first, double last, int count);
+
+// The settings of a gallery.
+struct GalleryParameters
+{
+    // The size, colors and anti-aliasing of the thumbnails. Their view is
+    // fitted to the paths of each cell.
+    raster::RasterParameters thumbnail { };
+
+    // The maximum number of cells interpreted together by
+    // 'drawing::compute_paths()', in a single task.
+    std::size_t batch_size { 8 };
+};
+
+// A cell of a gallery.
+struct GalleryCell
+{
+    drawing::DrawingParameters parameters { };
+
+    // The number of symbols of the production, positions and polylines of
+    // the paths.
+    std::size_t n_symbols { 0 };
+    std::size_t n_positions { 0 };
+    std::size_t n_polylines { 0 };
+
+    // The timings in milliseconds. The production is shared by the cells of
+    // the same number of iterations: it is the derivation of their iteration
+    // from the previous one of the gallery. The interpretation is shared by
+    // the cells of a batch: it is the duration of the batch divided by its
+    // size.
+    double production { 0 };
+    double interpretation { 0 };
+    double rendering { 0 };
+
+    raster::Image thumbnail { };
+};
+
+// Compute the cells of 'sweep' for the L-system 'lsys' and the interpretation
+// 'interpretation', in the order of 'sweep'.
+//
+// Each iteration of 'lsys' is produced once, in increasing order, by a single
+// task of 'pool'. As soon as an iteration is produced, its cells are
+// interpreted by batches and their thumbnails are rendered by other tasks of
+// 'pool'.
+// Exception:
+//   - Precondition: the function is not called by a task of 'pool', which it
+//   waits for.
+//   - Precondition: 'parameters.batch_size' is greater than 0.
+//   - Rethrow the first exception thrown by a task.
+std::vector<GalleryCell> compute_gallery(const LSystem::Snapshot& lsys,
+                                         const drawing::InterpretationMap::Snapshot& interpretation,
+                                         const ParameterSweep& sweep,
+                                         const GalleryParameters& parameters,
+                                         ThreadPool& pool = ThreadPool::shared());
+
+// Assemble the thumbnails of 'cells' in a grid of 'columns' columns,
+// separated by 'spacing' pixels of the color 'background'.
+// Exception:
+//   - Precondition: 'columns' is greater than 0, and all the thumbnails have
+//   the same size.
+raster::Image make_contact_sheet(const std::vector<GalleryCell>& cells,
+                                 unsigned columns,
+                                 unsigned spacing = 2,
+                                 Color background = Color(64, 64, 64));
+
+// Write the parameters, counts, and timings of 'cells' as CSV, with their row
+// and column in a contact sheet of 'columns' columns. The angles are in
+// degree.
+// Exception:
+//   - Precondition: 'columns' is greater than 0.
+void write_gallery_csv(std::ostream& os, const std::vector<GalleryCell>& cells, unsigned columns);
+
+
+#endif // GALLERY_H
@@ -12,7 +12,8 @@ namespace drawing
         float dx = turtle.parameters.step * std::cos(turtle.state.angle);
         float dy = turtle.parameters.step * std::sin(turtle.state.angle);
         turtle.state.position += {dx, dy};
-        turtle.vertices.push_back(turtle.state.position);
+        turtle.paths.positions.push_back(turtle.state.position);
+        turtle.boxes.add(turtle.state.position);
     }
 
     void turn_right_fn(Turtle& turtle)
@@ -38,12 +39,27 @@ namespace drawing
         }
         else
         {
-            turtle.vertices.push_back( {turtle.vertices.back().position, sf::Color::Transparent} );
             turtle.state.position = turtle.stack.top().position;
             turtle.state.angle = turtle.stack.top().angle;
-            turtle.vertices.push_back( {turtle.stack.top().position, sf::Color::Transparent} );
-            turtle.vertices.push_back( {turtle.stack.top().position} );
             turtle.stack.pop();
+
+            // The jump starts a new polyline. If the current one only has a
+            // single position, it draws nothing and is replaced instead.
+            auto& paths = turtle.paths;
+            std::size_t start = paths.breaks.empty() ? 0 : paths.breaks.back();
+            // The position was already visited: it does not modify the
+            // bounding box, but it belongs to the current sub-box.
+            if (paths.positions.size() - start == 1)
+            {
+                paths.positions.back() = turtle.state.position;
+                turtle.boxes.replace_last(turtle.state.position);
+            }
+            else
+            {
+                paths.breaks.push_back(paths.positions.size());
+                paths.positions.push_back(turtle.state.position);
+                turtle.boxes.add(turtle.state.position);
+            }
         }
     }
 }
@@ -35,7 +35,7 @@ namespace drawing
     struct Order {
         OrderID id;
         order_fn order;
-        void operator() (impl::Turtle& t) { order(t); }
+        void operator() (impl::Turtle& t) const { order(t); }
     };
     inline bool operator== (const Order& lhs, const Order& rhs)
     {
@@ -1,10 +1,154 @@
+#include <array>
+#include <utility>
+
 #include "gsl/gsl"
+#include "Trace.h"
 #include "LSystem.h"
 
 
+namespace
+{
+    // Derive the next iteration of 'base' with the rules 'rules'.
+    // The size of the iteration is computed beforehand, so that it is
+    // allocated only once.
+    std::string derive(const std::string& base, const LSystem::production_rules& rules)
+    {
+        // The successors are looked up in a table indexed by the symbols, a
+        // null successor meaning a terminal.
+        std::array<const std::string*, 256> successors;
+        successors.fill(nullptr);
+        for (const auto& rule : rules)
+        {
+            successors[static_cast<unsigned char>(rule.first)] = &rule.second;
+        }
+
+        std::size_t size = 0;
+        for (auto c : base)
+        {
+            const auto* successor = successors[static_cast<unsigned char>(c)];
+            size += successor ? successor->size() : 1;
+        }
+
+        std::string derived;
+        derived.reserve(size);
+        for (auto c : base)
+        {
+            const auto* successor = successors[static_cast<unsigned char>(c)];
+            if(successor)
+            {
+                // Replace the symbol according to its rule.
+                derived.append(*successor);
+            }
+            else
+            {
+                // The symbol is a terminal: replace it by itself.
+                derived.push_back(c);
+            }
+        }
+
+        return derived;
+    }
+}
+
+LSystem::Snapshot::Snapshot(const std::string& axiom, std::shared_ptr<const RuleMap::Snapshot> rules)
+    : axiom {axiom}
+    , rules {rules->rules}
+    , version {rules->version}
+    , rules_snapshot_ {std::move(rules)}
+    , mutex_ {}
+    , cache_ { {0, std::make_shared<const std::string>(axiom)} }
+{
+}
+
+LSystem::Snapshot::Snapshot(const std::string& axiom, std::shared_ptr<const RuleMap::Snapshot> rules,
+                            const Snapshot& previous, int last_shared)
+    : Snapshot(axiom, std::move(rules))
+{
+    std::lock_guard<std::mutex> lock (previous.mutex_);
+    for (int i = 1; i <= last_shared && previous.cache_.count(i) > 0; ++i)
+    {
+        cache_.emplace(i, previous.cache_.at(i));
+    }
+}
+
+// Exceptions:
+//   - Precondition: n positive.
+const std::string& LSystem::Snapshot::produce(int n) const
+{
+    Expects(n >= 0);
+
+    std::unique_lock<std::mutex> lock (mutex_);
+
+    // Same algorithm as 'LSystem::produce()'.
+    int highest_n = n;
+    while (cache_.count(highest_n) == 0)
+    {
+        --highest_n;
+    }
+
+    for (int i = highest_n; i < n; ++i)
+    {
+        // The derivation is done without the lock so that the other threads
+        // only wait for the iterations they need. A cached iteration is never
+        // modified, so it can be read without the lock. If two threads derive
+        // the same iteration, the second result is simply discarded.
+        const std::string& base = *cache_.at(i);
+        lock.unlock();
+        TRACE_SCOPE_ARG("production", "derive", "n", i + 1);
+        auto derived = std::make_shared<const std::string>(derive(base, rules));
+        lock.lock();
+        cache_.emplace(i + 1, std::move(derived));
+    }
+    
+    return *cache_.at(n);
+}
+
+bool LSystem::Snapshot::is_produced(int n) const
+{
+    std::lock_guard<std::mutex> lock (mutex_);
+    return cache_.count(n) > 0;
+}
+
+int LSystem::Snapshot::last_independent_iteration(char predecessor) const
+{
+    // Same algorithm as 'LSystem::invalidate_cache()'. The iterations are
+    // scanned without the lock: they are never modified.
+    std::vector<std::shared_ptr<const std::string>> iterations;
+    {
+        std::lock_guard<std::mutex> lock (mutex_);
+        for (int i = 0; cache_.count(i) > 0; ++i)
+        {
+            iterations.push_back(cache_.at(i));
+        }
+    }
+
+    int last = 0;
+    while (last + 1 < static_cast<int>(iterations.size()) &&
+           iterations[last]->find(predecessor) == std::string::npos)
+    {
+        ++last;
+    }
+    return last;
+}
+
+std::size_t LSystem::Snapshot::memory_usage() const
+{
+    std::lock_guard<std::mutex> lock (mutex_);
+    std::size_t bytes = cache_.bucket_count() * sizeof(void*);
+    for (const auto& iteration : cache_)
+    {
+        bytes += node_bytes<std::pair<const int, std::shared_ptr<const std::string>>>() +
+                 node_bytes<std::string>() + heap_bytes(*iteration.second);
+    }
+    return bytes;
+}
+
+
 LSystem::LSystem(const std::string& axiom, const production_rules& prod)
     : RuleMap<std::string>(prod)
     , cache_{ {0, axiom} }
+    , cache_versions_{ {0, 0} }
+    , snapshot_{ std::make_shared<const Snapshot>(axiom, RuleMap::get_snapshot()) }
     {
     }
 
@@ -26,42 +170,136 @@ const std::unordered_map<int, std::string>& LSystem::get_cache() const
     return cache_;
 }
 
+// Exception:
+//   - Precondition: the iteration 'n' is cached.
+unsigned long LSystem::get_iteration_version(int n) const
+{
+    Expects(cache_versions_.count(n) > 0);
+    return cache_versions_.at(n);
+}
+
+MemoryUsage LSystem::memory_usage() const
+{
+    MemoryUsage usage;
+
+    std::vector<int> iterations;
+    for (const auto& iteration : cache_)
+    {
+        iterations.push_back(iteration.first);
+    }
+    std::sort(iterations.begin(), iterations.end());
+    for (int n : iterations)
+    {
+        usage.add("iteration " + std::to_string(n),
+                  node_bytes<std::pair<const int, std::string>>() + heap_bytes(cache_.at(n)) +
+                  node_bytes<std::pair<const int, unsigned long>>());
+    }
+
+    std::size_t rules = (cache_.bucket_count() + cache_versions_.bucket_count() +
+                         get_rules().bucket_count()) * sizeof(void*);
+    for (const auto& rule : get_rules())
+    {
+        rules += node_bytes<production_rules::value_type>() + heap_bytes(rule.second);
+    }
+    usage.add("rules", rules);
+
+    usage.add("snapshot", get_snapshot()->memory_usage());
+    return usage;
+}
+
+std::shared_ptr<const LSystem::Snapshot> LSystem::get_snapshot() const
+{
+    return std::atomic_load(&snapshot_);
+}
+
+void LSystem::publish(unsigned long version)
+{
+    // The rules are copied once, in the snapshot of the RuleMap, and shared
+    // with the snapshot of the LSystem. The iterations of the previous
+    // snapshot still valid are shared, so the computations of the new
+    // version do not derive them again.
+    RuleMap::publish(version);
+    std::shared_ptr<const Snapshot> snapshot =
+        std::make_shared<const Snapshot>(get_axiom(), RuleMap::get_snapshot(),
+                                         *get_snapshot(), last_shared_iteration_);
+    std::atomic_store(&snapshot_, snapshot);
+    last_shared_iteration_ = std::numeric_limits<int>::max();
+}
+
 void LSystem::set_axiom(const std::string& axiom)
 {
     cache_ = { {0, axiom} };
-    notify();
+    cache_versions_ = { {0, get_version() + 1} };
+    last_shared_iteration_ = -1;
+    notify(Change::Kind::AXIOM);
 } 
 
 void LSystem::add_rule(char predecessor, const RuleMap::successor& successor)
 {
-    cache_ = { {0, get_axiom()} };
+    if (!has_rule(predecessor, successor))
+    {
+        invalidate_cache(predecessor);
+    }
     RuleMap::add_rule(predecessor, successor);    
 }
 
 void LSystem::remove_rule(char predecessor)
 {
-    cache_ = { {0, get_axiom()} };
+    invalidate_cache(predecessor);
     RuleMap::remove_rule(predecessor);
 }
 
 void LSystem::clear_rules()
 {
     cache_ = { {0, get_axiom()} };
+    cache_versions_ = { {0, cache_versions_[0]} };
+    last_shared_iteration_ = 0;
     RuleMap::clear_rules();
 }                             
 
+void LSystem::invalidate_cache(char predecessor)
+{
+    // The iteration 'i+1' is derived from the iteration 'i'. If 'predecessor'
+    // does not appear in the iteration 'i', its rule is not used and the
+    // iteration 'i+1' stays valid. So the first cached iteration containing
+    // 'predecessor' is the last valid one.
+    int last_valid = 0;
+    while (cache_.count(last_valid + 1) > 0 &&
+           cache_.at(last_valid).find(predecessor) == std::string::npos)
+    {
+        ++last_valid;
+    }
+
+    last_shared_iteration_ = std::min(last_shared_iteration_,
+                                      get_snapshot()->last_independent_iteration(predecessor));
+
+    for (auto it = cache_.begin(); it != cache_.end(); )
+    {
+        if (it->first > last_valid)
+        {
+            cache_versions_.erase(it->first);
+            it = cache_.erase(it);
+        }
+        else
+        {
+            ++it;
+        }
+    }
+}
+
 // Edge Cases:
 //   - If 'cache_' is empty so does not contains the axiom, simply
 //   returns an empty string.
 //   - If the axiom is an empty string, early-out.
-std::string LSystem::produce(int n)
+const std::string& LSystem::produce(int n)
 {
     Expects(n >= 0);
 
+    static const std::string empty {};
     if (cache_.count(0) == 0 || cache_.at(0) == "")
     {
         // We do not have any axiom so nothing to produce.
-        return "";
+        return empty;
     }
         
     if (cache_.count(n) > 0)
@@ -78,40 +316,23 @@ std::string LSystem::produce(int n)
                                     { return pair1.first < pair2.first; });
 
     // We will start iterating from this result.
-    std::string base = highest->second;
-    // We use a temporary string: we can't iterate "in place".
-    std::string tmp;
+    // Note: references to elements of an 'unordered_map' are not invalidated
+    // by an insertion, so we can derive each iteration directly from the
+    // cache without copying it.
+    int highest_n = highest->first;
 
-    int n_iter = n - highest->first;
+    int n_iter = n - highest_n;
     for (int i=0; i<n_iter; ++i) {
-        tmp.clear();
-            
-        for (auto c : base)
-        {
-            if(rules_.count(c) > 0)
-            {
-                std::string derivation = rules_.at(c);
-
-                // Replace the symbol according to its rule.
-                tmp.insert(tmp.end(), derivation.begin(), derivation.end());
-
-            }
-            else
-            {
-                // The symbol is a terminal: replace it by itself.
-                tmp.push_back(c);
-            }
-        }
-
-        base = tmp;
-        cache_.emplace(highest->first + i + 1, tmp);
+        TRACE_SCOPE_ARG("production", "derive", "n", highest_n + i + 1);
+        // We use a new string: we can't iterate "in place".
+        cache_.emplace(highest_n + i + 1, derive(cache_.at(highest_n + i), rules_));
+        cache_versions_.emplace(highest_n + i + 1, get_version());
     }
 
     // No 'notify()' call: this function is generally called each time there is
     // a notification of the LSystem. A second notify would double the
     // computation time and may double the computation time of the hungrier
-    // 'drawing::compute_vertices()' function.
+    // 'drawing::compute_paths()' function.
     
     return cache_.at(n);
 }
-
@@ -3,11 +3,15 @@
 
 
 #include <string>
+#include <memory>
+#include <mutex>
 #include <unordered_map>
 #include <iostream>
 #include <algorithm>
+#include <limits>
 
 #include "Observable.h"
+#include "MemoryTracker.h"
 #include "RuleMap.h"
 
 // Simple L-system generation class. Starting from an axiom and
@@ -19,6 +23,10 @@
 //   - If an axiom is defined at construction, 'cache_.at(0)' contains it at
 //   all time.
 //   - 'cache_' is coherent with the 'rules_'.
+//
+// At each modification, LSystem publishes an immutable 'Snapshot' of its axiom
+// and rules tagged with its version. Worker threads can take a snapshot and
+// produce from it while the LSystem continues to be modified.
 class LSystem : public RuleMap<std::string>
 {
 public:
@@ -29,6 +37,59 @@ public:
     // contained in a hashmap for quick access during an
     // iteration.
     using production_rules = RuleMap::rule_map;
+
+    // An immutable copy of the LSystem at a given version.
+    // Its production is cached like the LSystem's one. This cache does not
+    // change the result of 'produce()', so it does not break the
+    // immutability, and it is protected by a mutex: a Snapshot can be shared
+    // between threads. The mutex is not held during a derivation, so querying
+    // an already produced iteration never waits for another thread.
+    //
+    // The rules are the ones of the snapshot of the RuleMap at the same
+    // version: they are shared with it, not copied again.
+    class Snapshot
+    {
+    public:
+        Snapshot(const std::string& axiom, std::shared_ptr<const RuleMap::Snapshot> rules);
+
+        // Create the snapshot of a new version sharing the iterations up to
+        // 'last_shared' already produced by 'previous', so that they are not
+        // derived again.
+        Snapshot(const std::string& axiom, std::shared_ptr<const RuleMap::Snapshot> rules,
+                 const Snapshot& previous, int last_shared);
+
+        const std::string axiom;
+        const production_rules& rules;
+        const unsigned long version;
+
+        // Returns the result of the 'n'-th iteration of the L-System. The
+        // returned reference is valid for the lifetime of the Snapshot.
+        //
+        // Exceptions:
+        //   - Precondition: n positive.
+        //   - Throw in case of allocation problem.
+        const std::string& produce(int n) const;
+
+        // Check if the iteration 'n' is already produced.
+        bool is_produced(int n) const;
+
+        // Get the highest iteration produced whose derivation does not use
+        // the rule of 'predecessor': it and the previous ones do not depend
+        // on this rule.
+        int last_independent_iteration(char predecessor) const;
+
+        // Get the number of bytes allocated for the cached iterations,
+        // including the ones shared with other snapshots.
+        std::size_t memory_usage() const;
+
+    private:
+        // The owner of 'rules'.
+        std::shared_ptr<const RuleMap::Snapshot> rules_snapshot_;
+
+        // The iterations are shared between the successive snapshots.
+        mutable std::mutex mutex_;
+        mutable std::unordered_map<int, std::shared_ptr<const std::string>> cache_;
+    };
         
     // Constructors
     LSystem() = default;
@@ -41,17 +102,36 @@ public:
     // Get the cache
     const std::unordered_map<int, std::string>& get_cache() const;
 
+    // Get the version of the LSystem at which the cached iteration 'n' was
+    // produced. If it is lower or equal to the 'old_version' of a
+    // notification, the iteration survived the modification.
+    // Exception:
+    //   - Precondition: the iteration 'n' is cached.
+    unsigned long get_iteration_version(int n) const;
+
+    // Get the memory used by the LSystem: each cached iteration, the rules,
+    // and the cache of the current snapshot.
+    MemoryUsage memory_usage() const;
+
+    // Get the snapshot of the current version. Thread-safe and lock-free.
+    // Note: hides 'RuleMap::get_snapshot()', which does not contain the axiom.
+    std::shared_ptr<const Snapshot> get_snapshot() const;
+
     // Set the axiom to 'axiom'
     void set_axiom(const std::string& axiom);
 
     // Add the rule "predecessor -> successor"
     // Note: replace the successor of an existing rule if 'predecessor' has
     // already a rule associated.
+    // Note: only the cached iterations depending on 'predecessor' are
+    // discarded.
     void add_rule(char predecessor, const RuleMap::successor& successor) override;
 
     // Remove the rule associated to 'predecessor'
     // Exception:
     //   - Precondition: 'predecessor' must have a rule associated.
+    // Note: only the cached iterations depending on 'predecessor' are
+    // discarded.
     void remove_rule(char predecessor) override;
 
     // Clear the rules
@@ -64,9 +144,21 @@ public:
     //   - Precondition: n positive.
     //   - Throw in case of allocation problem.
     //   - Throw at '.at()' if code is badly refactored.
-    std::string produce(int n);
+    //
+    // Note: the returned reference points inside the cache. It is valid
+    // until the next modification of the LSystem.
+    const std::string& produce(int n);
        
+protected:
+    // Publish the snapshot of the version 'version'.
+    void publish(unsigned long version) override;
+
 private:
+    // Discard the cached iterations made obsolete by a modification of the
+    // rule of 'predecessor'.
+    void invalidate_cache(char predecessor);
+    
+
     // The cache of all calculated iterations and the axiom.
     // It contains all the iterations up to the highest iteration
     // calculated. It is clearly not optimized for memory
@@ -74,6 +166,18 @@ private:
     // quickly swapping between different iterations of the same
     // L-System.
     std::unordered_map<int, std::string> cache_ = {};
+
+    // The version of the LSystem at which each cached iteration was produced.
+    std::unordered_map<int, unsigned long> cache_versions_ = {};
+
+    // The last iteration of the current snapshot still valid after the
+    // modification in progress: the next snapshot shares the iterations up
+    // to it, as 'cache_' keeps its valid iterations.
+    int last_shared_iteration_ = std::numeric_limits<int>::max();
+
+    // The snapshot of the current version. Only accessed with
+    // 'std::atomic_load()' and 'std::atomic_store()'.
+    std::shared_ptr<const Snapshot> snapshot_ = std::make_shared<const Snapshot>("", RuleMap::get_snapshot());
 };
    
 #endif
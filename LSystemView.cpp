@@ -1,9 +1,37 @@
 #include "procgui.h"
+#include "ThreadPool.h"
+#include "Trace.h"
 #include "LSystemView.h"
 
 namespace procgui
 {
     using namespace drawing;
+
+    constexpr std::chrono::milliseconds LSystemView::STRIP_TIME_BUDGET;
+
+    namespace
+    {
+        // Check if each range of 'inner' is included in a range of 'outer'.
+        // Both are sorted and disjoint, as computed by
+        // 'SegmentIndex::find_ranges()'.
+        bool covers(const std::vector<geometry::SegmentIndex::range>& outer,
+                    const std::vector<geometry::SegmentIndex::range>& inner)
+        {
+            auto it = outer.begin();
+            for (const auto& r : inner)
+            {
+                while (it != outer.end() && it->second < r.second)
+                {
+                    ++it;
+                }
+                if (it == outer.end() || it->first > r.first)
+                {
+                    return false;
+                }
+            }
+            return true;
+        }
+    }
     
     LSystemView::LSystemView(std::shared_ptr<LSystem> lsys,
                              std::shared_ptr<drawing::InterpretationMap> map,
@@ -13,14 +41,36 @@ namespace procgui
         , lsys_buff_ {lsys}
         , interpretation_buff_ {map}
         , params_ {params}
-        , vertices_ {}
+        , deduplicate_ {false}
+        , paths_ {}
         , bounding_box_ {}
         , sub_boxes_ {}
+        , index_ {}
+        , lod_levels_ {}
+        , max_pixel_error_ {LOD_MAX_PIXEL_ERROR}
+        , strip_ {}
+        , strip_level_ {-1}
+        , strip_ranges_ {}
+        , is_strip_valid_ {false}
+        , next_strip_ {}
+        , next_level_ {-1}
+        , next_ranges_ {}
+        , next_range_ {0}
+        , next_position_ {0}
+        , is_building_ {false}
+        , compute_time_ {0}
+        , compute_symbols_ {0}
+        , is_profiling_ {false}
+        , profile_ {}
+        , production_ {}
+        , requested_generation_ {0}
+        , applied_generation_ {0}
+        , pending_ {std::make_shared<PendingGeometry>()}
     {
         // Invariant respected: cohesion between the LSystem/InterpretationMap
         // and the vertices. 
-        Observer<LSystem>::add_callback([this](){compute_vertices();});
-        Observer<InterpretationMap>::add_callback([this](){compute_vertices();});
+        Observer<LSystem>::add_callback([this](const Observable::Change& c){on_lsystem_change(c);});
+        Observer<InterpretationMap>::add_callback([this](const Observable::Change& c){on_interpretation_change(c);});
         compute_vertices();
     }
 
@@ -30,24 +80,72 @@ namespace procgui
         , lsys_buff_ {other.lsys_buff_}
         , interpretation_buff_ {other.interpretation_buff_}
         , params_ {other.params_}
-        , vertices_ {other.vertices_}
+        , deduplicate_ {other.deduplicate_}
+        , paths_ {other.paths_}
         , bounding_box_ {other.bounding_box_}
         , sub_boxes_ {other.sub_boxes_}
+        , index_ {other.index_}
+        , lod_levels_ {other.lod_levels_}
+        , max_pixel_error_ {other.max_pixel_error_}
+        , strip_ {}
+        , strip_level_ {-1}
+        , strip_ranges_ {}
+        , is_strip_valid_ {false}
+        , next_strip_ {}
+        , next_level_ {-1}
+        , next_ranges_ {}
+        , next_range_ {0}
+        , next_position_ {0}
+        , is_building_ {false}
+        , compute_time_ {other.compute_time_}
+        , compute_symbols_ {other.compute_symbols_}
+        , is_profiling_ {other.is_profiling_}
+        , profile_ {}
+        , production_ {other.production_}
+        , requested_generation_ {0}
+        , applied_generation_ {0}
+        , pending_ {std::make_shared<PendingGeometry>()}
     {
-        Observer<LSystem>::add_callback([this](){compute_vertices();});
-        Observer<InterpretationMap>::add_callback([this](){compute_vertices();});
+        Observer<LSystem>::add_callback([this](const Observable::Change& c){on_lsystem_change(c);});
+        Observer<InterpretationMap>::add_callback([this](const Observable::Change& c){on_interpretation_change(c);});
+
+        // The result of a computation of 'other' will not be sent to this
+        // copy: request our own.
+        if (other.requested_generation_ != other.applied_generation_)
+        {
+            request_vertices();
+        }
     }
     LSystemView& LSystemView::operator=(const LSystemView& other)
     {
         lsys_buff_ = other.lsys_buff_;
         interpretation_buff_ = other.interpretation_buff_;
         params_ = other.params_;
-        vertices_ = other.vertices_;
+        deduplicate_ = other.deduplicate_;
+        paths_ = other.paths_;
         bounding_box_ = other.bounding_box_;
         sub_boxes_ = other.sub_boxes_;
+        index_ = other.index_;
+        lod_levels_ = other.lod_levels_;
+        max_pixel_error_ = other.max_pixel_error_;
+        is_strip_valid_ = false;
+        is_building_ = false;
+        compute_time_ = other.compute_time_;
+        compute_symbols_ = other.compute_symbols_;
+        is_profiling_ = other.is_profiling_;
+        profile_.clear();
+        production_ = other.production_;
+
+        // Any pending result is obsolete.
+        applied_generation_ = ++requested_generation_;
 
-        Observer<LSystem>::add_callback([this](){compute_vertices();});
-        Observer<InterpretationMap>::add_callback([this](){compute_vertices();});
+        Observer<LSystem>::add_callback([this](const Observable::Change& c){on_lsystem_change(c);});
+        Observer<InterpretationMap>::add_callback([this](const Observable::Change& c){on_interpretation_change(c);});
+
+        if (other.requested_generation_ != other.applied_generation_)
+        {
+            request_vertices();
+        }
 
         return *this;
     }
@@ -57,6 +155,10 @@ namespace procgui
     {
         return params_;
     }
+    bool& LSystemView::get_deduplication()
+    {
+        return deduplicate_;
+    }
     LSystemBuffer& LSystemView::get_lsystem_buffer()
     {
         return lsys_buff_;
@@ -65,46 +167,361 @@ namespace procgui
     {
         return interpretation_buff_;
     }
+    const sf::FloatRect& LSystemView::get_bounding_box() const
+    {
+        return bounding_box_;
+    }
+    const std::vector<sf::FloatRect>& LSystemView::get_sub_boxes() const
+    {
+        return sub_boxes_;
+    }
 
+    bool LSystemView::is_inside(const sf::Vector2f& position) const
+    {
+        if (!geometry::contains(bounding_box_, position))
+        {
+            return false;
+        }
+        for (const auto& box : sub_boxes_)
+        {
+            if (geometry::contains(box, position))
+            {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    std::size_t LSystemView::find_segment(const sf::Vector2f& position, float tolerance) const
+    {
+        return index_.find_segment(paths_, position, tolerance);
+    }
+
+
+    void LSystemView::apply(Geometry&& geometry)
+    {
+        paths_ = std::move(geometry.paths);
+        bounding_box_ = geometry.bounding_box;
+        sub_boxes_ = std::move(geometry.sub_boxes);
+        index_ = std::move(geometry.index);
+        lod_levels_ = std::move(geometry.lod_levels);
+        compute_time_ = geometry.compute_time;
+        compute_symbols_ = geometry.symbols;
+        is_strip_valid_ = false;
+        is_building_ = false;
+        if (is_profiling_)
+        {
+            profile_.record(geometry.profile);
+        }
+    }
     
     void LSystemView::compute_vertices()
     {
-        // Invariant respected: cohesion between the vertices and the bounding
-        // boxes. 
-        
-        vertices_ = drawing::compute_vertices(*Observer<LSystem>::target_,
-                                              *Observer<InterpretationMap>::target_,
-                                              params_);
-        bounding_box_ = geometry::compute_bounding_box(vertices_);
-        sub_boxes_ = geometry::compute_sub_boxes(vertices_, MAX_SUB_BOXES);
+        production_ = Observer<LSystem>::target_->get_snapshot();
+        auto map = Observer<InterpretationMap>::target_->get_snapshot();
+
+        apply(compute_geometry(*production_, *map, params_, deduplicate_, is_profiling_));
+
+        // Any pending result is obsolete.
+        applied_generation_ = ++requested_generation_;
+    }
+
+    void LSystemView::request_vertices(bool with_preview)
+    {
+        production_ = Observer<LSystem>::target_->get_snapshot();
+        auto lsys = production_;
+        auto map = Observer<InterpretationMap>::target_->get_snapshot();
+        auto deduplicate = deduplicate_;
+        auto profile = is_profiling_;
+        auto pending = pending_;
+
+        auto submit = [&](const DrawingParameters& params, unsigned long generation)
+            {
+                ThreadPool::shared().submit(
+                    [lsys, map, params, deduplicate, profile, generation, pending]()
+                    {
+                        auto geometry = compute_geometry(*lsys, *map, params, deduplicate, profile);
+
+                        std::lock_guard<std::mutex> lock (pending->mutex);
+                        // A more recent computation may have finished first:
+                        // this result is stale.
+                        if (generation > pending->generation)
+                        {
+                            pending->geometry = std::move(geometry);
+                            pending->generation = generation;
+                            pending->is_ready = true;
+                        }
+                    });
+            };
+
+        // A preview with fewer iterations is computed first: it is displayed
+        // quickly, until the full computation refines it. Its generation is
+        // lower, so the preview is dropped if it finishes last.
+        requested_generation_ += 2;
+        int preview_n_iter = with_preview ?
+            preview_iterations(*lsys, params_.n_iter, compute_time_, compute_symbols_) :
+            params_.n_iter;
+        if (preview_n_iter < params_.n_iter)
+        {
+            auto preview = params_;
+            preview.n_iter = preview_n_iter;
+            submit(preview, requested_generation_ - 1);
+        }
+        submit(params_, requested_generation_);
+    }
+
+    bool LSystemView::apply_pending_vertices()
+    {
+        std::lock_guard<std::mutex> lock (pending_->mutex);
+        if (!pending_->is_ready || pending_->generation <= applied_generation_)
+        {
+            return false;
+        }
+
+        apply(std::move(pending_->geometry));
+        applied_generation_ = pending_->generation;
+        pending_->is_ready = false;
+        return true;
+    }
+
+    bool LSystemView::has_pending_result() const
+    {
+        std::lock_guard<std::mutex> lock (pending_->mutex);
+        return pending_->is_ready && pending_->generation > applied_generation_;
+    }
+
+    bool LSystemView::is_computing() const
+    {
+        return requested_generation_ != applied_generation_;
+    }
+
+    double LSystemView::get_compute_time() const
+    {
+        return compute_time_;
+    }
+
+    bool LSystemView::is_converting() const
+    {
+        return is_building_;
+    }
+
+    bool LSystemView::production_lacks(char symbol, int n) const
+    {
+        // During a computation, 'production_' may not be produced yet: we do
+        // not want to wait for it.
+        if (!production_ || requested_generation_ != applied_generation_)
+        {
+            return false;
+        }
+
+        // All the iterations up to 'params_.n_iter' were produced for the
+        // current vertices, so this loop only reads cached iterations.
+        for (int i = 0; i <= n; ++i)
+        {
+            if (production_->produce(i).find(symbol) != std::string::npos)
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    void LSystemView::on_lsystem_change(const Observable::Change& change)
+    {
+        // The iteration 'i+1' is derived from the iteration 'i'. If the
+        // predecessor of the modified rule does not appear in the iterations
+        // before ours, the rule was not used: the production did not change,
+        // and neither did the vertices. 'production_' stays valid for the
+        // next modifications, as its iterations are the same as the current
+        // LSystem's ones.
+        using Kind = Observable::Change::Kind;
+        bool is_rule_change = change.kind == Kind::RULE_ADDED ||
+                              change.kind == Kind::RULE_CHANGED ||
+                              change.kind == Kind::RULE_REMOVED;
+        if (is_rule_change &&
+            (params_.n_iter == 0 || production_lacks(change.predecessor, params_.n_iter - 1)))
+        {
+            return;
+        }
+
+        request_vertices();
+    }
+
+    void LSystemView::on_interpretation_change(const Observable::Change& change)
+    {
+        // If the modified interpretation concerns a symbol absent from our
+        // production, the vertices did not change.
+        using Kind = Observable::Change::Kind;
+        bool is_rule_change = change.kind == Kind::RULE_ADDED ||
+                              change.kind == Kind::RULE_CHANGED ||
+                              change.kind == Kind::RULE_REMOVED;
+        if (is_rule_change &&
+            requested_generation_ == applied_generation_ &&
+            production_ &&
+            production_->produce(params_.n_iter).find(change.predecessor) == std::string::npos)
+        {
+            return;
+        }
+
+        // Otherwise, re-interpret the production. It is still cached in the
+        // snapshot, so it is not computed again.
+        request_vertices();
     }
     
-    void LSystemView::draw(sf::RenderTarget &target)
+    void LSystemView::interact()
     {
         // Interact with the models and re-compute the vertices if there is a
         // modification. 
         if (interact_with(*this, ""))
         {
-            compute_vertices();
+            request_vertices();
+        }
+    }
+    
+    MemoryUsage LSystemView::memory_usage() const
+    {
+        MemoryUsage usage;
+        usage.add("positions", paths_.positions.memory_usage());
+        usage.add("breaks", heap_bytes(paths_.breaks));
+        usage.add("sub-boxes", heap_bytes(sub_boxes_));
+        usage.add("index", index_.memory_usage());
+
+        std::size_t lod = heap_bytes(lod_levels_);
+        for (const auto& level : lod_levels_)
+        {
+            lod += geometry::memory_usage(level);
+        }
+        usage.add("levels of detail", lod);
+
+        usage.add("vertices", heap_bytes(strip_) + heap_bytes(next_strip_) +
+                              heap_bytes(strip_ranges_) + heap_bytes(next_ranges_));
+        usage.add("LSystem buffer", lsys_buff_.memory_usage());
+        usage.add("interpretation buffer", interpretation_buff_.memory_usage());
+
+        if (production_ && production_ != Observer<LSystem>::target_->get_snapshot())
+        {
+            usage.add("production snapshot", production_->memory_usage());
         }
+        return usage;
+    }
+
+    void LSystemView::set_profiling(bool is_enabled)
+    {
+        if (is_enabled && !is_profiling_)
+        {
+            profile_.clear();
+        }
+        is_profiling_ = is_enabled;
+    }
+
+    bool LSystemView::is_profiling() const
+    {
+        return is_profiling_;
+    }
+
+    const ViewProfile& LSystemView::get_profile() const
+    {
+        return profile_;
+    }
+
+    void LSystemView::set_max_pixel_error(float pixels)
+    {
+        Expects(pixels > 0);
+        max_pixel_error_ = pixels;
+    }
+
+    float LSystemView::get_max_pixel_error() const
+    {
+        return max_pixel_error_;
+    }
+
+    void LSystemView::draw(sf::RenderTarget &target)
+    {
+        TRACE_SCOPE("view", "draw");
+        ViewProfile::Frame frame;
+        Stopwatch stopwatch (is_profiling_);
+
+        // Apply the last computed vertices, if any.
+        apply_pending_vertices();
+        stopwatch.lap(frame.apply);
 
-        // Early out if there are no vertices.
-        if (vertices_.size() == 0)
+        // Early out if there are no paths.
+        if (paths_.positions.size() == 0)
         {
             return;
         }
 
-        // Draw the vertices.
-        target.draw(vertices_.data(), vertices_.size(), sf::LineStrip);
+        // Select the coarsest level of detail whose error is not visible at
+        // the scale of the 'sf::View'.
+        float world_per_pixel = target.getView().getSize().x / target.getSize().x;
+        int level = -1;
+        for (std::size_t i = 0; i < lod_levels_.size(); ++i)
+        {
+            if (lod_levels_[i].error <= max_pixel_error_ * world_per_pixel)
+            {
+                level = i;
+            }
+        }
 
-        // Draw the global bounding boxes.
-        std::array<sf::Vertex, 5> box =
-            {{ {{ bounding_box_.left, bounding_box_.top}},
-               {{ bounding_box_.left, bounding_box_.top + bounding_box_.height}},
-               {{ bounding_box_.left + bounding_box_.width, bounding_box_.top + bounding_box_.height}},
-               {{ bounding_box_.left + bounding_box_.width, bounding_box_.top}},
-               {{ bounding_box_.left, bounding_box_.top}}}};
-        target.draw(box.data(), box.size(), sf::LineStrip);
+        // The paths or the level of detail are drawn entirely only if they
+        // are fully visible: otherwise, only the ranges of positions
+        // intersecting the 'sf::View' are drawn, found with their index. The
+        // positions of a level are a subset of the paths: they are in the
+        // same bounding box.
+        const geometry::Polylines& paths = level >= 0 ? lod_levels_.at(level).paths : paths_;
+        const geometry::SegmentIndex& index = level >= 0 ? lod_levels_.at(level).index : index_;
+        std::vector<geometry::SegmentIndex::range> ranges;
+        auto view_rect = geometry::compute_view_rect(target.getView());
+        if (geometry::contains(view_rect, {bounding_box_.left, bounding_box_.top}) &&
+            geometry::contains(view_rect, {bounding_box_.left + bounding_box_.width,
+                                           bounding_box_.top + bounding_box_.height}))
+        {
+            ranges.push_back({0, paths.positions.size()});
+        }
+        else
+        {
+            ranges = index.find_ranges(view_rect);
+        }
+
+        // Convert the paths to vertices, only if necessary: vertices
+        // covering more than the visible ranges are drawn as they are. All
+        // the ranges are linked in a single 'sf::LineStrip', for a single
+        // draw call. The conversion of huge paths is sliced across frames:
+        // meanwhile, the previous vertices are drawn if they still represent
+        // the paths (only the visible ranges or the level of detail changed).
+        // Otherwise, the vertices converted so far are drawn, so the drawing
+        // appears progressively.
+        // A conversion in progress is finished before another one starts:
+        // when the ranges change at each frame, while panning, restarting it
+        // would never complete any.
+        frame.is_strip_cached = is_strip_valid_ && level == strip_level_ && covers(strip_ranges_, ranges);
+        if (!frame.is_strip_cached)
+        {
+            if (!is_building_)
+            {
+                next_strip_.clear();
+                next_level_ = level;
+                next_ranges_ = std::move(ranges);
+                next_range_ = 0;
+                next_position_ = next_ranges_.empty() ? 0 : next_ranges_.front().first;
+                is_building_ = true;
+            }
+            build_strip(next_level_ >= 0 ? lod_levels_.at(next_level_).paths : paths_);
+        }
+        stopwatch.lap(frame.conversion);
+
+        const auto& strip = is_strip_valid_ ? strip_ : next_strip_;
+        if (!strip.empty())
+        {
+            target.draw(strip.data(), strip.size(), sf::LineStrip);
+        }
+        stopwatch.lap(frame.submission);
+
+        if (is_profiling_)
+        {
+            frame.vertices = strip.size();
+            profile_.record(frame);
+        }
 
         // DEBUG
         // Draw the sub-bounding boxes.
@@ -118,4 +535,53 @@ namespace procgui
         //     target.draw(rect.data(), rect.size(), sf::Quads);
         // }
     }
+
+    void LSystemView::build_strip(const geometry::Polylines& paths)
+    {
+        TRACE_SCOPE("view", "build_strip");
+        auto start = std::chrono::steady_clock::now();
+        while (next_range_ < next_ranges_.size())
+        {
+            auto range = next_ranges_[next_range_];
+            auto last = std::min(range.second, next_position_ + STRIP_SLICE);
+            geometry::append_line_strip(paths, {next_position_, last}, sf::Color::White, next_strip_);
+            if (last == range.second)
+            {
+                ++next_range_;
+                if (next_range_ < next_ranges_.size())
+                {
+                    next_position_ = next_ranges_[next_range_].first;
+                }
+            }
+            else
+            {
+                // The next slice starts with the last position of this one,
+                // for the segment between them.
+                next_position_ = last - 1;
+            }
+
+            if (std::chrono::steady_clock::now() - start > STRIP_TIME_BUDGET)
+            {
+                return;
+            }
+        }
+
+        std::swap(strip_, next_strip_);
+        next_strip_.clear();
+        strip_level_ = next_level_;
+        strip_ranges_ = std::move(next_ranges_);
+        is_strip_valid_ = true;
+        is_building_ = false;
+    }
+
+    void LSystemView::draw_bounding_box(sf::RenderTarget &target)
+    {
+        std::array<sf::Vertex, 5> box =
+            {{ {{ bounding_box_.left, bounding_box_.top}},
+               {{ bounding_box_.left, bounding_box_.top + bounding_box_.height}},
+               {{ bounding_box_.left + bounding_box_.width, bounding_box_.top + bounding_box_.height}},
+               {{ bounding_box_.left + bounding_box_.width, bounding_box_.top}},
+               {{ bounding_box_.left, bounding_box_.top}}}};
+        target.draw(box.data(), box.size(), sf::LineStrip);
+    }
 }
@@ -2,7 +2,13 @@
 #define LSYSTEM_VIEW
 
 
+#include <chrono>
+#include <memory>
+#include <mutex>
+
 #include "geometry.h"
+#include "MemoryTracker.h"
+#include "ViewProfile.h"
 #include "DrawingParameters.h"
 #include "LSystemBuffer.h"
 #include "InterpretationMapBuffer.h"
@@ -18,11 +24,18 @@ namespace procgui
     //     - The selection of itself by the user and by extension the bounding
     //     boxes.
     //
+    // The vertices are computed in the background by the shared 'ThreadPool'
+    // from snapshots of the LSystem and the InterpretationMap. So several
+    // Views observing the same model are re-computed concurrently. Each result
+    // is applied by the GUI thread at the next 'draw()' call, if it is not
+    // stale.
+    //
     // Invariant:
-    //     - The 'vertices_' must correspond to the 'lsys_buff_',
-    //     'interpretation_buff_', and 'params_'.
-    //     - The 'bounding_box_' and 'sub_boxes_' myst correspond with teh
-    //     'vertices_'.
+    //     - The 'paths_' must correspond to the 'lsys_buff_',
+    //     'interpretation_buff_', and 'params_', once the last requested
+    //     computation is applied.
+    //     - The 'bounding_box_', 'sub_boxes_', 'index_' and 'lod_levels_'
+    //     myst correspond with teh 'paths_'.
     // 
     // Note:
     //    - LSystemView contain a shared ownership of the LSystem and the
@@ -32,6 +45,46 @@ namespace procgui
                         public Observer<drawing::InterpretationMap>
     {
     public:
+        // The paths of a View, with their bounding boxes, index and levels of
+        // detail.
+        struct Geometry
+        {
+            geometry::Polylines paths;
+            sf::FloatRect bounding_box;
+            std::vector<sf::FloatRect> sub_boxes;
+            geometry::SegmentIndex index;
+            std::vector<geometry::LodLevel> lod_levels;
+
+            // The timings of the computation, if it was profiled.
+            ViewProfile::Computation profile;
+
+            // The duration of the whole computation, in seconds, and the
+            // number of symbols of the production interpreted.
+            double compute_time { 0 };
+            std::size_t symbols { 0 };
+        };
+
+        // Compute the Geometry of a snapshot, as a View does. Can be called
+        // from any thread: the session replayer also uses it to measure the
+        // computations of the Views without any window.
+        static Geometry compute_geometry(const LSystem::Snapshot& lsys,
+                                         const drawing::InterpretationMap::Snapshot& map,
+                                         const drawing::DrawingParameters& params,
+                                         bool deduplicate,
+                                         bool profile);
+
+        // Choose the number of iterations of the preview of a computation of
+        // 'n_iter' iterations (see 'request_vertices()'): the deepest one
+        // whose computation is estimated to take less than
+        // 'PREVIEW_TIME_BUDGET'. The cost of a computation is proportional
+        // to the size of its production: the cost of a symbol is measured on
+        // the last computation of the View, which took 'compute_time'
+        // seconds for 'symbols' symbols. The sizes of the iterations not
+        // produced in 'lsys' yet are extrapolated from the last ones
+        // produced. Returns 'n_iter' if no preview is needed.
+        static int preview_iterations(const LSystem::Snapshot& lsys, int n_iter,
+                                      double compute_time, std::size_t symbols);
+
         LSystemView(std::shared_ptr<LSystem> lsys,
                     std::shared_ptr<drawing::InterpretationMap> map,
                     drawing::DrawingParameters param);
@@ -40,17 +93,114 @@ namespace procgui
 
         // Reference Getters
         drawing::DrawingParameters& get_parameters();
+        bool& get_deduplication();
         LSystemBuffer& get_lsystem_buffer();
         InterpretationMapBuffer& get_interpretation_buffer();
+        const sf::FloatRect& get_bounding_box() const;
+        const std::vector<sf::FloatRect>& get_sub_boxes() const;
+
+        // Check if 'position' is inside the hitbox of the View, i.e. one of
+        // its sub-boxes.
+        bool is_inside(const sf::Vector2f& position) const;
+
+        // Find the segment under 'position', at most at a distance of
+        // 'tolerance'. Returns its index in the paths or
+        // 'geometry::SegmentIndex::npos' if there is none.
+        std::size_t find_segment(const sf::Vector2f& position, float tolerance) const;
 
         
         // Compute the vertices of the turtle interpretation of the LSystem.
+        // The computation is done synchronously, on the calling thread.
         void compute_vertices();
 
-        // Draw the vertices.
+        // Request the computation of the vertices to the shared
+        // 'ThreadPool'. The result will be applied by
+        // 'apply_pending_vertices()'. To keep the editing responsive, a
+        // preview with fewer iterations is computed first and applied if it
+        // is ready before the full result, unless 'with_preview' is false.
+        void request_vertices(bool with_preview = true);
+
+        // Apply the result of the last computation if it is ready and not
+        // stale. Returns 'true' if the vertices were modified.
+        bool apply_pending_vertices();
+
+        // Check if a computation finished and its result is not applied yet.
+        bool has_pending_result() const;
+
+        // Check if the last requested computation is not applied yet.
+        bool is_computing() const;
+
+        // Get the duration of the computation of the current vertices, in
+        // seconds.
+        double get_compute_time() const;
+
+        // Check if the conversion of the vertices is sliced across frames and
+        // not finished: the next 'draw()' will continue it.
+        bool is_converting() const;
+
+        // Get the memory used by the View: its geometry, its vertices, its
+        // buffers, and the production snapshot it holds if it is not the
+        // current one of its LSystem (which counts it).
+        MemoryUsage memory_usage() const;
+
+        // Enable or disable the recording of the timings of the computation
+        // and the drawing in the profile. When disabled, the clock is never
+        // read. Enabling it clears the profile.
+        void set_profiling(bool is_enabled);
+        bool is_profiling() const;
+        const ViewProfile& get_profile() const;
+
+        // Set the maximum error, in pixels, of the level of detail drawn. By
+        // default, it is 'LOD_MAX_PIXEL_ERROR': the simplification is not
+        // visible. A higher error draws coarser levels, faster.
+        // Exception:
+        //   - Precondition: 'pixels' is positive.
+        void set_max_pixel_error(float pixels);
+        float get_max_pixel_error() const;
+
+        // Draw the paths. When zoomed out, a simplified level of detail
+        // visually identical at the scale of the 'sf::View' of 'target' is
+        // drawn instead. In both cases, only the ranges of positions visible
+        // in the 'sf::View' are submitted.
         void draw (sf::RenderTarget &target);
+
+        // Draw the global bounding box, to highlight the View.
+        void draw_bounding_box (sf::RenderTarget &target);
+
+        // Display the GUI of the View and re-compute the vertices if the
+        // parameters are modified.
+        void interact();
+        
+    private:
+        // The slot in which the workers publish their result. Its ownership
+        // is shared with the workers, so a View can be destroyed during a
+        // computation.
+        struct PendingGeometry
+        {
+            std::mutex mutex;
+            bool is_ready { false };
+            unsigned long generation { 0 };
+            Geometry geometry;
+        };
+
+        // Replace the current vertices and bounding boxes.
+        void apply(Geometry&& geometry);
+
+        // Continue the conversion of 'paths' into 'next_strip_' for at most
+        // 'STRIP_TIME_BUDGET'. When it is complete, 'next_strip_' replaces
+        // 'strip_'.
+        void build_strip(const geometry::Polylines& paths);
+        
+        // Callbacks of the Observers. Re-compute the vertices only if the
+        // modification described by 'change' affects them.
+        void on_lsystem_change(const Observable::Change& change);
+        void on_interpretation_change(const Observable::Change& change);
+
+        // Check if the iterations up to 'n' of the production of the current
+        // vertices do not contain 'symbol'. Returns 'false' if it is not
+        // known yet.
+        bool production_lacks(char symbol, int n) const;
         
-    private:        
         // The LSystem's buffer and by extension the LSystem (with shared
         // ownership). 
         LSystemBuffer lsys_buff_;
@@ -62,8 +212,16 @@ namespace procgui
         // The DrawingParameters (single Ownership)
         drawing::DrawingParameters params_;
 
-        // The vertices of the View. Computer at each modification.
-        std::vector<sf::Vertex> vertices_;
+        // If true, the duplicated segments of the paths are removed before
+        // the computation of the index and the levels of detail. It is
+        // useful for the L-systems retracing their own lines, at the cost of
+        // a slower computation. The positions are compared on a grid of
+        // 'DEDUPLICATION_QUANTUM' units.
+        static constexpr float DEDUPLICATION_QUANTUM = 1e-2f;
+        bool deduplicate_;
+
+        // The paths of the View. Computer at each modification.
+        geometry::Polylines paths_;
 
         // The global bounding box of the drawing.
         sf::FloatRect bounding_box_;
@@ -72,6 +230,67 @@ namespace procgui
         // if a mouse click select this View.
         static constexpr int MAX_SUB_BOXES = 8;
         std::vector<sf::FloatRect> sub_boxes_;
+
+        // The spatial index of the segments, for the picking and the culling.
+        geometry::SegmentIndex index_;
+
+        // The levels of detail of the paths, from the finest to the
+        // coarsest. A level is drawn if its error is under
+        // 'max_pixel_error_' pixels. The levels use at most
+        // 'LOD_MAX_MEMORY_RATIO' times the memory of the paths.
+        static constexpr float LOD_BASE_TOLERANCE = 0.25f;
+        static constexpr int LOD_MAX_STEPS = 10;
+        static constexpr float LOD_MAX_MEMORY_RATIO = 0.5f;
+        static constexpr float LOD_MAX_PIXEL_ERROR = 0.5f;
+        std::vector<geometry::LodLevel> lod_levels_;
+        float max_pixel_error_;
+
+        // The vertices submitted by 'draw()', converted from 'paths_' or one
+        // of the 'lod_levels_'. They are only converted again if the level of
+        // detail (-1 for 'paths_') or the visible ranges change.
+        std::vector<sf::Vertex> strip_;
+        int strip_level_;
+        std::vector<geometry::SegmentIndex::range> strip_ranges_;
+        bool is_strip_valid_;
+
+        // The vertices being converted, when the conversion of 'strip_' does
+        // not fit in a frame. The conversion is sliced across frames: at each
+        // 'draw()', positions are converted by slices of 'STRIP_SLICE' until
+        // 'STRIP_TIME_BUDGET' is spent. 'next_range_' and 'next_position_'
+        // are the position to convert next.
+        static constexpr std::size_t STRIP_SLICE = 1 << 16;
+        static constexpr std::chrono::milliseconds STRIP_TIME_BUDGET {4};
+        std::vector<sf::Vertex> next_strip_;
+        int next_level_;
+        std::vector<geometry::SegmentIndex::range> next_ranges_;
+        std::size_t next_range_;
+        std::size_t next_position_;
+        bool is_building_;
+
+        // The duration of the computation of 'paths_' and its geometry, and
+        // the number of symbols interpreted.
+        double compute_time_;
+        std::size_t compute_symbols_;
+
+        // The timings of the View, recorded only if 'is_profiling_'.
+        bool is_profiling_;
+        ViewProfile profile_;
+
+        // The snapshot of the LSystem from which the vertices are computed. Its
+        // production is cached, so it is used to check if a modification of
+        // the models affects the vertices.
+        std::shared_ptr<const LSystem::Snapshot> production_;
+
+        // Each computation is identified by a generation. A result older than
+        // the applied one is stale and dropped. A request is identified by two
+        // generations: the preview and the full computation. Before any
+        // measure of the cost of a computation, the preview has
+        // 'DEFAULT_PREVIEW_REDUCTION' iterations less.
+        static constexpr std::chrono::milliseconds PREVIEW_TIME_BUDGET {30};
+        static constexpr int DEFAULT_PREVIEW_REDUCTION = 2;
+        unsigned long requested_generation_;
+        unsigned long applied_generation_;
+        std::shared_ptr<PendingGeometry> pending_;
     };
 }
 
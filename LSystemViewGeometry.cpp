@@ -0,0 +1,105 @@
+#include <algorithm>
+#include <chrono>
+#include "Trace.h"
+#include "LSystemView.h"
+
+// The computations of a LSystemView which do not draw anything: they are
+// shared with the session replayer and the command-line tool, which link
+// without any window or graphics library.
+
+namespace procgui
+{
+    using namespace drawing;
+
+    constexpr std::chrono::milliseconds LSystemView::PREVIEW_TIME_BUDGET;
+
+    LSystemView::Geometry LSystemView::compute_geometry(const LSystem::Snapshot& lsys,
+                                                        const InterpretationMap::Snapshot& map,
+                                                        const DrawingParameters& params,
+                                                        bool deduplicate,
+                                                        bool profile)
+    {
+        TRACE_SCOPE_ARG("view", "compute_geometry", "n_iter", params.n_iter);
+        Geometry geometry;
+        Stopwatch stopwatch (profile);
+        auto start = std::chrono::steady_clock::now();
+
+        // The production is cached in the snapshot: it is done beforehand to
+        // be timed separately from the interpretation.
+        if (profile)
+        {
+            geometry.profile.is_production_cached = lsys.is_produced(params.n_iter);
+            geometry.profile.symbols = lsys.produce(params.n_iter).size();
+            stopwatch.lap(geometry.profile.production);
+        }
+
+        // Invariant respected: cohesion between the paths and the bounding
+        // boxes, computed during the interpretation. 
+        auto result = drawing::compute_paths(lsys, map, params, MAX_SUB_BOXES);
+        stopwatch.lap(geometry.profile.interpretation);
+
+        geometry.paths = deduplicate ?
+            geometry::deduplicate(result.paths, DEDUPLICATION_QUANTUM) :
+            std::move(result.paths);
+        stopwatch.lap(geometry.profile.deduplication);
+
+        geometry.bounding_box = result.bounding_box;
+        geometry.sub_boxes = std::move(result.sub_boxes);
+        geometry.index = geometry::SegmentIndex(geometry.paths);
+        stopwatch.lap(geometry.profile.index);
+
+        auto lod_max_bytes = static_cast<std::size_t>(geometry::memory_usage(geometry.paths) * LOD_MAX_MEMORY_RATIO);
+        geometry.lod_levels = geometry::compute_lod_levels(geometry.paths,
+                                                           LOD_BASE_TOLERANCE,
+                                                           LOD_MAX_STEPS,
+                                                           lod_max_bytes);
+        stopwatch.lap(geometry.profile.lod);
+
+        geometry.profile.vertices = geometry.paths.positions.size();
+        geometry.compute_time = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        geometry.symbols = lsys.produce(params.n_iter).size();
+        return geometry;
+    }
+
+    int LSystemView::preview_iterations(const LSystem::Snapshot& lsys, int n_iter,
+                                        double compute_time, std::size_t symbols)
+    {
+        if (symbols == 0 || compute_time <= 0)
+        {
+            return std::max(0, n_iter - DEFAULT_PREVIEW_REDUCTION);
+        }
+        double seconds_per_symbol = compute_time / symbols;
+        double budget = std::chrono::duration<double>(PREVIEW_TIME_BUDGET).count();
+
+        // Only the cached iterations are read: the GUI thread never waits
+        // for a derivation.
+        double size = 0;
+        double growth = 0;
+        int preview = 0;
+        for (int i = 0; i <= n_iter; ++i)
+        {
+            if (lsys.is_produced(i))
+            {
+                double produced = lsys.produce(i).size();
+                growth = i > 0 && size > 0 ? produced / size : growth;
+                size = produced;
+            }
+            else if (growth > 0)
+            {
+                size *= growth;
+            }
+            else
+            {
+                // The growth of the production is unknown.
+                return std::max(preview, n_iter - DEFAULT_PREVIEW_REDUCTION);
+            }
+
+            if (size * seconds_per_symbol > budget)
+            {
+                break;
+            }
+            preview = i;
+        }
+        return preview;
+    }
+}
@@ -0,0 +1,119 @@
+#include <algorithm>
+
+#include "gsl/gsl"
+
+#include "MemoryTracker.h"
+
+void MemoryUsage::add(const std::string& name, std::size_t bytes)
+{
+    items.push_back({name, bytes});
+}
+
+std::size_t MemoryUsage::total() const
+{
+    std::size_t sum = 0;
+    for (const auto& item : items)
+    {
+        sum += item.bytes;
+    }
+    return sum;
+}
+
+std::size_t heap_bytes(const std::string& str)
+{
+    // A short string is stored inside the object itself, without any
+    // allocation.
+    const char* object = reinterpret_cast<const char*>(&str);
+    if (str.data() >= object && str.data() < object + sizeof(str))
+    {
+        return 0;
+    }
+    return str.capacity() + 1;
+}
+
+
+MemoryTracker::ScopedSource::ScopedSource(MemoryTracker& tracker, const std::string& name, source f)
+    : tracker_ {&tracker}
+    , id_ {tracker.add_source(name, std::move(f))}
+{
+}
+
+MemoryTracker::ScopedSource::ScopedSource(ScopedSource&& other)
+    : tracker_ {other.tracker_}
+    , id_ {other.id_}
+{
+    other.tracker_ = nullptr;
+}
+
+MemoryTracker::ScopedSource::~ScopedSource()
+{
+    if (tracker_)
+    {
+        tracker_->remove_source(id_);
+    }
+}
+
+
+MemoryTracker& MemoryTracker::global()
+{
+    static MemoryTracker tracker;
+    return tracker;
+}
+
+int MemoryTracker::add_source(const std::string& name, source f)
+{
+    Expects(f);
+    std::lock_guard<std::mutex> lock (mutex_);
+    sources_.emplace(next_id_, Source{name, std::move(f), 0});
+    return next_id_++;
+}
+
+void MemoryTracker::remove_source(int id)
+{
+    std::lock_guard<std::mutex> lock (mutex_);
+    Expects(sources_.count(id) > 0);
+    sources_.erase(id);
+}
+
+std::vector<MemoryTracker::Sample> MemoryTracker::sample()
+{
+    std::lock_guard<std::mutex> lock (mutex_);
+
+    std::vector<Sample> samples;
+    std::size_t total = 0;
+    for (auto& entry : sources_)
+    {
+        auto& source = entry.second;
+        auto usage = source.f();
+        source.high_water_mark = std::max(source.high_water_mark, usage.total());
+        total += usage.total();
+        samples.push_back({source.name, std::move(usage), source.high_water_mark});
+    }
+    high_water_mark_ = std::max(high_water_mark_, total);
+    return samples;
+}
+
+std::size_t MemoryTracker::get_high_water_mark() const
+{
+    std::lock_guard<std::mutex> lock (mutex_);
+    return high_water_mark_;
+}
+
+void MemoryTracker::dump(std::ostream& os)
+{
+    auto samples = sample();
+
+    std::size_t total = 0;
+    for (const auto& sample : samples)
+    {
+        os << sample.name << ": " << sample.usage.total() << " bytes"
+           << " (high-water mark: " << sample.high_water_mark << " bytes)\n";
+        for (const auto& item : sample.usage.items)
+        {
+            os << "    " << item.name << ": " << item.bytes << " bytes\n";
+        }
+        total += sample.usage.total();
+    }
+    os << "Total: " << total << " bytes"
+       << " (high-water mark: " << get_high_water_mark() << " bytes)\n";
+}
@@ -0,0 +1,143 @@
+#ifndef MEMORY_TRACKER_H
+#define MEMORY_TRACKER_H
+
+
+#include <functional>
+#include <map>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <vector>
+
+// The memory used by an object, in bytes, broken down by items (the cached
+// iterations of a LSystem, the positions of a LSystemView, ...).
+//
+// The contents of the containers (characters of the strings, elements of the
+// vectors, chunks, ...) are counted exactly, with their unused capacity. The
+// overhead of the nodes of the hash tables and lists is estimated.
+struct MemoryUsage
+{
+    struct Item
+    {
+        std::string name;
+        std::size_t bytes;
+    };
+    std::vector<Item> items;
+
+    // Add the item 'name' of 'bytes' bytes.
+    void add(const std::string& name, std::size_t bytes);
+
+    // Get the sum of the items.
+    std::size_t total() const;
+};
+
+// The number of bytes allocated on the heap by a container, excluding the
+// container itself. The allocations of the other types are not known: they
+// are not counted.
+template<typename T>
+std::size_t heap_bytes(const T&)
+{
+    return 0;
+}
+
+std::size_t heap_bytes(const std::string& str);
+
+template<typename T>
+std::size_t heap_bytes(const std::vector<T>& vector)
+{
+    return vector.capacity() * sizeof(T);
+}
+
+// The estimated size of a node of a hash table or a list holding a 'T'.
+template<typename T>
+constexpr std::size_t node_bytes()
+{
+    return sizeof(T) + 2 * sizeof(void*);
+}
+
+
+// A MemoryTracker aggregates the memory usage of the sources registered by
+// the application, and keeps the high-water marks of each source and of their
+// total.
+//
+// A source is a function returning the current MemoryUsage of an object. It
+// is called by 'sample()': it must be valid until its removal, and is called
+// on the thread calling 'sample()'.
+//
+// The tracker of the whole process is 'global()'. All the functions can be
+// called from any thread.
+class MemoryTracker
+{
+public:
+    using source = std::function<MemoryUsage()>;
+
+    // A measure of a source.
+    struct Sample
+    {
+        std::string name;
+        MemoryUsage usage;
+        std::size_t high_water_mark;
+    };
+
+    // A source removed from its tracker at the destruction of the handle, so
+    // that the tracker does not keep alive the objects captured by the
+    // source after their owner is gone.
+    class ScopedSource
+    {
+    public:
+        ScopedSource(MemoryTracker& tracker, const std::string& name, source f);
+        ScopedSource(ScopedSource&& other);
+        ScopedSource(const ScopedSource&) = delete;
+        ScopedSource& operator=(const ScopedSource&) = delete;
+        ScopedSource& operator=(ScopedSource&&) = delete;
+        ~ScopedSource();
+
+    private:
+        // 'nullptr' if moved from.
+        MemoryTracker* tracker_;
+        int id_;
+    };
+
+    MemoryTracker() = default;
+
+    // The tracker shared by the application.
+    static MemoryTracker& global();
+
+    // Add a source named 'name' and return its identifier.
+    // Exception:
+    //  - Precondition: 'f' must not be a nullptr.
+    int add_source(const std::string& name, source f);
+
+    // Remove the source 'id'. Its high-water mark is forgotten, but it stays
+    // in the total one.
+    // Exception:
+    //  - Precondition: 'id' must be a previously given identifier.
+    void remove_source(int id);
+
+    // Measure all the sources, in the order of their addition, and update
+    // the high-water marks.
+    std::vector<Sample> sample();
+
+    // Get the highest total of all the sources measured by 'sample()'.
+    std::size_t get_high_water_mark() const;
+
+    // Measure all the sources and write a human-readable report of their
+    // usage and high-water marks.
+    void dump(std::ostream& os);
+
+private:
+    struct Source
+    {
+        std::string name;
+        source f;
+        std::size_t high_water_mark;
+    };
+
+    mutable std::mutex mutex_ { };
+    std::map<int, Source> sources_ { };
+    int next_id_ { 0 };
+    std::size_t high_water_mark_ { 0 };
+};
+
+
+#endif // MEMORY_TRACKER_H
@@ -1,26 +1,176 @@
+#include <algorithm>
+
+#include "Trace.h"
 #include "Observable.h"
 
+Observable::Registry::Entry::Entry(callback f, executor ex)
+    : ex {ex}
+    , f_ {f}
+{
+}
+
+void Observable::Registry::Entry::call(const Change& change)
+{
+    {
+        std::lock_guard<std::mutex> lock (mutex_);
+        if (!active_)
+        {
+            return;
+        }
+        callers_.push_back(std::this_thread::get_id());
+    }
+
+    try
+    {
+        TRACE_SCOPE("observable", "callback");
+        f_(change);
+    }
+    catch (...)
+    {
+        end_call();
+        throw;
+    }
+    end_call();
+}
+
+void Observable::Registry::Entry::end_call()
+{
+    std::lock_guard<std::mutex> lock (mutex_);
+    callers_.erase(std::find(callers_.begin(), callers_.end(), std::this_thread::get_id()));
+    idle_.notify_all();
+}
+
+void Observable::Registry::Entry::deactivate()
+{
+    std::unique_lock<std::mutex> lock (mutex_);
+    active_ = false;
+
+    // A callback removing itself does not wait for its own call.
+    auto self = std::this_thread::get_id();
+    idle_.wait(lock, [this, self]()
+               {
+                   return std::all_of(callers_.begin(), callers_.end(),
+                                      [self](std::thread::id id) { return id == self; });
+               });
+}
+
+Observable::Registry::Registry()
+    : entries_ {std::make_shared<const entries>()}
+{
+}
+
+int Observable::Registry::add(callback f, executor ex)
+{
+    std::lock_guard<std::mutex> lock (mutex_);
+
+    auto copy = std::make_shared<entries>(*std::atomic_load(&entries_));
+    (*copy)[id_] = std::make_shared<Entry>(f, ex);
+    std::atomic_store(&entries_, std::shared_ptr<const entries>(copy));
+
+    return id_++;
+}
+
+// Exception:
+//  - Precondition: 'id' must be a previously given identifier.
+void Observable::Registry::remove(int id)
+{
+    std::shared_ptr<Entry> entry;
+    {
+        std::lock_guard<std::mutex> lock (mutex_);
+
+        auto current = std::atomic_load(&entries_);
+        Expects(current->count(id) > 0);
+        entry = current->at(id);
+
+        auto copy = std::make_shared<entries>(*current);
+        copy->erase(id);
+        std::atomic_store(&entries_, std::shared_ptr<const entries>(copy));
+    }
+
+    // Cancel the calls planned by the notifications in progress, and wait for
+    // the running ones. The writers are not serialized meanwhile: a running
+    // callback can add or remove observers.
+    entry->deactivate();
+}
+
+bool Observable::Registry::empty() const
+{
+    return snapshot()->empty();
+}
+
+std::shared_ptr<const Observable::Registry::entries> Observable::Registry::snapshot() const
+{
+    return std::atomic_load(&entries_);
+}
+
+
+Observable::Observable(const Observable& other)
+    : version_ {other.version_.load()}
+    , observers_ {}
+{
+}
+
+Observable& Observable::operator=(const Observable& other)
+{
+    version_ = other.version_.load();
+    return *this;
+}
+
 // Exception:
 //  - Precondition: 'f' must not be a nullptr.
-int Observable::add_observer(callback f)
+int Observable::add_observer(callback f, executor ex)
 {
     Expects(f);
-    observers_[id_] = f;
-    return id_++;
+    return observers_.add(f, ex);
+}
+
+// Exception:
+//  - Precondition: 'f' must not be a nullptr.
+int Observable::add_observer(const simple_callback& f, executor ex)
+{
+    Expects(f);
+    return add_observer([f](const Change&){ f(); }, ex);
 }
 
 // Exception:
 //  - Precondition: 'id' must be a previously given identifier.
 void Observable::remove_observer(int id)
 {
-    Expects(observers_.count(id) > 0);
-    observers_.erase(id);
+    observers_.remove(id);
 }
 
-void Observable::notify() const
+unsigned long Observable::get_version() const
 {
-    for(const auto& p : observers_)
+    return version_;
+}
+
+void Observable::publish(unsigned long)
+{
+}
+
+void Observable::notify(Change::Kind kind, char predecessor)
+{
+    TRACE_SCOPE("observable", "notify");
+    auto old_version = version_.fetch_add(1);
+    Change change { kind, predecessor, old_version, old_version + 1 };
+
+    publish(change.new_version);
+
+    // The snapshot is immutable: observers added or removed by a callback do
+    // not disturb the iteration.
+    const auto entries = observers_.snapshot();
+    // The entries removed by a previous callback of this notification, or
+    // before the execution of their task, are not called.
+    for(const auto& p : *entries)
     {
-        p.second();
+        const auto& entry = p.second;
+        if (entry->ex)
+        {
+            entry->ex([entry, change]() { entry->call(change); });
+        }
+        else
+        {
+            entry->call(change);
+        }
     }
 }
@@ -2,8 +2,14 @@
 #define OBSERVABLE_H
 
 
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
 #include <unordered_map>
 #include <functional>
+#include <vector>
 
 #include "gsl/gsl"
 
@@ -17,35 +23,160 @@
 // In case of simple functions, 'remove_observer()' is not necessary.
 // Every time the child class is modified, 'notify()' must be called to inform
 // the observers of the change.
+//
+// Each notification increments the version of the Observable and sends a
+// 'Change' describing the modification. Observers can use it to skip work that
+// is not affected by the change.
+//
+// Thread-safety: observers can be added and removed from any thread, even
+// during a notification. 'notify()' reads an immutable snapshot of the
+// observers without locking. A callback can be executed on an 'executor' (a
+// thread pool, a queue processed by the GUI thread, ...) instead of inline on
+// the notifying thread.
 class Observable
 {
 public:
+    // The descriptor of a modification sent to the observers.
+    struct Change
+    {
+        // All the kinds of modification currently defined.
+        enum class Kind
+        {
+            UNSPECIFIED,   // Any modification: observers must assume
+                           // everything changed.
+            AXIOM,         // The axiom of a LSystem changed.
+            RULE_ADDED,    // A rule with a new predecessor was added.
+            RULE_CHANGED,  // The successor of an existing rule changed.
+            RULE_REMOVED,  // The rule of a predecessor was removed.
+            RULES_CLEARED, // All the rules were removed.
+        };
+        Kind kind { Kind::UNSPECIFIED };
+
+        // The predecessor of the modified rule for 'RULE_*' kinds, the null
+        // character otherwise.
+        char predecessor { '\0' };
+
+        // The versions of the Observable before and after the modification.
+        unsigned long old_version { 0 };
+        unsigned long new_version { 0 };
+    };
+
     // The type of function called after each 'notify()' call.
-    using callback = std::function<void()>;
+    using callback = std::function<void(const Change&)>;
+
+    // A callback not interested in the descriptor of the modification.
+    using simple_callback = std::function<void()>;
+
+    // An 'executor' runs the task it is given, now or later, on any
+    // thread. A null executor means the callback is called inline.
+    using executor = std::function<void(std::function<void()>)>;
 
     Observable() = default;
+    virtual ~Observable() = default;
+
+    // The observers are not copied: they observe the original object, not the
+    // copy. The version is copied.
+    Observable(const Observable& other);
+    Observable& operator=(const Observable& other);
 
     // Add a callback and return its unique identifier.
+    // If 'ex' is not null, the callback will be executed by 'ex'.
     // Exception:
     //  - Precondition: 'f' must not be a nullptr.
-    int add_observer(callback f);
+    int add_observer(callback f, executor ex = nullptr);
+    int add_observer(const simple_callback& f, executor ex = nullptr);
 
     // Remove a callback by its identifier.
+    // Once removed, the callback is not called anymore, even by a notification
+    // in progress or a task waiting in an executor. The calls already running
+    // on other threads are waited for, so the objects used by the callback
+    // can be destroyed after the removal. A callback can remove itself: its
+    // call on the current thread is not waited for.
     // Exception:
     //  - Precondition: 'id' must be a previously given identifier.
     void remove_observer(int id);
 
+    // Get the current version. It is incremented at each notification.
+    unsigned long get_version() const;
+
 protected:
     // Notify all the observers. Must be called after each modification in the
-    // child class.
-    void notify() const;
+    // child class, with the most precise description of the modification.
+    void notify(Change::Kind kind = Change::Kind::UNSPECIFIED,
+                char predecessor = '\0');
+
+    // Called by 'notify()' with the new version, before the observers are
+    // notified. Child classes can override it to publish a state tagged with
+    // this version.
+    virtual void publish(unsigned long version);
+
+    // The registry of the callbacks, implemented as copy-on-write: each
+    // modification creates a new map of callbacks, published atomically.
+    class Registry
+    {
+    public:
+        // A registered callback. 'active' is reset at its removal to cancel
+        // the calls already planned, and the removal waits for the calls in
+        // progress, whose threads are in 'callers'.
+        class Entry
+        {
+        public:
+            Entry(callback f, executor ex);
+
+            // Call 'f' with 'change' if the entry is still active.
+            void call(const Change& change);
+
+            // Cancel the next calls, and wait for the calls in progress on
+            // the other threads.
+            void deactivate();
+
+            const executor ex;
+
+        private:
+            // Remove the current thread from the 'callers'.
+            void end_call();
+
+            const callback f_;
+            std::mutex mutex_ { };
+            std::condition_variable idle_ { };
+            bool active_ { true };
+            std::vector<std::thread::id> callers_ { };
+        };
+        using entries = std::unordered_map<int, std::shared_ptr<Entry>>;
+
+        Registry();
+
+        // Add an entry and return its identifier.
+        int add(callback f, executor ex);
+
+        // Remove the entry 'id'.
+        // Exception:
+        //  - Precondition: 'id' must be a previously given identifier.
+        void remove(int id);
+
+        // Check if there are not any entry.
+        bool empty() const;
+
+        // Get the current immutable map of entries. Lock-free.
+        std::shared_ptr<const entries> snapshot() const;
+
+    private:
+        // Serialize the writers.
+        std::mutex mutex_;
+
+        // A counter for the identifier of the next entry.
+        int id_ { 0 };
 
+        // The current map of entries. Only accessed with 'std::atomic_load()'
+        // and 'std::atomic_store()'.
+        std::shared_ptr<const entries> entries_;
+    };
 
-    // A counter for the identifier of the next observer.
-    int id_ { 0 };
+    // The version of the Observable.
+    std::atomic<unsigned long> version_ { 0 };
 
-    // The map of all callbacks.
-    std::unordered_map<int, callback> observers_ { };
+    // All the callbacks.
+    Registry observers_ { };
 };
 
 
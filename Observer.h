@@ -62,18 +62,19 @@ public:
     // due to the construction of 'add_callback()', any suitable function could
     // be used of the callback, which is not recommended unless you know what
     // you are doing.
-    void add_callback(const Observable::callback& callback)
+    // The callback may receive the 'Observable::Change' descriptor of the
+    // modification or ignore it. If 'ex' is not null, the callback will be
+    // executed by 'ex' instead of inline on the notifying thread: in this
+    // case, the Observer must outlive the tasks given to 'ex'.
+    void add_callback(const Observable::callback& callback,
+                      const Observable::executor& ex = nullptr)
         {
-            if(id_.second)
-            {
-                target_->remove_observer(id_.first);
-                id_.first = target_->add_observer(callback);
-            }
-            else
-            {
-                id_.first = target_->add_observer(callback);
-                id_.second = true;
-            }
+            register_callback(callback, ex);
+        }
+    void add_callback(const Observable::simple_callback& callback,
+                      const Observable::executor& ex = nullptr)
+        {
+            register_callback(callback, ex);
         }
 
 protected:
@@ -83,6 +84,23 @@ protected:
     // The identifier of the registered callback.
     // If the callback is not defined, the boolean will be false.
     std::pair<int, bool> id_ { -1, false };
+
+private:
+    // Register 'callback' to the target, replacing the previous one.
+    template<typename Callback>
+    void register_callback(const Callback& callback, const Observable::executor& ex)
+        {
+            if(id_.second)
+            {
+                target_->remove_observer(id_.first);
+                id_.first = target_->add_observer(callback, ex);
+            }
+            else
+            {
+                id_.first = target_->add_observer(callback, ex);
+                id_.second = true;
+            }
+        }
 };
 
 
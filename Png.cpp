@@ -0,0 +1,381 @@
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <fstream>
+#include <vector>
+
+#include "gsl/gsl"
+
+#include "Trace.h"
+#include "Png.h"
+
+namespace raster
+{
+    namespace
+    {
+        const std::array<std::uint8_t, 8> signature {{ 0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n' }};
+
+        // The size of the compressed data of an IDAT chunk.
+        constexpr std::size_t IDAT_SIZE = 1 << 16;
+
+        // The bounds of the matches of deflate.
+        constexpr std::size_t MIN_MATCH = 3;
+        constexpr std::size_t MAX_MATCH = 258;
+        constexpr std::size_t MAX_DISTANCE = 32768;
+
+        std::array<std::uint32_t, 256> make_crc_table()
+        {
+            std::array<std::uint32_t, 256> table;
+            for (std::uint32_t n = 0; n < 256; ++n)
+            {
+                std::uint32_t c = n;
+                for (int k = 0; k < 8; ++k)
+                {
+                    c = c & 1 ? 0xedb88320u ^ (c >> 1) : c >> 1;
+                }
+                table[n] = c;
+            }
+            return table;
+        }
+
+        // A code of the fixed Huffman codes of deflate, with its bits already
+        // reversed: the bits are written from the least significant.
+        struct Code
+        {
+            std::uint16_t bits;
+            std::uint8_t length;
+        };
+
+        // A length or a distance of a match: its code, and its extra bits.
+        struct MatchCode
+        {
+            Code code;
+            std::uint16_t extra;
+            std::uint8_t extra_length;
+        };
+
+        std::uint16_t reverse(std::uint16_t bits, int length)
+        {
+            std::uint16_t reversed = 0;
+            for (int i = 0; i < length; ++i)
+            {
+                reversed = (reversed << 1) | ((bits >> i) & 1);
+            }
+            return reversed;
+        }
+
+        // The fixed Huffman code of the literal or length 'symbol'.
+        Code fixed_code(int symbol)
+        {
+            if (symbol < 144)
+            {
+                return { reverse(0x30 + symbol, 8), 8 };
+            }
+            else if (symbol < 256)
+            {
+                return { reverse(0x190 + symbol - 144, 9), 9 };
+            }
+            else if (symbol < 280)
+            {
+                return { reverse(symbol - 256, 7), 7 };
+            }
+            return { reverse(0xc0 + symbol - 280, 8), 8 };
+        }
+
+        struct HuffmanTables
+        {
+            HuffmanTables()
+            {
+                for (int symbol = 0; symbol < 288; ++symbol)
+                {
+                    literals[symbol] = fixed_code(symbol);
+                }
+
+                static const std::array<int, 29> length_bases
+                {{ 3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31,
+                   35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258 }};
+                static const std::array<int, 29> length_extras
+                {{ 0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2,
+                   3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0 }};
+                for (int i = 0; i < 29; ++i)
+                {
+                    int last = i < 28 ? length_bases[i + 1] : length_bases[i] + 1;
+                    for (int length = length_bases[i]; length < last; ++length)
+                    {
+                        lengths[length] = { literals[257 + i],
+                                            static_cast<std::uint16_t>(length - length_bases[i]),
+                                            static_cast<std::uint8_t>(length_extras[i]) };
+                    }
+                }
+            }
+
+            std::array<Code, 288> literals;
+            std::array<MatchCode, MAX_MATCH + 1> lengths;
+        };
+
+        const HuffmanTables& get_huffman_tables()
+        {
+            static const HuffmanTables tables;
+            return tables;
+        }
+
+        // The code of the distance 'distance', from 1 to 'MAX_DISTANCE'.
+        MatchCode distance_code(std::size_t distance)
+        {
+            static const std::array<std::size_t, 30> bases
+            {{ 1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193, 257,
+               385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289,
+               16385, 24577 }};
+            int i = 29;
+            while (bases[i] > distance)
+            {
+                --i;
+            }
+            // The distance codes are all of 5 bits.
+            return { { reverse(i, 5), 5 },
+                     static_cast<std::uint16_t>(distance - bases[i]),
+                     static_cast<std::uint8_t>(i < 4 ? 0 : i / 2 - 1) };
+        }
+
+        void write_u32(std::uint8_t* out, std::uint32_t value)
+        {
+            out[0] = value >> 24;
+            out[1] = value >> 16;
+            out[2] = value >> 8;
+            out[3] = value;
+        }
+
+        void write_chunk(std::ostream& os, const char* type, const std::uint8_t* data, std::size_t size)
+        {
+            std::array<std::uint8_t, 8> header;
+            write_u32(header.data(), static_cast<std::uint32_t>(size));
+            std::memcpy(header.data() + 4, type, 4);
+            auto crc = crc32(header.data() + 4, 4);
+            crc = crc32(data, size, crc);
+            std::array<std::uint8_t, 4> footer;
+            write_u32(footer.data(), crc);
+
+            os.write(reinterpret_cast<const char*>(header.data()), header.size());
+            os.write(reinterpret_cast<const char*>(data), size);
+            os.write(reinterpret_cast<const char*>(footer.data()), footer.size());
+        }
+
+        // A zlib stream of a single deflate block with the fixed Huffman
+        // codes, written in IDAT chunks.
+        class DeflateWriter
+        {
+        public:
+            explicit DeflateWriter(std::ostream& os)
+                : os_ {os}
+                , tables_ {get_huffman_tables()}
+            {
+                buffer_.reserve(IDAT_SIZE + 8);
+                // The zlib header: deflate with a window of 32 KiB, and the
+                // fastest compression.
+                buffer_.push_back(0x78);
+                buffer_.push_back(0x01);
+                // The header of the last block, with the fixed codes.
+                put_bits(1, 1);
+                put_bits(1, 2);
+            }
+
+            void write_literal(std::uint8_t literal)
+            {
+                put_code(tables_.literals[literal]);
+            }
+
+            void write_match(std::size_t length, const MatchCode& distance)
+            {
+                const auto& code = tables_.lengths[length];
+                put_code(code.code);
+                put_bits(code.extra, code.extra_length);
+                put_code(distance.code);
+                put_bits(distance.extra, distance.extra_length);
+            }
+
+            // End the stream with the checksum 'adler' of the uncompressed
+            // data.
+            void finish(std::uint32_t adler)
+            {
+                put_code(tables_.literals[256]);
+                if (n_bits_ > 0)
+                {
+                    buffer_.push_back(static_cast<std::uint8_t>(bits_));
+                    bits_ = 0;
+                    n_bits_ = 0;
+                }
+                std::array<std::uint8_t, 4> checksum;
+                write_u32(checksum.data(), adler);
+                buffer_.insert(buffer_.end(), checksum.begin(), checksum.end());
+                flush();
+            }
+
+        private:
+            void put_code(const Code& code)
+            {
+                put_bits(code.bits, code.length);
+            }
+
+            void put_bits(std::uint32_t bits, unsigned length)
+            {
+                bits_ |= static_cast<std::uint64_t>(bits) << n_bits_;
+                n_bits_ += length;
+                while (n_bits_ >= 8)
+                {
+                    buffer_.push_back(static_cast<std::uint8_t>(bits_));
+                    bits_ >>= 8;
+                    n_bits_ -= 8;
+                }
+                if (buffer_.size() >= IDAT_SIZE)
+                {
+                    flush();
+                }
+            }
+
+            void flush()
+            {
+                write_chunk(os_, "IDAT", buffer_.data(), buffer_.size());
+                buffer_.clear();
+            }
+
+            std::ostream& os_;
+            const HuffmanTables& tables_;
+            std::vector<std::uint8_t> buffer_ { };
+            std::uint64_t bits_ { 0 };
+            unsigned n_bits_ { 0 };
+        };
+
+        // The length of the match of 'data[i]' and 'data[i - distance]', up
+        // to 'max_length'.
+        std::size_t match_length(const std::uint8_t* data, std::size_t i, std::size_t distance, std::size_t max_length)
+        {
+            std::size_t length = 0;
+            while (length < max_length && data[i + length] == data[i + length - distance])
+            {
+                ++length;
+            }
+            return length;
+        }
+    }
+
+    std::uint32_t crc32(const std::uint8_t* data, std::size_t size, std::uint32_t crc)
+    {
+        static const auto table = make_crc_table();
+        std::uint32_t c = crc ^ 0xffffffffu;
+        for (std::size_t i = 0; i < size; ++i)
+        {
+            c = table[(c ^ data[i]) & 0xff] ^ (c >> 8);
+        }
+        return c ^ 0xffffffffu;
+    }
+
+    std::uint32_t adler32(const std::uint8_t* data, std::size_t size, std::uint32_t adler)
+    {
+        // The sums are reduced only every 5552 bytes, the most that can not
+        // overflow them.
+        constexpr std::uint32_t base = 65521;
+        constexpr std::size_t n_max = 5552;
+        std::uint32_t s1 = adler & 0xffff;
+        std::uint32_t s2 = adler >> 16;
+        while (size > 0)
+        {
+            auto n = std::min(size, n_max);
+            size -= n;
+            for (std::size_t i = 0; i < n; ++i)
+            {
+                s1 += data[i];
+                s2 += s1;
+            }
+            data += n;
+            s1 %= base;
+            s2 %= base;
+        }
+        return (s2 << 16) | s1;
+    }
+
+    void write_png(std::ostream& os, const Image& image)
+    {
+        Expects(image.width > 0 && image.height > 0);
+        Expects(image.pixels.size() == static_cast<std::size_t>(image.width) * image.height * 4);
+        TRACE_SCOPE("raster", "write_png");
+
+        os.write(reinterpret_cast<const char*>(signature.data()), signature.size());
+
+        // IHDR: 8 bits per channel, RGBA, no interlacing.
+        std::array<std::uint8_t, 13> header {{ }};
+        write_u32(header.data(), image.width);
+        write_u32(header.data() + 4, image.height);
+        header[8] = 8;
+        header[9] = 6;
+        write_chunk(os, "IHDR", header.data(), header.size());
+
+        // The rows of the filtered image start with their filter type, always
+        // 0 (none). The current and previous rows are contiguous in 'rows', so
+        // a match can refer to the pixel above.
+        const std::size_t stride = static_cast<std::size_t>(image.width) * 4 + 1;
+        std::vector<std::uint8_t> rows (2 * stride);
+        std::uint8_t* row = rows.data() + stride;
+        const auto left = distance_code(4);
+        const bool has_above = stride <= MAX_DISTANCE;
+        const auto above = has_above ? distance_code(stride) : left;
+
+        DeflateWriter deflate (os);
+        std::uint32_t adler = 1;
+        for (unsigned y = 0; y < image.height; ++y)
+        {
+            row[0] = 0;
+            std::memcpy(row + 1, &image.pixels[y * (stride - 1)], stride - 1);
+            adler = adler32(row, stride, adler);
+
+            std::size_t i = 0;
+            while (i < stride)
+            {
+                // The matches end with the row: the next row is not copied
+                // yet.
+                auto max_length = std::min(MAX_MATCH, stride - i);
+                std::size_t length = 0;
+                const MatchCode* distance = nullptr;
+                if (i >= 4)
+                {
+                    length = match_length(row, i, 4, max_length);
+                    distance = &left;
+                }
+                if (has_above && y > 0 && length < max_length)
+                {
+                    auto length_above = match_length(row, i, stride, max_length);
+                    if (length_above > length)
+                    {
+                        length = length_above;
+                        distance = &above;
+                    }
+                }
+
+                if (length >= MIN_MATCH)
+                {
+                    deflate.write_match(length, *distance);
+                    i += length;
+                }
+                else
+                {
+                    deflate.write_literal(row[i]);
+                    ++i;
+                }
+            }
+            std::memcpy(rows.data(), row, stride);
+        }
+        deflate.finish(adler);
+
+        write_chunk(os, "IEND", nullptr, 0);
+    }
+
+    bool save_png(const std::string& path, const Image& image)
+    {
+        std::ofstream file (path, std::ios::binary);
+        if (!file)
+        {
+            return false;
+        }
+        write_png(file, image);
+        return static_cast<bool>(file);
+    }
+}
@@ -0,0 +1,44 @@
+#ifndef PNG_H
+#define PNG_H
+
+
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <string>
+
+#include "Raster.h"
+
+// A minimal PNG encoder for the images of the rasterizer, without any
+// dependency: the images are compressed by a single pass of deflate with the
+// fixed Huffman codes, matching the pixels against the previous pixel and the
+// pixel above. The drawings are mostly uniform backgrounds, which compress
+// well this way, and the encoding is fast enough for print-resolution images.
+namespace raster
+{
+    // Continue the CRC-32 'crc' of the PNG chunks (ISO 3309) with the 'size'
+    // bytes of 'data'.
+    std::uint32_t crc32(const std::uint8_t* data, std::size_t size, std::uint32_t crc = 0);
+
+    // Continue the Adler-32 checksum 'adler' of the zlib streams with the
+    // 'size' bytes of 'data'.
+    std::uint32_t adler32(const std::uint8_t* data, std::size_t size, std::uint32_t adler = 1);
+
+    // Write 'image' as a PNG in 'os', as 8-bit RGBA pixels. The compressed
+    // data is written in chunks of bounded size: the image is never
+    // compressed entirely in memory.
+    // Exception:
+    //   - Precondition: the size of 'image' is not 0, and it has four bytes
+    //   per pixel.
+    void write_png(std::ostream& os, const Image& image);
+
+    // Write 'image' in the PNG file 'path'. Return 'false' if the file could
+    // not be written.
+    // Exception:
+    //   - Precondition: the size of 'image' is not 0, and it has four bytes
+    //   per pixel.
+    bool save_png(const std::string& path, const Image& image);
+}
+
+
+#endif // PNG_H
@@ -0,0 +1,412 @@
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cmath>
+#include <condition_variable>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <numeric>
+
+#include "gsl/gsl"
+
+#include "Trace.h"
+#include "Raster.h"
+
+namespace raster
+{
+    namespace
+    {
+        // A segment in the coordinates of the pixels: the center of the pixel
+        // (i, j) is at (i, j).
+        struct Segment
+        {
+            sf::Vector2f a;
+            sf::Vector2f b;
+        };
+
+        // The transformation from the world to the coordinates of the pixels.
+        class Transform
+        {
+        public:
+            explicit Transform(const RasterParameters& parameters)
+                : left_ {parameters.view.left}
+                , top_ {parameters.view.top}
+                , scale_x_ {parameters.width / parameters.view.width}
+                , scale_y_ {parameters.height / parameters.view.height}
+            {
+            }
+
+            sf::Vector2f operator()(const sf::Vector2f& p) const
+            {
+                return { (p.x - left_) * scale_x_ - 0.5f, (p.y - top_) * scale_y_ - 0.5f };
+            }
+
+        private:
+            float left_, top_, scale_x_, scale_y_;
+        };
+
+        // Call 'f(i, segment)' for each drawn segment 'i' of 'paths', i.e.
+        // from the position 'i' to 'i+1' if 'i+1' is not a break.
+        template<typename F>
+        void for_each_segment(const geometry::Polylines& paths, const Transform& transform, F f)
+        {
+            auto next_break = paths.breaks.begin();
+            std::size_t i = 0;
+            sf::Vector2f previous;
+            for (const auto& chunk : paths.positions.chunks())
+            {
+                for (const auto& position : chunk)
+                {
+                    auto current = transform(position);
+                    bool is_break = next_break != paths.breaks.end() && *next_break == i;
+                    if (is_break)
+                    {
+                        ++next_break;
+                    }
+                    else if (i > 0)
+                    {
+                        f(i - 1, Segment{previous, current});
+                    }
+                    previous = current;
+                    ++i;
+                }
+            }
+        }
+
+        // The tiles of an image.
+        struct Tiling
+        {
+            Tiling(const RasterParameters& parameters)
+                : size {parameters.tile_size}
+                , n_x {(parameters.width + size - 1) / size}
+                , n_y {(parameters.height + size - 1) / size}
+            {
+            }
+
+            unsigned size;
+            unsigned n_x;
+            unsigned n_y;
+        };
+
+        // Call 'f(tile)' for each tile touched by 'segment', the index of the
+        // tile (x, y) being 'y * n_x + x'. The pixels at a distance of one
+        // pixel of the segment are touched by the anti-aliasing.
+        template<typename F>
+        void for_each_tile(const Segment& segment, const Tiling& tiling, F f)
+        {
+            const auto& a = segment.a;
+            const auto& b = segment.b;
+            float min_x = std::min(a.x, b.x) - 1, max_x = std::max(a.x, b.x) + 1;
+            float min_y = std::min(a.y, b.y) - 1, max_y = std::max(a.y, b.y) + 1;
+            float width = tiling.n_x * tiling.size, height = tiling.n_y * tiling.size;
+            if (max_x < 0 || max_y < 0 || min_x >= width || min_y >= height)
+            {
+                return;
+            }
+
+            // The bounds are clamped to the image before their conversion:
+            // the conversion of a float out of the range of 'unsigned' is
+            // undefined.
+            auto first_x = static_cast<unsigned>(std::max(min_x, 0.f)) / tiling.size;
+            auto first_y = static_cast<unsigned>(std::max(min_y, 0.f)) / tiling.size;
+            auto last_x = static_cast<unsigned>(std::min(max_x, width - 1)) / tiling.size;
+            auto last_y = static_cast<unsigned>(std::min(max_y, height - 1)) / tiling.size;
+            bool is_diagonal = first_x != last_x && first_y != last_y;
+
+            for (auto y = first_y; y <= last_y; ++y)
+            {
+                for (auto x = first_x; x <= last_x; ++x)
+                {
+                    if (is_diagonal)
+                    {
+                        // The tiles of the bounding box of a diagonal segment
+                        // are not all crossed: the segment misses a tile if
+                        // all its corners are on the same side of the line.
+                        float left = x * tiling.size - 1.f, right = (x + 1) * tiling.size;
+                        float top = y * tiling.size - 1.f, down = (y + 1) * tiling.size;
+                        auto side = [&a, &b](float cx, float cy)
+                            { return (b.x - a.x) * (cy - a.y) - (b.y - a.y) * (cx - a.x); };
+                        float s1 = side(left, top), s2 = side(right, top);
+                        float s3 = side(left, down), s4 = side(right, down);
+                        if ((s1 > 0 && s2 > 0 && s3 > 0 && s4 > 0) ||
+                            (s1 < 0 && s2 < 0 && s3 < 0 && s4 < 0))
+                        {
+                            continue;
+                        }
+                    }
+                    f(y * tiling.n_x + x);
+                }
+            }
+        }
+
+        // The coverage of the pixels of a tile, from 0 to 255.
+        class TileCoverage
+        {
+        public:
+            TileCoverage(unsigned left, unsigned top, unsigned width, unsigned height)
+                : left_ {static_cast<long>(left)}
+                , top_ {static_cast<long>(top)}
+                , width_ {static_cast<long>(width)}
+                , height_ {static_cast<long>(height)}
+            {
+                // The buffer of each thread is reused between its tiles.
+                thread_local std::vector<std::uint8_t> buffer;
+                buffer.assign(width * height, 0);
+                coverage_ = buffer.data();
+            }
+
+            // Draw 'segment' clipped to the tile, with the algorithm of
+            // Xiaolin Wu if 'antialiasing' is 'true'.
+            void draw(Segment segment, bool antialiasing)
+            {
+                // The segment is walked along its major axis.
+                bool is_steep = std::abs(segment.b.y - segment.a.y) > std::abs(segment.b.x - segment.a.x);
+                if (is_steep)
+                {
+                    std::swap(segment.a.x, segment.a.y);
+                    std::swap(segment.b.x, segment.b.y);
+                }
+                if (segment.a.x > segment.b.x)
+                {
+                    std::swap(segment.a, segment.b);
+                }
+                float dx = segment.b.x - segment.a.x;
+                float gradient = dx > 0 ? (segment.b.y - segment.a.y) / dx : 0.f;
+
+                long first_major = is_steep ? top_ : left_;
+                long last_major = first_major + (is_steep ? height_ : width_) - 1;
+                long first_minor = is_steep ? left_ : top_;
+                long last_minor = first_minor + (is_steep ? width_ : height_) - 1;
+                long first = std::max(to_pixel(segment.a.x, first_major, last_major), first_major);
+                long last = std::min(to_pixel(segment.b.x, first_major, last_major), last_major);
+                for (long major = first; major <= last; ++major)
+                {
+                    float minor = segment.a.y + gradient * (major - segment.a.x);
+                    if (antialiasing)
+                    {
+                        float floor = std::floor(minor);
+                        float fraction = minor - floor;
+                        long pixel = to_pixel(floor, first_minor, last_minor);
+                        plot(is_steep, major, pixel, 1.f - fraction);
+                        plot(is_steep, major, pixel + 1, fraction);
+                    }
+                    else
+                    {
+                        plot(is_steep, major, to_pixel(minor, first_minor, last_minor), 1.f);
+                    }
+                }
+            }
+
+            std::uint8_t at(unsigned x, unsigned y) const
+            {
+                return coverage_[y * width_ + x];
+            }
+
+        private:
+            // Round 'value' to the nearest pixel, clamped to one pixel around
+            // ['first', 'last'] before its conversion: the rounding of a
+            // float out of the range of 'long' is undefined. The pixels out
+            // of the tile are not plotted anyway.
+            static long to_pixel(float value, long first, long last)
+            {
+                float clamped = std::min(std::max(value, first - 2.f), last + 2.f);
+                return std::lround(clamped);
+            }
+
+            // Cover the pixel at ('major', 'minor'), only if it is in the tile.
+            // The overlapping segments do not accumulate: a pixel is as covered
+            // as its most covering segment.
+            void plot(bool is_steep, long major, long minor, float coverage)
+            {
+                long x = (is_steep ? minor : major) - left_;
+                long y = (is_steep ? major : minor) - top_;
+                if (x < 0 || y < 0 || x >= width_ || y >= height_)
+                {
+                    return;
+                }
+                auto value = static_cast<std::uint8_t>(coverage * 255.f + 0.5f);
+                auto& pixel = coverage_[y * width_ + x];
+                pixel = std::max(pixel, value);
+            }
+
+            long left_, top_, width_, height_;
+            std::uint8_t* coverage_;
+        };
+
+        // The state of a parallel rasterization, shared by the tasks of the
+        // pool. The tasks started after the end of the rasterization do not
+        // find any tile to rasterize, and never use 'rasterize_tile'.
+        struct Job
+        {
+            std::size_t n_tiles { 0 };
+            std::function<void(std::size_t)> rasterize_tile { };
+            std::atomic<std::size_t> next_tile { 0 };
+            std::mutex mutex { };
+            std::condition_variable finished { };
+            std::size_t done { 0 };
+        };
+
+        void work(Job& job)
+        {
+            for (auto tile = job.next_tile++; tile < job.n_tiles; tile = job.next_tile++)
+            {
+                job.rasterize_tile(tile);
+                std::lock_guard<std::mutex> lock (job.mutex);
+                if (++job.done == job.n_tiles)
+                {
+                    job.finished.notify_all();
+                }
+            }
+        }
+    }
+
+    sf::FloatRect fit_view(const sf::FloatRect& box, unsigned width, unsigned height, float margin)
+    {
+        Expects(width > 0 && height > 0);
+
+        // The box is enlarged on its smallest dimension relatively to the
+        // aspect ratio of the image.
+        float box_width = std::max(box.width, 1e-6f) * (1 + 2 * margin);
+        float box_height = std::max(box.height, 1e-6f) * (1 + 2 * margin);
+        float ratio = static_cast<float>(width) / height;
+        if (box_width / box_height < ratio)
+        {
+            box_width = box_height * ratio;
+        }
+        else
+        {
+            box_height = box_width / ratio;
+        }
+        float center_x = box.left + box.width / 2;
+        float center_y = box.top + box.height / 2;
+        return { center_x - box_width / 2, center_y - box_height / 2, box_width, box_height };
+    }
+
+    Image rasterize(const geometry::Polylines& paths,
+                    const RasterParameters& parameters,
+                    ThreadPool* pool)
+    {
+        Expects(parameters.width > 0 && parameters.height > 0 && parameters.tile_size > 0);
+        TRACE_SCOPE("raster", "rasterize");
+
+        Image image;
+        image.width = parameters.width;
+        image.height = parameters.height;
+        image.pixels.resize(static_cast<std::size_t>(image.width) * image.height * 4);
+
+        // The segments are binned into the tiles in two passes: the segments
+        // of each tile are counted, then stored contiguously.
+        Transform transform (parameters);
+        Tiling tiling (parameters);
+        std::size_t n_tiles = static_cast<std::size_t>(tiling.n_x) * tiling.n_y;
+        std::vector<std::size_t> offsets (n_tiles + 1, 0);
+        std::vector<std::size_t> bins;
+        {
+            TRACE_SCOPE("raster", "bin");
+            for_each_segment(paths, transform, [&](std::size_t, const Segment& segment)
+                             {
+                                 for_each_tile(segment, tiling, [&offsets](std::size_t tile)
+                                               { ++offsets[tile + 1]; });
+                             });
+            std::partial_sum(offsets.begin(), offsets.end(), offsets.begin());
+            bins.resize(offsets.back());
+            auto next = offsets;
+            for_each_segment(paths, transform, [&](std::size_t i, const Segment& segment)
+                             {
+                                 for_each_tile(segment, tiling, [&next, &bins, i](std::size_t tile)
+                                               { bins[next[tile]++] = i; });
+                             });
+        }
+
+        // The color of a pixel is interpolated from the background to the
+        // color of the lines by its coverage.
+        using Pixel = std::array<std::uint8_t, 4>;
+        std::array<Pixel, 256> palette;
+        {
+            const std::array<int, 4> background
+            {{ parameters.background.r, parameters.background.g,
+               parameters.background.b, parameters.background.a }};
+            const std::array<int, 4> color
+            {{ parameters.color.r, parameters.color.g,
+               parameters.color.b, parameters.color.a }};
+            for (int c = 0; c < 256; ++c)
+            {
+                for (int k = 0; k < 4; ++k)
+                {
+                    palette[c][k] = static_cast<std::uint8_t>(background[k] + ((color[k] - background[k]) * c + 127) / 255);
+                }
+            }
+        }
+
+        auto job = std::make_shared<Job>();
+        job->n_tiles = n_tiles;
+        job->rasterize_tile = [&](std::size_t tile)
+            {
+                unsigned left = (tile % tiling.n_x) * tiling.size;
+                unsigned top = (tile / tiling.n_x) * tiling.size;
+                unsigned width = std::min(tiling.size, image.width - left);
+                unsigned height = std::min(tiling.size, image.height - top);
+                auto row = [&image, left, top](unsigned y)
+                    { return &image.pixels[((static_cast<std::size_t>(top) + y) * image.width + left) * 4]; };
+
+                // Most of the tiles of a large image are empty.
+                if (offsets[tile] == offsets[tile + 1])
+                {
+                    for (unsigned y = 0; y < height; ++y)
+                    {
+                        auto* pixel = row(y);
+                        for (unsigned x = 0; x < width; ++x, pixel += 4)
+                        {
+                            std::memcpy(pixel, palette[0].data(), 4);
+                        }
+                    }
+                    return;
+                }
+
+                // The segments of a tile are in increasing order, mostly in
+                // the same chunk: it is only looked up when they leave it.
+                TileCoverage coverage (left, top, width, height);
+                auto chunk = paths.positions.chunk_of(bins[offsets[tile]]);
+                auto position = [&paths, &chunk](std::size_t i)
+                    {
+                        if (i < chunk.offset || i >= chunk.offset + chunk.size)
+                        {
+                            chunk = paths.positions.chunk_of(i);
+                        }
+                        return chunk.data[i - chunk.offset];
+                    };
+                for (auto bin = offsets[tile]; bin < offsets[tile + 1]; ++bin)
+                {
+                    auto i = bins[bin];
+                    auto a = transform(position(i));
+                    coverage.draw({a, transform(position(i + 1))}, parameters.antialiasing);
+                }
+                for (unsigned y = 0; y < height; ++y)
+                {
+                    auto* pixel = row(y);
+                    for (unsigned x = 0; x < width; ++x, pixel += 4)
+                    {
+                        std::memcpy(pixel, palette[coverage.at(x, y)].data(), 4);
+                    }
+                }
+            };
+
+        {
+            TRACE_SCOPE("raster", "tiles");
+            if (pool)
+            {
+                for (unsigned i = 0; i < pool->size(); ++i)
+                {
+                    pool->submit([job]() { work(*job); });
+                }
+            }
+            work(*job);
+
+            std::unique_lock<std::mutex> lock (job->mutex);
+            job->finished.wait(lock, [&job]() { return job->done == job->n_tiles; });
+        }
+        return image;
+    }
+}
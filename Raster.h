@@ -0,0 +1,75 @@
+#ifndef RASTER_H
+#define RASTER_H
+
+
+#include <cstdint>
+#include <vector>
+
+#include <SFML/Graphics/Rect.hpp>
+
+#include "Color.h"
+#include "geometry.h"
+#include "ThreadPool.h"
+
+// Software rendering of the paths of the turtle, without any window or
+// graphics card, to render thumbnails and print-resolution images on
+// servers.
+namespace raster
+{
+    // An image of 'width' x 'height' pixels, stored row by row from the top,
+    // with four bytes per pixel: red, green, blue, alpha.
+    struct Image
+    {
+        unsigned width { 0 };
+        unsigned height { 0 };
+        std::vector<std::uint8_t> pixels { };
+    };
+
+    // The settings of a rasterization.
+    struct RasterParameters
+    {
+        // The size of the image, in pixels.
+        unsigned width { 512 };
+        unsigned height { 512 };
+
+        // The rectangle of the world drawn in the image, as a 'sf::View'.
+        sf::FloatRect view { 0, 0, 512, 512 };
+
+        // By default, the colors of 'LSystemView::draw()' in the window.
+        Color background { Color::black() };
+        Color color { Color::white() };
+
+        // If 'true', the lines are anti-aliased. Otherwise, they are drawn
+        // with one pixel per column or row, as a 'sf::LineStrip'.
+        bool antialiasing { true };
+
+        // The size of the square tiles rasterized in parallel, in pixels.
+        unsigned tile_size { 128 };
+    };
+
+    // Compute the rectangle of the world centered on 'box', with the aspect
+    // ratio of a 'width' x 'height' image and a margin of 'margin' times its
+    // size on each side.
+    // Exception:
+    //   - Precondition: 'width' and 'height' are not 0.
+    sf::FloatRect fit_view(const sf::FloatRect& box, unsigned width, unsigned height,
+                           float margin = 0.05f);
+
+    // Draw the segments of 'paths' in an image of the size and view of
+    // 'parameters'. The segments crossing a break are not drawn: the turtle
+    // did not draw them (see 'geometry::Polylines').
+    //
+    // The segments are binned into the tiles of the image, and the tiles are
+    // rasterized in parallel by the calling thread and the workers of 'pool'.
+    // The calling thread never waits for a task not started yet, so
+    // 'rasterize()' can be called by a task of 'pool' itself. If 'pool' is a
+    // nullptr, the tiles are rasterized by the calling thread only.
+    // Exception:
+    //   - Precondition: the size of the image and of the tiles is not 0.
+    Image rasterize(const geometry::Polylines& paths,
+                    const RasterParameters& parameters,
+                    ThreadPool* pool = &ThreadPool::shared());
+}
+
+
+#endif // RASTER_H
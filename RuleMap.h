@@ -2,6 +2,7 @@
 #define RULE_MAP_H
 
 
+#include <memory>
 #include <unordered_map>
 
 #include <gsl/gsl>
@@ -15,6 +16,10 @@
 // The rational behind its existence is to complete the classic methods of an
 // unordered_map with the Observable behaviour. Moreover, it is useful has a
 // base class for all '*Buffer' for the GUI.
+//
+// At each modification, RuleMap publishes an immutable snapshot of its rules
+// tagged with its version. A snapshot can be read from any thread without
+// locking, while the RuleMap continues to be modified.
 template<typename Successor>
 class RuleMap : public Observable
 {
@@ -22,6 +27,13 @@ public:
     using successor = Successor;
     using rule = std::pair<char, Successor>;
     using rule_map = std::unordered_map<char, Successor>;
+
+    // An immutable copy of the rules at a given version.
+    struct Snapshot
+    {
+        rule_map rules;
+        unsigned long version;
+    };
     
     RuleMap() = default;
     RuleMap(const rule_map& rules);
@@ -46,6 +58,9 @@ public:
 
     // Get the size
     std::size_t size() const;
+
+    // Get the snapshot of the current version. Thread-safe and lock-free.
+    std::shared_ptr<const Snapshot> get_snapshot() const;
     
     // Add the rule "predecessor -> successor"
     // Note: replace the successor of an existing rule if 'predecessor' has
@@ -61,7 +76,15 @@ public:
     virtual void clear_rules();
 
 protected:
+    // Publish the snapshot of the version 'version'.
+    void publish(unsigned long version) override;
+
     rule_map rules_ = {};
+
+private:
+    // The snapshot of the current version. Only accessed with
+    // 'std::atomic_load()' and 'std::atomic_store()'.
+    std::shared_ptr<const Snapshot> snapshot_ = std::make_shared<const Snapshot>(Snapshot{ {}, 0 });
 };
 
 #include "RuleMap.tpp"
@@ -2,6 +2,7 @@ template<typename Successor>
 RuleMap<Successor>::RuleMap(const rule_map& rules)
     : Observable{}
     , rules_(rules)
+    , snapshot_{std::make_shared<const Snapshot>(Snapshot{ rules_, 0 })}
 {
 }
 
@@ -9,6 +10,7 @@ template<typename Successor>
 RuleMap<Successor>::RuleMap(std::initializer_list<typename rule_map::value_type> init)
     : Observable{}
     , rules_{init}
+    , snapshot_{std::make_shared<const Snapshot>(Snapshot{ rules_, 0 })}
 {
 }
 
@@ -43,12 +45,25 @@ std::size_t RuleMap<Successor>::size() const
     return rules_.size();
 }
 
+template<typename Successor>
+std::shared_ptr<const typename RuleMap<Successor>::Snapshot> RuleMap<Successor>::get_snapshot() const
+{
+    return std::atomic_load(&snapshot_);
+}
+
+template<typename Successor>
+void RuleMap<Successor>::publish(unsigned long version)
+{
+    std::atomic_store(&snapshot_, std::make_shared<const Snapshot>(Snapshot{ rules_, version }));
+}
+
 
 template<typename Successor>
 void RuleMap<Successor>::add_rule(char predecessor, const Successor& successor)
 {
+    auto kind = has_predecessor(predecessor) ? Change::Kind::RULE_CHANGED : Change::Kind::RULE_ADDED;
     rules_[predecessor] = successor;
-    notify();
+    notify(kind, predecessor);
 }
 
 template<typename Successor>
@@ -58,12 +73,12 @@ void RuleMap<Successor>::remove_rule(char predecessor)
     Expects(rule != rules_.end());
 
     rules_.erase(rule);
-    notify();
+    notify(Change::Kind::RULE_REMOVED, predecessor);
 }
 
 template<typename Successor>
 void RuleMap<Successor>::clear_rules()
 {
     rules_.clear();
-    notify();
+    notify(Change::Kind::RULES_CLEARED);
 }            
@@ -9,6 +9,7 @@
 #include "Observer.h"
 #include "LSystem.h"
 #include "helper_algorithm.h"
+#include "MemoryTracker.h"
 
 namespace procgui
 {
@@ -102,6 +103,9 @@ namespace procgui
         // Get the number of rules.
         size_t size() const;
 
+        // Get the number of bytes allocated for the rules of the buffer.
+        std::size_t memory_usage() const;
+
         // Add an empty rule: a scratch buffer.
         // Do not forget to override it if there is not a default initialization
         // for the successor.
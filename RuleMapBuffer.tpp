@@ -65,6 +65,17 @@ size_t RuleMapBuffer<Target>::size() const
     return buffer_.size();
 }
 
+template<typename Target>
+std::size_t RuleMapBuffer<Target>::memory_usage() const
+{
+    std::size_t bytes = 0;
+    for (const auto& rule : buffer_)
+    {
+        bytes += node_bytes<Rule>() + heap_bytes(rule.successor);
+    }
+    return bytes;
+}
+
 
 template<typename Target>
 typename RuleMapBuffer<Target>::iterator RuleMapBuffer<Target>::remove_const(const_iterator cit)
@@ -0,0 +1,138 @@
+#include "MemoryTracker.h"
+#include "Scene.h"
+
+namespace procgui
+{
+    LSystemView& Scene::add_view(std::shared_ptr<LSystem> lsys,
+                                 std::shared_ptr<drawing::InterpretationMap> map,
+                                 drawing::DrawingParameters params)
+    {
+        auto view = std::make_unique<LSystemView>(lsys, map, params);
+        const LSystemView* tracked = view.get();
+        int memory_source = MemoryTracker::global().add_source(
+            "View " + std::to_string(entries_.size()),
+            [tracked]() { return tracked->memory_usage(); });
+        entries_.push_back({ std::move(view), false, true, memory_source });
+        return *entries_.back().view;
+    }
+
+    Scene::~Scene()
+    {
+        for (const auto& entry : entries_)
+        {
+            MemoryTracker::global().remove_source(entry.memory_source);
+        }
+    }
+
+    std::size_t Scene::size() const
+    {
+        return entries_.size();
+    }
+
+    Scene::Hit Scene::pick(const sf::Vector2f& position, float tolerance) const
+    {
+        // The last Views are drawn on top of the others, so they have the
+        // priority.
+        for (auto it = entries_.rbegin(); it != entries_.rend(); ++it)
+        {
+            auto segment = it->view->find_segment(position, tolerance);
+            if (segment != geometry::SegmentIndex::npos)
+            {
+                return { it->view.get(), segment };
+            }
+        }
+        return { nullptr, geometry::SegmentIndex::npos };
+    }
+
+    bool Scene::select_at(const sf::Vector2f& position, float tolerance)
+    {
+        selected_ = -1;
+        auto hit = pick(position, tolerance);
+        for (std::size_t i = 0; i < entries_.size(); ++i)
+        {
+            if (entries_.at(i).view.get() == hit.view)
+            {
+                selected_ = i;
+            }
+        }
+        return selected_ >= 0;
+    }
+
+    LSystemView* Scene::get_selected() const
+    {
+        if (selected_ < 0)
+        {
+            return nullptr;
+        }
+        return entries_.at(selected_).view.get();
+    }
+
+    void Scene::draw(sf::RenderTarget& target)
+    {
+        auto view_rect = geometry::compute_view_rect(target.getView());
+        bool view_changed = view_rect != view_rect_;
+        view_rect_ = view_rect;
+
+        visible_count_ = 0;
+        for (auto& entry : entries_)
+        {
+            auto& view = *entry.view;
+            
+            // Apply the vertices computed in the background.
+            entry.is_dirty |= view.apply_pending_vertices();
+
+            // Update the visibility only if necessary.
+            if (view_changed || entry.is_dirty)
+            {
+                entry.is_visible = geometry::intersects(view.get_bounding_box(), view_rect_);
+                entry.is_dirty = false;
+            }
+
+            if (entry.is_visible)
+            {
+                view.draw(target);
+                ++visible_count_;
+            }
+        }
+
+        // The selected View is highlighted, even when it is not visible.
+        if (auto selected = get_selected())
+        {
+            selected->draw_bounding_box(target);
+        }
+        drawn_selected_ = selected_;
+    }
+
+    void Scene::interact()
+    {
+        // The selected View is interactive, even when it is not visible.
+        if (auto selected = get_selected())
+        {
+            selected->interact();
+        }
+    }
+
+    bool Scene::needs_redraw(const sf::View& view) const
+    {
+        if (geometry::compute_view_rect(view) != view_rect_ || selected_ != drawn_selected_)
+        {
+            return true;
+        }
+        for (const auto& entry : entries_)
+        {
+            // An invisible View does not continue its conversion.
+            if (entry.is_dirty ||
+                entry.view->has_pending_result() ||
+                (entry.is_visible && entry.view->is_converting()))
+            {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    std::size_t Scene::get_visible_count() const
+    {
+        return visible_count_;
+    }
+}
@@ -0,0 +1,109 @@
+#ifndef SCENE_H
+#define SCENE_H
+
+
+#include <memory>
+#include <vector>
+
+#include "LSystemView.h"
+
+namespace procgui
+{
+    // A Scene owns a collection of LSystemViews and manages their display.
+    //
+    // To keep the frame time flat with hundreds of Views, a Scene:
+    //     - only draws the Views whose bounding box is visible in the current
+    //     'sf::View' of the target,
+    //     - only displays the GUI of the selected View,
+    //     - only re-computes the visibility of a View when its vertices or the
+    //     'sf::View' changed,
+    //     - tells when it needs to be drawn again, so a static Scene can be
+    //     drawn once and cached.
+    class Scene
+    {
+    public:
+        Scene() = default;
+
+        // The Views are removed from the 'MemoryTracker'.
+        ~Scene();
+
+        // The LSystemViews register callbacks bound to their address, so they
+        // are owned through pointers and a Scene can not be copied.
+        Scene(const Scene& other) = delete;
+        Scene& operator=(const Scene& other) = delete;
+
+        // Construct a new LSystemView in the Scene and return it. Its memory
+        // usage is tracked by the global 'MemoryTracker'.
+        LSystemView& add_view(std::shared_ptr<LSystem> lsys,
+                              std::shared_ptr<drawing::InterpretationMap> map,
+                              drawing::DrawingParameters params);
+
+        // Get the number of Views.
+        std::size_t size() const;
+
+        // The result of a pick: a View and the index of one of its segments.
+        struct Hit
+        {
+            LSystemView* view;
+            std::size_t segment;
+        };
+
+        // Find the View and its segment under 'position' (in world
+        // coordinates), at most at a distance of 'tolerance'. If several
+        // Views are under 'position', the one drawn on top, i.e. the last
+        // added, is picked. If there are not any, 'view' is 'nullptr'.
+        Hit pick(const sf::Vector2f& position, float tolerance) const;
+
+        // Select the View picked at 'position'. If there are not any, deselect
+        // the current View. Returns 'true' if a View is selected.
+        bool select_at(const sf::Vector2f& position, float tolerance);
+
+        // Get the selected View, 'nullptr' if there is none.
+        LSystemView* get_selected() const;
+
+        // Draw the visible Views, and highlight the selected one.
+        void draw(sf::RenderTarget& target);
+
+        // Display the GUI of the selected View.
+        void interact();
+
+        // Check if drawing the Scene with 'view' would differ from the last
+        // 'draw()': the 'sf::View' or the selection changed, a View was
+        // added, a View has a new result to apply, or a visible View is
+        // still converting its vertices.
+        bool needs_redraw(const sf::View& view) const;
+
+        // Get the number of Views drawn during the last 'draw()' call.
+        std::size_t get_visible_count() const;
+
+    private:
+        struct Entry
+        {
+            std::unique_ptr<LSystemView> view;
+
+            // Visibility of the View in the last 'sf::View'.
+            bool is_visible;
+
+            // 'true' if the vertices changed since the last visibility check.
+            bool is_dirty;
+
+            // The identifier of the View in the 'MemoryTracker'.
+            int memory_source;
+        };
+
+        std::vector<Entry> entries_ {};
+
+        // The index of the selected View, -1 if none, and the one during the
+        // last 'draw()'.
+        int selected_ { -1 };
+        int drawn_selected_ { -1 };
+
+        // The rectangle of the world seen during the last 'draw()'.
+        sf::FloatRect view_rect_ {};
+
+        std::size_t visible_count_ { 0 };
+    };
+}
+
+
+#endif // SCENE_H
@@ -0,0 +1,719 @@
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <limits>
+#include <sstream>
+#include <stdexcept>
+
+#include "gsl/gsl"
+
+#include "Turtle.h"
+#include "LSystemView.h"
+#include "Session.h"
+
+using namespace drawing;
+
+namespace
+{
+    const std::string header = "procgen-session 1";
+
+    // The orders and their names in a session.
+    struct NamedOrder
+    {
+        const Order* order;
+        const char* name;
+    };
+    const std::array<NamedOrder, 5> named_orders
+    {{ { &go_forward,    "go_forward" },
+       { &turn_right,    "turn_right" },
+       { &turn_left,     "turn_left" },
+       { &save_position, "save_position" },
+       { &load_position, "load_position" } }};
+
+    // Find the order 'id'. Returns 'nullptr' if there is none.
+    const NamedOrder* find_order(OrderID id)
+    {
+        auto order = std::find_if(named_orders.begin(), named_orders.end(),
+                                  [id](const auto& o) { return o.order->id == id; });
+        return order != named_orders.end() ? &*order : nullptr;
+    }
+
+    // Find the order named 'name'. Returns 'nullptr' if there is none.
+    const NamedOrder* find_order(const std::string& name)
+    {
+        auto order = std::find_if(named_orders.begin(), named_orders.end(),
+                                  [&name](const auto& o) { return name == o.name; });
+        return order != named_orders.end() ? &*order : nullptr;
+    }
+
+    // Read the rest of the line after the separating space.
+    std::string read_rest(std::istringstream& line)
+    {
+        if (line.peek() == ' ')
+        {
+            line.get();
+        }
+        std::string rest;
+        std::getline(line, rest);
+        return rest;
+    }
+
+    // Parse a line of a session, without its time.
+    // Exception:
+    //   - Throws 'std::runtime_error' if the line is malformed.
+    SessionEvent parse_event(std::istringstream& line)
+    {
+        using Kind = SessionEvent::Kind;
+
+        SessionEvent event;
+        std::string model, action;
+        if (!(line >> model >> event.target))
+        {
+            throw std::runtime_error("missing model");
+        }
+
+        if (model == "view")
+        {
+            event.kind = Kind::VIEW;
+            line >> event.lsystem >> event.interpretation;
+        }
+        else if (model == "parameters")
+        {
+            event.kind = Kind::PARAMETERS;
+            auto& parameters = event.parameters;
+            line >> parameters.starting_position.x >> parameters.starting_position.y
+                 >> parameters.starting_angle >> parameters.delta_angle
+                 >> parameters.step >> parameters.n_iter;
+        }
+        else if (model == "lsystem" || model == "interpretation")
+        {
+            bool is_lsystem = model == "lsystem";
+            line >> action;
+            if (action == "axiom" && is_lsystem)
+            {
+                event.kind = Kind::AXIOM;
+                event.symbols = read_rest(line);
+            }
+            else if (action == "rule" || action == "remove")
+            {
+                line >> event.predecessor;
+                if (action == "remove")
+                {
+                    event.kind = is_lsystem ? Kind::REMOVE_RULE : Kind::REMOVE_ORDER;
+                }
+                else if (is_lsystem)
+                {
+                    event.kind = Kind::RULE;
+                    event.symbols = read_rest(line);
+                }
+                else
+                {
+                    std::string name;
+                    line >> name;
+                    const auto* order = find_order(name);
+                    if (!order)
+                    {
+                        throw std::runtime_error("unknown order '" + name + "'");
+                    }
+                    event.kind = Kind::ORDER;
+                    event.order = order->order->id;
+                }
+            }
+            else if (action == "clear")
+            {
+                event.kind = is_lsystem ? Kind::CLEAR_RULES : Kind::CLEAR_ORDERS;
+            }
+            else
+            {
+                throw std::runtime_error("unknown action '" + action + "'");
+            }
+        }
+        else
+        {
+            throw std::runtime_error("unknown model '" + model + "'");
+        }
+
+        if (line.fail())
+        {
+            throw std::runtime_error("missing argument");
+        }
+        return event;
+    }
+}
+
+std::string get_order_name(OrderID id)
+{
+    const auto* order = find_order(id);
+    Expects(order);
+    return order->name;
+}
+
+Order get_order(const std::string& name)
+{
+    const auto* order = find_order(name);
+    Expects(order);
+    return *order->order;
+}
+
+std::string get_kind_name(SessionEvent::Kind kind)
+{
+    using Kind = SessionEvent::Kind;
+    switch (kind)
+    {
+    case Kind::AXIOM:        return "axiom";
+    case Kind::RULE:         return "rule";
+    case Kind::REMOVE_RULE:  return "remove_rule";
+    case Kind::CLEAR_RULES:  return "clear_rules";
+    case Kind::ORDER:        return "order";
+    case Kind::REMOVE_ORDER: return "remove_order";
+    case Kind::CLEAR_ORDERS: return "clear_orders";
+    case Kind::VIEW:         return "view";
+    case Kind::PARAMETERS:   return "parameters";
+    }
+    return "";
+}
+
+void write_event(std::ostream& os, const SessionEvent& event)
+{
+    using Kind = SessionEvent::Kind;
+
+    // The parameters are written with enough digits to be read back exactly.
+    auto precision = os.precision(std::numeric_limits<double>::max_digits10);
+    os << event.time << ' ';
+    switch (event.kind)
+    {
+    case Kind::AXIOM:
+        os << "lsystem " << event.target << " axiom " << event.symbols;
+        break;
+    case Kind::RULE:
+        os << "lsystem " << event.target << " rule " << event.predecessor << ' ' << event.symbols;
+        break;
+    case Kind::REMOVE_RULE:
+        os << "lsystem " << event.target << " remove " << event.predecessor;
+        break;
+    case Kind::CLEAR_RULES:
+        os << "lsystem " << event.target << " clear";
+        break;
+    case Kind::ORDER:
+        os << "interpretation " << event.target << " rule " << event.predecessor << ' '
+           << get_order_name(event.order);
+        break;
+    case Kind::REMOVE_ORDER:
+        os << "interpretation " << event.target << " remove " << event.predecessor;
+        break;
+    case Kind::CLEAR_ORDERS:
+        os << "interpretation " << event.target << " clear";
+        break;
+    case Kind::VIEW:
+        os << "view " << event.target << ' ' << event.lsystem << ' ' << event.interpretation;
+        break;
+    case Kind::PARAMETERS:
+    {
+        const auto& parameters = event.parameters;
+        os << "parameters " << event.target << ' '
+           << parameters.starting_position.x << ' ' << parameters.starting_position.y << ' '
+           << parameters.starting_angle << ' ' << parameters.delta_angle << ' '
+           << parameters.step << ' ' << parameters.n_iter;
+        break;
+    }
+    }
+    os << '\n';
+    os.precision(precision);
+}
+
+std::vector<SessionEvent> read_session(std::istream& is)
+{
+    std::string line;
+    if (!std::getline(is, line) || line != header)
+    {
+        throw std::runtime_error("Not a session: the header is not '" + header + "'");
+    }
+
+    std::vector<SessionEvent> events;
+    int line_number = 1;
+    while (std::getline(is, line))
+    {
+        ++line_number;
+        if (line.empty() || line.front() == '#')
+        {
+            continue;
+        }
+
+        std::istringstream stream (line);
+        double time;
+        if (!(stream >> time))
+        {
+            throw std::runtime_error("Line " + std::to_string(line_number) + ": missing time");
+        }
+        try
+        {
+            events.push_back(parse_event(stream));
+        }
+        catch (const std::runtime_error& e)
+        {
+            throw std::runtime_error("Line " + std::to_string(line_number) + ": " + e.what());
+        }
+        events.back().time = time;
+    }
+    return events;
+}
+
+
+void SessionState::apply(const SessionEvent& event)
+{
+    using Kind = SessionEvent::Kind;
+    switch (event.kind)
+    {
+    case Kind::AXIOM:
+        get_lsystem(event.target).set_axiom(event.symbols);
+        break;
+    case Kind::RULE:
+        get_lsystem(event.target).add_rule(event.predecessor, event.symbols);
+        break;
+    case Kind::REMOVE_RULE:
+        get_lsystem(event.target).remove_rule(event.predecessor);
+        break;
+    case Kind::CLEAR_RULES:
+        get_lsystem(event.target).clear_rules();
+        break;
+    case Kind::ORDER:
+    {
+        const auto* order = find_order(event.order);
+        Expects(order);
+        get_interpretation(event.target).add_rule(event.predecessor, *order->order);
+        break;
+    }
+    case Kind::REMOVE_ORDER:
+        get_interpretation(event.target).remove_rule(event.predecessor);
+        break;
+    case Kind::CLEAR_ORDERS:
+        get_interpretation(event.target).clear_rules();
+        break;
+    case Kind::VIEW:
+    {
+        get_lsystem(event.lsystem);
+        get_interpretation(event.interpretation);
+        auto& view = views[event.target];
+        view.lsystem = event.lsystem;
+        view.interpretation = event.interpretation;
+        break;
+    }
+    case Kind::PARAMETERS:
+        Expects(views.count(event.target) > 0);
+        views.at(event.target).parameters = event.parameters;
+        break;
+    }
+}
+
+bool SessionState::is_affected(int id, const SessionEvent& event) const
+{
+    using Kind = SessionEvent::Kind;
+
+    auto view = views.find(id);
+    if (view == views.end())
+    {
+        return false;
+    }
+    switch (event.kind)
+    {
+    case Kind::AXIOM:
+    case Kind::RULE:
+    case Kind::REMOVE_RULE:
+    case Kind::CLEAR_RULES:
+        return view->second.lsystem == event.target;
+    case Kind::ORDER:
+    case Kind::REMOVE_ORDER:
+    case Kind::CLEAR_ORDERS:
+        return view->second.interpretation == event.target;
+    case Kind::VIEW:
+    case Kind::PARAMETERS:
+        return id == event.target;
+    }
+    return false;
+}
+
+LSystem& SessionState::get_lsystem(int id)
+{
+    auto& lsys = lsystems[id];
+    if (!lsys)
+    {
+        lsys = std::make_shared<LSystem>();
+    }
+    return *lsys;
+}
+
+InterpretationMap& SessionState::get_interpretation(int id)
+{
+    auto& map = interpretations[id];
+    if (!map)
+    {
+        map = std::make_shared<InterpretationMap>();
+    }
+    return *map;
+}
+
+
+SessionRecorder::~SessionRecorder()
+{
+    stop();
+}
+
+int SessionRecorder::add_lsystem(std::shared_ptr<LSystem> lsys)
+{
+    Expects(lsys);
+    lsystems_.push_back(std::move(lsys));
+    return lsystems_.size() - 1;
+}
+
+int SessionRecorder::add_interpretation(std::shared_ptr<InterpretationMap> map)
+{
+    Expects(map);
+    interpretations_.push_back(std::move(map));
+    return interpretations_.size() - 1;
+}
+
+int SessionRecorder::add_view(int lsystem, int interpretation, const DrawingParameters& parameters)
+{
+    Expects(lsystem >= 0 && lsystem < static_cast<int>(lsystems_.size()));
+    Expects(interpretation >= 0 && interpretation < static_cast<int>(interpretations_.size()));
+    views_.push_back({lsystem, interpretation, parameters});
+    return views_.size() - 1;
+}
+
+void SessionRecorder::start(std::ostream& os)
+{
+    Expects(!is_recording());
+
+    os_ = &os;
+    start_ = std::chrono::steady_clock::now();
+    size_ = 0;
+    os << header << '\n';
+
+    // The initial state, at the time 0.
+    for (std::size_t i = 0; i < lsystems_.size(); ++i)
+    {
+        record_lsystem(i);
+        lsystem_observers_.push_back(
+            lsystems_[i]->add_observer([this, i](const Observable::Change& change)
+                                       { on_lsystem_change(i, change); }));
+    }
+    for (std::size_t i = 0; i < interpretations_.size(); ++i)
+    {
+        record_interpretation(i);
+        interpretation_observers_.push_back(
+            interpretations_[i]->add_observer([this, i](const Observable::Change& change)
+                                              { on_interpretation_change(i, change); }));
+    }
+    for (std::size_t i = 0; i < views_.size(); ++i)
+    {
+        SessionEvent view;
+        view.kind = SessionEvent::Kind::VIEW;
+        view.target = i;
+        view.lsystem = views_[i].lsystem;
+        view.interpretation = views_[i].interpretation;
+        record(view);
+
+        SessionEvent parameters;
+        parameters.kind = SessionEvent::Kind::PARAMETERS;
+        parameters.target = i;
+        parameters.parameters = views_[i].parameters;
+        record(parameters);
+    }
+}
+
+bool SessionRecorder::start(const std::string& path)
+{
+    Expects(!is_recording());
+
+    file_.open(path);
+    if (!file_)
+    {
+        return false;
+    }
+    start(file_);
+    return true;
+}
+
+void SessionRecorder::stop()
+{
+    if (!is_recording())
+    {
+        return;
+    }
+    for (std::size_t i = 0; i < lsystem_observers_.size(); ++i)
+    {
+        lsystems_[i]->remove_observer(lsystem_observers_[i]);
+    }
+    for (std::size_t i = 0; i < interpretation_observers_.size(); ++i)
+    {
+        interpretations_[i]->remove_observer(interpretation_observers_[i]);
+    }
+    lsystem_observers_.clear();
+    interpretation_observers_.clear();
+
+    os_->flush();
+    os_ = nullptr;
+    if (file_.is_open())
+    {
+        file_.close();
+    }
+}
+
+bool SessionRecorder::is_recording() const
+{
+    return os_ != nullptr;
+}
+
+void SessionRecorder::record_parameters(int view, const DrawingParameters& parameters)
+{
+    Expects(view >= 0 && view < static_cast<int>(views_.size()));
+
+    auto& last = views_[view].parameters;
+    if (parameters.starting_position == last.starting_position &&
+        parameters.starting_angle == last.starting_angle &&
+        parameters.delta_angle == last.delta_angle &&
+        parameters.step == last.step &&
+        parameters.n_iter == last.n_iter)
+    {
+        return;
+    }
+    last = parameters;
+
+    if (is_recording())
+    {
+        SessionEvent event;
+        event.kind = SessionEvent::Kind::PARAMETERS;
+        event.target = view;
+        event.parameters = parameters;
+        record(event);
+    }
+}
+
+std::size_t SessionRecorder::get_size() const
+{
+    return size_;
+}
+
+void SessionRecorder::record(SessionEvent event)
+{
+    event.time = std::chrono::duration<double>(std::chrono::steady_clock::now() - start_).count();
+    write_event(*os_, event);
+    ++size_;
+}
+
+void SessionRecorder::on_lsystem_change(int id, const Observable::Change& change)
+{
+    using Kind = Observable::Change::Kind;
+
+    const auto& lsys = *lsystems_[id];
+    SessionEvent event;
+    event.target = id;
+    event.predecessor = change.predecessor;
+    switch (change.kind)
+    {
+    case Kind::AXIOM:
+        event.kind = SessionEvent::Kind::AXIOM;
+        event.symbols = lsys.get_axiom();
+        break;
+    case Kind::RULE_ADDED:
+    case Kind::RULE_CHANGED:
+        event.kind = SessionEvent::Kind::RULE;
+        event.symbols = lsys.get_rules().at(change.predecessor);
+        break;
+    case Kind::RULE_REMOVED:
+        event.kind = SessionEvent::Kind::REMOVE_RULE;
+        break;
+    case Kind::RULES_CLEARED:
+        event.kind = SessionEvent::Kind::CLEAR_RULES;
+        break;
+    case Kind::UNSPECIFIED:
+        // Anything may have changed: the whole state is recorded.
+        record_lsystem(id);
+        return;
+    }
+    record(event);
+}
+
+void SessionRecorder::on_interpretation_change(int id, const Observable::Change& change)
+{
+    using Kind = Observable::Change::Kind;
+
+    const auto& map = *interpretations_[id];
+    SessionEvent event;
+    event.target = id;
+    event.predecessor = change.predecessor;
+    switch (change.kind)
+    {
+    case Kind::RULE_ADDED:
+    case Kind::RULE_CHANGED:
+        event.kind = SessionEvent::Kind::ORDER;
+        event.order = map.get_rules().at(change.predecessor).id;
+        break;
+    case Kind::RULE_REMOVED:
+        event.kind = SessionEvent::Kind::REMOVE_ORDER;
+        break;
+    case Kind::RULES_CLEARED:
+        event.kind = SessionEvent::Kind::CLEAR_ORDERS;
+        break;
+    case Kind::AXIOM:
+    case Kind::UNSPECIFIED:
+        record_interpretation(id);
+        return;
+    }
+    record(event);
+}
+
+void SessionRecorder::record_lsystem(int id)
+{
+    const auto& lsys = *lsystems_[id];
+
+    SessionEvent event;
+    event.target = id;
+    event.kind = SessionEvent::Kind::CLEAR_RULES;
+    record(event);
+
+    event.kind = SessionEvent::Kind::AXIOM;
+    event.symbols = lsys.get_axiom();
+    record(event);
+
+    // The rules are sorted, so that the sessions are deterministic.
+    std::map<char, std::string> rules (lsys.get_rules().begin(), lsys.get_rules().end());
+    event.kind = SessionEvent::Kind::RULE;
+    for (const auto& rule : rules)
+    {
+        event.predecessor = rule.first;
+        event.symbols = rule.second;
+        record(event);
+    }
+}
+
+void SessionRecorder::record_interpretation(int id)
+{
+    const auto& map = *interpretations_[id];
+
+    SessionEvent event;
+    event.target = id;
+    event.kind = SessionEvent::Kind::CLEAR_ORDERS;
+    record(event);
+
+    std::map<char, OrderID> orders;
+    for (const auto& rule : map.get_rules())
+    {
+        orders.emplace(rule.first, rule.second.id);
+    }
+    event.kind = SessionEvent::Kind::ORDER;
+    for (const auto& order : orders)
+    {
+        event.predecessor = order.first;
+        event.order = order.second;
+        record(event);
+    }
+}
+
+
+SessionReplayer::SessionReplayer(std::vector<SessionEvent> events, bool deduplicate)
+    : events_ {std::move(events)}
+    , deduplicate_ {deduplicate}
+{
+}
+
+std::vector<SessionReplayer::Latency> SessionReplayer::replay() const
+{
+    using procgui::LSystemView;
+
+    SessionState state;
+    std::vector<Latency> latencies;
+    latencies.reserve(events_.size());
+
+    // The cost of the last computation of each view, from which the depth
+    // of its previews is chosen.
+    struct Cost
+    {
+        double compute_time;
+        std::size_t symbols;
+    };
+    std::map<int, Cost> costs;
+
+    auto milliseconds_since = [](std::chrono::steady_clock::time_point start)
+        {
+            return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        };
+
+    for (const auto& event : events_)
+    {
+        // The latency includes the modification of the models, as the
+        // invalidation of the cache of a LSystem.
+        Latency latency { event.kind, 0, 0, 0 };
+        auto start = std::chrono::steady_clock::now();
+        state.apply(event);
+
+        // Compute the previews of the affected views, then their geometry,
+        // as 'LSystemView::request_vertices()'. The workers of the View
+        // compute them concurrently: here, the previews are all computed
+        // first, as they are displayed first.
+        std::vector<int> affected;
+        for (const auto& entry : state.views)
+        {
+            if (state.is_affected(entry.first, event))
+            {
+                affected.push_back(entry.first);
+            }
+        }
+        for (int id : affected)
+        {
+            const auto& view = state.views.at(id);
+            auto lsys = state.lsystems.at(view.lsystem)->get_snapshot();
+            auto map = state.interpretations.at(view.interpretation)->get_snapshot();
+            auto cost = costs.count(id) > 0 ? costs.at(id) : Cost { 0, 0 };
+            auto preview = view.parameters;
+            preview.n_iter = LSystemView::preview_iterations(*lsys, preview.n_iter,
+                                                             cost.compute_time, cost.symbols);
+            if (preview.n_iter < view.parameters.n_iter)
+            {
+                LSystemView::compute_geometry(*lsys, *map, preview, deduplicate_, false);
+            }
+        }
+        latency.preview = milliseconds_since(start);
+
+        for (int id : affected)
+        {
+            const auto& view = state.views.at(id);
+            auto lsys = state.lsystems.at(view.lsystem)->get_snapshot();
+            auto map = state.interpretations.at(view.interpretation)->get_snapshot();
+            auto geometry = LSystemView::compute_geometry(*lsys, *map, view.parameters, deduplicate_, false);
+            costs[id] = { geometry.compute_time, geometry.symbols };
+            ++latency.views;
+        }
+        latency.duration = milliseconds_since(start);
+        latencies.push_back(latency);
+    }
+    return latencies;
+}
+
+SessionReplayer::Summary SessionReplayer::summarize(std::vector<double> durations)
+{
+    Summary summary;
+    if (durations.empty())
+    {
+        return summary;
+    }
+    std::sort(durations.begin(), durations.end());
+
+    // The nearest-rank percentile: the smallest value greater or equal to
+    // 'p' percents of the values.
+    auto percentile = [&durations](double p)
+        {
+            auto rank = static_cast<std::size_t>(std::ceil(p / 100. * durations.size()));
+            return durations[std::max<std::size_t>(rank, 1) - 1];
+        };
+    summary.count = durations.size();
+    summary.p50 = percentile(50);
+    summary.p90 = percentile(90);
+    summary.p99 = percentile(99);
+    summary.max = durations.back();
+    for (auto duration : durations)
+    {
+        summary.total += duration;
+    }
+    return summary;
+}
@@ -0,0 +1,273 @@
+#ifndef SESSION_H
+#define SESSION_H
+
+
+#include <chrono>
+#include <fstream>
+#include <istream>
+#include <map>
+#include <memory>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "LSystem.h"
+#include "InterpretationMap.h"
+#include "DrawingParameters.h"
+
+// A session is the sequence of the modifications of the models (LSystems,
+// InterpretationMaps, and the DrawingParameters of the views) during an
+// editing session. It is recorded by a 'SessionRecorder' and replayed by a
+// 'SessionReplayer', to reproduce the latencies of real editing sequences as
+// performance workloads.
+//
+// A session is saved as text, one event per line:
+//
+//     procgen-session 1
+//     <time> lsystem <id> axiom <axiom>
+//     <time> lsystem <id> rule <predecessor> <successor>
+//     <time> lsystem <id> remove <predecessor>
+//     <time> lsystem <id> clear
+//     <time> interpretation <id> rule <predecessor> <order>
+//     <time> interpretation <id> remove <predecessor>
+//     <time> interpretation <id> clear
+//     <time> view <id> <lsystem id> <interpretation id>
+//     <time> parameters <id> <x> <y> <starting angle> <delta angle> <step> <n_iter>
+//
+// The time is in seconds since the start of the recording. The axioms and the
+// successors are the rest of their line. The orders are named as in
+// 'get_order_name()'. Empty lines and lines starting with '#' are ignored.
+
+// An event of a session.
+struct SessionEvent
+{
+    enum class Kind
+    {
+        AXIOM,
+        RULE,
+        REMOVE_RULE,
+        CLEAR_RULES,
+        ORDER,
+        REMOVE_ORDER,
+        CLEAR_ORDERS,
+        VIEW,
+        PARAMETERS,
+    };
+    Kind kind { Kind::AXIOM };
+
+    // In seconds since the start of the recording.
+    double time { 0 };
+
+    // The identifier of the modified LSystem, InterpretationMap or view.
+    int target { 0 };
+
+    // The predecessor of the 'RULE', 'REMOVE_RULE', 'ORDER' and
+    // 'REMOVE_ORDER' events.
+    char predecessor { '\0' };
+
+    // The axiom of an 'AXIOM' event, the successor of a 'RULE' event.
+    std::string symbols { };
+
+    // The order of an 'ORDER' event.
+    drawing::OrderID order { drawing::OrderID::GO_FORWARD };
+
+    // The models of the view of a 'VIEW' event.
+    int lsystem { 0 };
+    int interpretation { 0 };
+
+    // The parameters of a 'PARAMETERS' event.
+    drawing::DrawingParameters parameters { };
+};
+
+// Get the name of the order 'id' in a session: "go_forward", "turn_right",
+// ...
+std::string get_order_name(drawing::OrderID id);
+
+// Get the order named 'name' in a session.
+// Exception:
+//   - Precondition: 'name' is the name of an order.
+drawing::Order get_order(const std::string& name);
+
+// Get the name of the kind of an event, to report the latencies by kind.
+std::string get_kind_name(SessionEvent::Kind kind);
+
+// Write 'event' as a line of a session.
+void write_event(std::ostream& os, const SessionEvent& event);
+
+// Read all the events of a session.
+// Exception:
+//   - Throws 'std::runtime_error' if the header or a line is malformed.
+std::vector<SessionEvent> read_session(std::istream& is);
+
+
+// The state of the models of a session, built by applying its events in
+// order. The models are created at their first reference. A definition of
+// LSystems, interpretations and views is simply a session whose state is used
+// once all its events are applied.
+class SessionState
+{
+public:
+    struct View
+    {
+        int lsystem { 0 };
+        int interpretation { 0 };
+        drawing::DrawingParameters parameters { };
+    };
+
+    std::map<int, std::shared_ptr<LSystem>> lsystems { };
+    std::map<int, std::shared_ptr<drawing::InterpretationMap>> interpretations { };
+    std::map<int, View> views { };
+
+    // Apply 'event' to the models.
+    // Exception:
+    //   - Precondition: a 'PARAMETERS' event refers to a defined view.
+    void apply(const SessionEvent& event);
+
+    // Check if the geometry of the view 'id' depends on the model modified by
+    // 'event'.
+    bool is_affected(int id, const SessionEvent& event) const;
+
+private:
+    LSystem& get_lsystem(int id);
+    drawing::InterpretationMap& get_interpretation(int id);
+};
+
+
+// A SessionRecorder records the modifications of its models while it is
+// recording. The models are registered beforehand. At the start of a
+// recording, their current state is written as the first events, so a session
+// can be replayed on its own.
+//
+// The modifications of the LSystems and InterpretationMaps are observed: all
+// the modifications are recorded, whatever their origin (the GUI, an
+// animation, ...). The DrawingParameters of the views are not observable:
+// 'record_parameters()' must be called when they may have changed.
+class SessionRecorder
+{
+public:
+    SessionRecorder() = default;
+
+    // A recording is stopped at the destruction.
+    ~SessionRecorder();
+
+    // The observers are registered with the address of the recorder.
+    SessionRecorder(const SessionRecorder&) = delete;
+    SessionRecorder& operator=(const SessionRecorder&) = delete;
+
+    // Register a model and return its identifier in the sessions.
+    // Exception:
+    //   - Precondition: the model must not be a nullptr.
+    int add_lsystem(std::shared_ptr<LSystem> lsys);
+    int add_interpretation(std::shared_ptr<drawing::InterpretationMap> map);
+
+    // Register a view of the models 'lsystem' and 'interpretation' drawn with
+    // 'parameters', and return its identifier in the sessions.
+    // Exception:
+    //   - Precondition: 'lsystem' and 'interpretation' are identifiers of
+    //   registered models.
+    int add_view(int lsystem, int interpretation, const drawing::DrawingParameters& parameters);
+
+    // Start recording in 'os', which must outlive the recording, or in the
+    // file 'path'. Return 'false' if the file could not be opened.
+    // Exception:
+    //   - Precondition: the recorder is not recording.
+    void start(std::ostream& os);
+    bool start(const std::string& path);
+
+    // Stop the recording, if any.
+    void stop();
+
+    bool is_recording() const;
+
+    // Record the parameters of the view 'view' if they changed since their
+    // last recording. Do nothing if the recorder is not recording.
+    // Exception:
+    //   - Precondition: 'view' is the identifier of a registered view.
+    void record_parameters(int view, const drawing::DrawingParameters& parameters);
+
+    // Get the number of events recorded by the current or last recording.
+    std::size_t get_size() const;
+
+private:
+    using View = SessionState::View;
+
+    // Write an event at the current time.
+    void record(SessionEvent event);
+
+    void on_lsystem_change(int id, const Observable::Change& change);
+    void on_interpretation_change(int id, const Observable::Change& change);
+
+    // Write the current state of the models.
+    void record_lsystem(int id);
+    void record_interpretation(int id);
+
+    std::vector<std::shared_ptr<LSystem>> lsystems_ { };
+    std::vector<std::shared_ptr<drawing::InterpretationMap>> interpretations_ { };
+    std::vector<View> views_ { };
+
+    // The identifiers of the observers during a recording, in the same order
+    // as the models.
+    std::vector<int> lsystem_observers_ { };
+    std::vector<int> interpretation_observers_ { };
+
+    std::ofstream file_ { };
+    std::ostream* os_ { nullptr };
+    std::chrono::steady_clock::time_point start_ { };
+    std::size_t size_ { 0 };
+};
+
+
+// A SessionReplayer applies the events of a session to models it creates
+// from them, without any window. After each event, the geometry of the views
+// affected by the event is computed again synchronously with
+// 'procgui::LSystemView::compute_geometry()', preceded by its preview as a
+// LSystemView would, and the duration of the computation is measured.
+class SessionReplayer
+{
+public:
+    // The latency of the re-computation after an event.
+    struct Latency
+    {
+        SessionEvent::Kind kind;
+        // In milliseconds.
+        double duration;
+        // The number of views computed again.
+        std::size_t views;
+        // The duration until the previews of the views are computed, in
+        // milliseconds. It is 'duration' if no preview was computed.
+        double preview;
+    };
+
+    // The statistics of a set of latencies, in milliseconds.
+    struct Summary
+    {
+        std::size_t count { 0 };
+        double p50 { 0 };
+        double p90 { 0 };
+        double p99 { 0 };
+        double max { 0 };
+        double total { 0 };
+    };
+
+    // The duplicated segments of the paths are removed if 'deduplicate' is
+    // true, as in a LSystemView with its deduplication enabled.
+    explicit SessionReplayer(std::vector<SessionEvent> events, bool deduplicate = false);
+
+    // Apply all the events in order and return the latency of each one. The
+    // models are created again at each call, so a session can be replayed
+    // several times.
+    // Exception:
+    //   - Precondition: the events refer to models and views previously
+    //   defined by the session.
+    std::vector<Latency> replay() const;
+
+    // Compute the nearest-rank percentiles of 'durations'.
+    static Summary summarize(std::vector<double> durations);
+
+private:
+    std::vector<SessionEvent> events_;
+    bool deduplicate_;
+};
+
+
+#endif // SESSION_H
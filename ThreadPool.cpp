@@ -0,0 +1,98 @@
+#include <algorithm>
+
+#include "gsl/gsl"
+#include "ThreadPool.h"
+
+ThreadPool::ThreadPool(unsigned n_threads)
+{
+    if (n_threads == 0)
+    {
+        // 'hardware_concurrency()' may return 0 if it can not know.
+        n_threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+
+    for (unsigned i = 0; i < n_threads; ++i)
+    {
+        workers_.emplace_back([this](){ work(); });
+    }
+}
+
+ThreadPool::~ThreadPool()
+{
+    {
+        std::lock_guard<std::mutex> lock (mutex_);
+        stop_ = true;
+    }
+    task_available_.notify_all();
+
+    for (auto& worker : workers_)
+    {
+        worker.join();
+    }
+}
+
+ThreadPool& ThreadPool::shared()
+{
+    static ThreadPool pool;
+    return pool;
+}
+
+unsigned ThreadPool::size() const
+{
+    return workers_.size();
+}
+
+// Exception:
+//  - Precondition: 'f' must not be a nullptr.
+void ThreadPool::submit(task f)
+{
+    Expects(f);
+    {
+        std::lock_guard<std::mutex> lock (mutex_);
+        tasks_.push_back(std::move(f));
+    }
+    task_available_.notify_one();
+}
+
+void ThreadPool::wait()
+{
+    std::unique_lock<std::mutex> lock (mutex_);
+    idle_.wait(lock, [this](){ return tasks_.empty() && running_ == 0; });
+}
+
+Observable::executor ThreadPool::executor()
+{
+    return [this](std::function<void()> f){ submit(std::move(f)); };
+}
+
+void ThreadPool::work()
+{
+    while (true)
+    {
+        task f;
+        {
+            std::unique_lock<std::mutex> lock (mutex_);
+            task_available_.wait(lock, [this](){ return stop_ || !tasks_.empty(); });
+
+            // When stopping, the remaining tasks are still executed.
+            if (tasks_.empty())
+            {
+                return;
+            }
+            f = std::move(tasks_.front());
+            tasks_.pop_front();
+            ++running_;
+        }
+
+        f();
+
+        {
+            std::lock_guard<std::mutex> lock (mutex_);
+            --running_;
+            if (tasks_.empty() && running_ == 0)
+            {
+                idle_.notify_all();
+            }
+        }
+    }
+}
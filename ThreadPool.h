@@ -0,0 +1,70 @@
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "Observable.h"
+
+// Simple pool of worker threads executing tasks in FIFO order.
+//
+// A single pool is shared by the whole application with 'shared()', so that
+// every heavy computation (vertices of all the LSystemViews, ...) competes for
+// the same cores instead of oversubscribing them.
+//
+// The destructor waits for all the submitted tasks to finish.
+class ThreadPool
+{
+public:
+    using task = std::function<void()>;
+
+    // Create a pool of 'n_threads' workers. If 'n_threads' is 0, create as
+    // many workers as there are hardware threads.
+    explicit ThreadPool(unsigned n_threads = 0);
+    ~ThreadPool();
+
+    // A ThreadPool owns its threads: it can not be copied.
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    // The pool shared by the application.
+    static ThreadPool& shared();
+
+    // Get the number of workers.
+    unsigned size() const;
+
+    // Queue 'f' to be executed by a worker.
+    // Exception:
+    //  - Precondition: 'f' must not be a nullptr.
+    void submit(task f);
+
+    // Block until every submitted task is finished.
+    void wait();
+
+    // An executor submitting its tasks to this pool, to use with
+    // 'Observable::add_observer()' for example.
+    Observable::executor executor();
+
+private:
+    // The loop of each worker.
+    void work();
+
+    std::vector<std::thread> workers_;
+
+    // Protect 'tasks_', 'running_', and 'stop_'.
+    std::mutex mutex_;
+    std::condition_variable task_available_;
+    std::condition_variable idle_;
+    
+    std::deque<task> tasks_;
+    unsigned running_ { 0 };
+    bool stop_ { false };
+};
+
+
+#endif // THREAD_POOL_H
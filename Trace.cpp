@@ -0,0 +1,141 @@
+#include <fstream>
+
+#include "Trace.h"
+
+constexpr const char* Trace::ENVIRONMENT_VARIABLE;
+constexpr std::size_t Trace::BUFFER_CAPACITY;
+constexpr const char* Trace::NO_ARG;
+
+std::atomic<bool> Trace::is_capturing_ { false };
+
+Trace::Trace()
+    : epoch_ {std::chrono::steady_clock::now()}
+{
+}
+
+Trace& Trace::global()
+{
+    static Trace trace;
+    return trace;
+}
+
+double Trace::now() const
+{
+    return std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - epoch_).count();
+}
+
+void Trace::start()
+{
+    // The spans recorded since the last collection belong to the previous
+    // capture.
+    collect();
+    std::lock_guard<std::mutex> lock (mutex_);
+    events_.clear();
+    dropped_ = 0;
+    is_capturing_ = true;
+}
+
+void Trace::stop()
+{
+    is_capturing_ = false;
+}
+
+Trace::Buffer& Trace::get_buffer()
+{
+    // The buffer is owned by 'buffers_': it outlives its thread, so the spans
+    // of a finished thread can still be collected.
+    thread_local Buffer* buffer = nullptr;
+    if (!buffer)
+    {
+        auto new_buffer = std::make_shared<Buffer>();
+        std::lock_guard<std::mutex> lock (mutex_);
+        new_buffer->thread = buffers_.size();
+        buffers_.push_back(new_buffer);
+        buffer = new_buffer.get();
+    }
+    return *buffer;
+}
+
+void Trace::record(const char* category, const char* name,
+                   const char* arg_name, long arg,
+                   double start, double duration)
+{
+    auto& buffer = get_buffer();
+    auto head = buffer.head.load(std::memory_order_relaxed);
+    auto tail = buffer.tail.load(std::memory_order_acquire);
+    if (head - tail == BUFFER_CAPACITY)
+    {
+        dropped_.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+
+    buffer.events[head % BUFFER_CAPACITY] = {category, name, arg_name, arg,
+                                             start, duration, buffer.thread};
+    // The event is published to the collecting thread.
+    buffer.head.store(head + 1, std::memory_order_release);
+}
+
+void Trace::collect()
+{
+    std::lock_guard<std::mutex> lock (mutex_);
+    for (const auto& buffer : buffers_)
+    {
+        auto tail = buffer->tail.load(std::memory_order_relaxed);
+        auto head = buffer->head.load(std::memory_order_acquire);
+        for (auto i = tail; i < head; ++i)
+        {
+            events_.push_back(buffer->events[i % BUFFER_CAPACITY]);
+        }
+        // The slots are given back to the owning thread.
+        buffer->tail.store(head, std::memory_order_release);
+    }
+}
+
+void Trace::write(std::ostream& os)
+{
+    collect();
+    std::lock_guard<std::mutex> lock (mutex_);
+
+    // The events are "complete events" (phase 'X'), with their duration.
+    os << "{\"traceEvents\":[";
+    for (std::size_t i = 0; i < events_.size(); ++i)
+    {
+        const auto& event = events_[i];
+        os << (i > 0 ? ",\n" : "\n")
+           << "{\"name\":\"" << event.name << "\""
+           << ",\"cat\":\"" << event.category << "\""
+           << ",\"ph\":\"X\",\"pid\":1"
+           << ",\"tid\":" << event.thread
+           << ",\"ts\":" << event.start
+           << ",\"dur\":" << event.duration;
+        if (event.arg_name != NO_ARG)
+        {
+            os << ",\"args\":{\"" << event.arg_name << "\":" << event.arg << "}";
+        }
+        os << "}";
+    }
+    os << "\n],\"displayTimeUnit\":\"ms\""
+       << ",\"otherData\":{\"dropped\":" << get_dropped() << "}}\n";
+}
+
+bool Trace::save(const std::string& path)
+{
+    std::ofstream file (path);
+    if (!file)
+    {
+        return false;
+    }
+    write(file);
+    return static_cast<bool>(file);
+}
+
+std::size_t Trace::get_size() const
+{
+    std::lock_guard<std::mutex> lock (mutex_);
+    return events_.size();
+}
+
+std::size_t Trace::get_dropped() const
+{
+    return dropped_.load(std::memory_order_relaxed);
+}
@@ -0,0 +1,179 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <vector>
+
+// A Trace captures the spans of the pipeline (production, interpretation,
+// geometry passes, notifications, drawing, ...) and writes them in the Chrome
+// trace-event JSON format, to be opened in 'chrome://tracing' or Perfetto.
+//
+// The spans are declared with the 'TRACE_SCOPE()' macros, and recorded only
+// during a capture, between 'start()' and 'stop()'. Outside of a capture, a
+// span costs a single relaxed atomic load.
+//
+// Each thread records its spans in its own lock-free ring buffer, without any
+// allocation or lock: only its first span registers the buffer. The buffers
+// are drained by 'collect()', called by 'write()'. If a buffer is full, the
+// new spans of its thread are dropped and counted.
+//
+// There is only one Trace in the process: 'global()'. All the functions can
+// be called from any thread.
+class Trace
+{
+public:
+    // The environment variable starting a capture at the launch of the
+    // application. Its value is the path of the file to write at exit.
+    static constexpr const char* ENVIRONMENT_VARIABLE = "PROCGEN_TRACE";
+
+    // The number of spans a thread can record before they are collected.
+    static constexpr std::size_t BUFFER_CAPACITY = 1 << 14;
+
+    // The value of 'Event::arg_name' for a span without argument.
+    static constexpr const char* NO_ARG = nullptr;
+
+    // A recorded span. The strings must be literals, without quotes or
+    // backslashes: they are neither copied nor escaped.
+    struct Event
+    {
+        const char* category;
+        const char* name;
+        const char* arg_name;
+        long arg;
+        // In microseconds since the creation of the Trace.
+        double start;
+        double duration;
+        int thread;
+    };
+
+    Trace(const Trace&) = delete;
+    Trace& operator=(const Trace&) = delete;
+
+    // The Trace of the process.
+    static Trace& global();
+
+    // Check if a capture is in progress.
+    static bool is_capturing()
+    {
+        return is_capturing_.load(std::memory_order_relaxed);
+    }
+
+    // The current time, in microseconds since the creation of the Trace.
+    double now() const;
+
+    // Start a capture. The spans collected by a previous capture are
+    // discarded.
+    void start();
+
+    // Stop the capture. The collected spans are kept until the next 'start()'.
+    void stop();
+
+    // Record a span in the buffer of the current thread. Called by
+    // 'TraceScope'.
+    void record(const char* category, const char* name,
+                const char* arg_name, long arg,
+                double start, double duration);
+
+    // Drain the buffers of all the threads.
+    void collect();
+
+    // Collect the spans and write all of them in the Chrome trace-event JSON
+    // format.
+    void write(std::ostream& os);
+
+    // Collect the spans and write them in the file 'path'. Return 'false' if
+    // the file could not be written.
+    bool save(const std::string& path);
+
+    // Get the number of spans collected during the current or last capture.
+    std::size_t get_size() const;
+
+    // Get the number of spans dropped because of a full buffer.
+    std::size_t get_dropped() const;
+
+private:
+    // A single-producer single-consumer ring buffer: the owning thread
+    // advances 'head', the collecting thread advances 'tail'.
+    struct Buffer
+    {
+        std::array<Event, BUFFER_CAPACITY> events;
+        std::atomic<std::size_t> head { 0 };
+        std::atomic<std::size_t> tail { 0 };
+        int thread { 0 };
+    };
+
+    Trace();
+
+    // Get the buffer of the current thread, registering it if necessary.
+    Buffer& get_buffer();
+
+    static std::atomic<bool> is_capturing_;
+
+    const std::chrono::steady_clock::time_point epoch_;
+
+    // Serialize the registration and the collection of the buffers.
+    mutable std::mutex mutex_ { };
+    std::vector<std::shared_ptr<Buffer>> buffers_ { };
+    std::vector<Event> events_ { };
+    std::atomic<std::size_t> dropped_ { 0 };
+};
+
+
+// Record a span from its construction to its destruction, if a capture is in
+// progress at its construction.
+class TraceScope
+{
+public:
+    TraceScope(const char* category, const char* name,
+               const char* arg_name = Trace::NO_ARG, long arg = 0)
+        : category_ {category}
+        , name_ {name}
+        , arg_name_ {arg_name}
+        , arg_ {arg}
+        , start_ {Trace::is_capturing() ? Trace::global().now() : -1.}
+    {
+    }
+
+    ~TraceScope()
+    {
+        if (start_ >= 0)
+        {
+            auto& trace = Trace::global();
+            trace.record(category_, name_, arg_name_, arg_, start_, trace.now() - start_);
+        }
+    }
+
+    TraceScope(const TraceScope&) = delete;
+    TraceScope& operator=(const TraceScope&) = delete;
+
+private:
+    const char* category_;
+    const char* name_;
+    const char* arg_name_;
+    long arg_;
+    double start_;
+};
+
+// Declare a span until the end of the current scope. With
+// 'PROCGEN_NO_TRACE' defined, the spans are compiled out.
+#define TRACE_CONCATENATE_IMPL(a, b) a##b
+#define TRACE_CONCATENATE(a, b) TRACE_CONCATENATE_IMPL(a, b)
+#ifndef PROCGEN_NO_TRACE
+#define TRACE_SCOPE(category, name)                                     \
+    TraceScope TRACE_CONCATENATE(trace_scope_, __LINE__) (category, name)
+#define TRACE_SCOPE_ARG(category, name, arg_name, arg)                  \
+    TraceScope TRACE_CONCATENATE(trace_scope_, __LINE__) (category, name, arg_name, arg)
+#else
+#define TRACE_SCOPE(category, name)
+#define TRACE_SCOPE_ARG(category, name, arg_name, arg)
+#endif
+
+
+#endif // TRACE_H
@@ -1,39 +1,329 @@
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <unordered_map>
+#if defined(__SSE__)
+#include <xmmintrin.h>
+#endif
+#include "Trace.h"
 #include "Turtle.h"
 
 namespace drawing
 {
     using namespace impl;
 
-    Turtle::Turtle(const DrawingParameters& params)
+    Turtle::Turtle(const DrawingParameters& params, std::size_t positions_per_box)
         : parameters { params }
         , state   { parameters.starting_position, parameters.starting_angle }
-        , vertices      { { state.position } }
+        , paths   { { state.position }, { } }
+        , boxes   { positions_per_box }
     {
+        boxes.add(state.position);
     }
 
-    std::vector<sf::Vertex> compute_vertices(LSystem& lsys,
-                                             InterpretationMap& interpretation,
-                                             const DrawingParameters& parameters)
+    constexpr int OrderTable::NO_ORDER;
+
+    OrderTable::OrderTable(const InterpretationMap::rule_map& rules)
+    {
+        orders_.fill(NO_ORDER);
+        for (const auto& rule : rules)
+        {
+            orders_[static_cast<unsigned char>(rule.first)] = static_cast<int>(rule.second.id);
+        }
+    }
+
+    namespace
     {
-        Turtle turtle (parameters);
-        
-        const auto res = lsys.produce(parameters.n_iter);
+        // The estimated size of the paths of an interpretation.
+        struct Estimate
+        {
+            std::size_t n_positions { 1 };
+            std::size_t n_breaks { 0 };
+        };
+
+        // Estimate the size of the paths of the interpretation of 'symbols'
+        // from the histogram of its symbols: each "go forward" adds a
+        // position, as does each "load position" most of the time, which also
+        // starts a new polyline.
+        Estimate estimate_paths(const std::string& symbols,
+                                const InterpretationMap::rule_map& interpretation)
+        {
+            std::array<std::size_t, 256> histogram {};
+            for (auto c : symbols)
+            {
+                ++histogram[static_cast<unsigned char>(c)];
+            }
+
+            Estimate estimate;
+            for (const auto& rule : interpretation)
+            {
+                auto count = histogram[static_cast<unsigned char>(rule.first)];
+                if (rule.second.id == OrderID::GO_FORWARD)
+                {
+                    estimate.n_positions += count;
+                }
+                else if (rule.second.id == OrderID::LOAD_POSITION)
+                {
+                    estimate.n_positions += count;
+                    estimate.n_breaks += count;
+                }
+            }
+            return estimate;
+        }
 
-        for (auto c : res)
+        // Interpret 'symbols' with the orders of 'interpretation'. The breaks
+        // and the sub-boxes are reserved from 'estimate'.
+        Turtle interpret(const std::string& symbols,
+                         const InterpretationMap::rule_map& interpretation,
+                         const DrawingParameters& parameters,
+                         std::size_t positions_per_box = std::numeric_limits<std::size_t>::max(),
+                         const Estimate& estimate = {})
         {
-            if (interpretation.has_predecessor(c))
+            Turtle turtle (parameters, positions_per_box);
+            turtle.paths.breaks.reserve(estimate.n_breaks);
+            turtle.boxes.reserve(estimate.n_positions);
+
+            for (auto c : symbols)
+            {
+                auto order = interpretation.find(c);
+                if (order != interpretation.end())
+                {
+                    // If an interpretation of the character 'c' is found,
+                    // applies it to the current turtle.
+                    order->second(turtle);
+                }
+                else
+                {
+                    // Do nothing: if 'c' does not have an associated
+                    // order, it has no effects.
+                }
+            }
+
+            return turtle;
+        }
+
+        // The turtles of a batch interpretation, in structure-of-arrays
+        // layout: the lane 'i' is the turtle of the 'i'-th DrawingParameters.
+        // The number of lanes is padded to a multiple of 4, so SSE
+        // instructions advance 4 turtles at once.
+        //
+        // All the turtles execute the same orders, so they share the
+        // number of turns taken: the angle of the lane 'i' is
+        // 'starting_angle[i] + turns * delta_angle[i]'. The cosines and sines
+        // are memoized by number of turns.
+        class TurtleLanes
+        {
+        public:
+            explicit TurtleLanes(const std::vector<DrawingParameters>& parameters)
+                : n_lanes_ { (parameters.size() + 3) / 4 * 4 }
+                , parameters_ { parameters }
+                , x_ (n_lanes_, 0.f)
+                , y_ (n_lanes_, 0.f)
+                , step_ (n_lanes_, 0.f)
+                , paths_ (parameters.size())
+            {
+                for (std::size_t i = 0; i < parameters.size(); ++i)
+                {
+                    x_[i] = parameters[i].starting_position.x;
+                    y_[i] = parameters[i].starting_position.y;
+                    step_[i] = parameters[i].step;
+                    paths_[i].positions.push_back(parameters[i].starting_position);
+                }
+                n_positions_ = 1;
+                direction_ = &directions(0);
+            }
+
+            void go_forward()
+            {
+                if (turns_ != direction_turns_)
+                {
+                    direction_ = &directions(turns_);
+                    direction_turns_ = turns_;
+                }
+                const float* cos = direction_->data();
+                const float* sin = cos + n_lanes_;
+
+                std::size_t i = 0;
+#if defined(__SSE__)
+                for (; i < n_lanes_; i += 4)
+                {
+                    __m128 step = _mm_loadu_ps(&step_[i]);
+                    _mm_storeu_ps(&x_[i], _mm_add_ps(_mm_loadu_ps(&x_[i]),
+                                                     _mm_mul_ps(step, _mm_loadu_ps(cos + i))));
+                    _mm_storeu_ps(&y_[i], _mm_add_ps(_mm_loadu_ps(&y_[i]),
+                                                     _mm_mul_ps(step, _mm_loadu_ps(sin + i))));
+                }
+#endif
+                for (; i < n_lanes_; ++i)
+                {
+                    x_[i] += step_[i] * cos[i];
+                    y_[i] += step_[i] * sin[i];
+                }
+
+                for (std::size_t lane = 0; lane < paths_.size(); ++lane)
+                {
+                    paths_[lane].positions.push_back({x_[lane], y_[lane]});
+                }
+                ++n_positions_;
+            }
+
+            void turn(long direction)
+            {
+                turns_ += direction;
+            }
+
+            void save_position()
+            {
+                stack_turns_.push_back(turns_);
+                stack_x_.insert(stack_x_.end(), x_.begin(), x_.end());
+                stack_y_.insert(stack_y_.end(), y_.begin(), y_.end());
+            }
+
+            void load_position()
+            {
+                if (stack_turns_.empty())
+                {
+                    return;
+                }
+
+                turns_ = stack_turns_.back();
+                stack_turns_.pop_back();
+                auto top = stack_x_.size() - n_lanes_;
+                std::copy(stack_x_.begin() + top, stack_x_.end(), x_.begin());
+                std::copy(stack_y_.begin() + top, stack_y_.end(), y_.begin());
+                stack_x_.resize(top);
+                stack_y_.resize(top);
+
+                // Same as 'load_position_fn()': the jump starts a new
+                // polyline, except if the current one only has a single
+                // position. The polylines are the same for all the lanes.
+                std::size_t start = breaks_.empty() ? 0 : breaks_.back();
+                bool replace = n_positions_ - start == 1;
+                if (!replace)
+                {
+                    breaks_.push_back(n_positions_);
+                    ++n_positions_;
+                }
+                for (std::size_t i = 0; i < paths_.size(); ++i)
+                {
+                    if (replace)
+                    {
+                        paths_[i].positions.back() = {x_[i], y_[i]};
+                    }
+                    else
+                    {
+                        paths_[i].positions.push_back({x_[i], y_[i]});
+                    }
+                }
+            }
+
+            std::vector<geometry::Polylines> release()
             {
-                // If an interpretation of the character 'c' is found,
-                // applies it to the current turtle.
-                interpretation.get_rule(c).second(turtle);
+                for (auto& paths : paths_)
+                {
+                    paths.breaks = breaks_;
+                }
+                return std::move(paths_);
             }
-            else
+
+        private:
+            // The cosines of all the lanes followed by their sines, after
+            // 'turns' turns.
+            const std::vector<float>& directions(long turns)
             {
-                // Do nothing: if 'c' does not have an associated
-                // order, it has no effects.
+                auto it = directions_.find(turns);
+                if (it == directions_.end())
+                {
+                    std::vector<float> direction (2 * n_lanes_, 0.f);
+                    for (std::size_t i = 0; i < parameters_.size(); ++i)
+                    {
+                        double angle = parameters_[i].starting_angle + turns * parameters_[i].delta_angle;
+                        direction[i] = std::cos(angle);
+                        direction[n_lanes_ + i] = std::sin(angle);
+                    }
+                    it = directions_.emplace(turns, std::move(direction)).first;
+                }
+                return it->second;
             }
+
+            std::size_t n_lanes_;
+            const std::vector<DrawingParameters>& parameters_;
+
+            std::vector<float> x_;
+            std::vector<float> y_;
+            std::vector<float> step_;
+
+            // The number of turns, positive clockwise.
+            long turns_ { 0 };
+            std::unordered_map<long, std::vector<float>> directions_;
+            const std::vector<float>* direction_ { nullptr };
+            long direction_turns_ { 0 };
+
+            // The saved states, 'n_lanes_' positions per state.
+            std::vector<long> stack_turns_;
+            std::vector<float> stack_x_;
+            std::vector<float> stack_y_;
+
+            // The paths of each lane. They all have the same number of
+            // positions and the same breaks.
+            std::vector<geometry::Polylines> paths_;
+            std::size_t n_positions_ { 0 };
+            std::vector<std::size_t> breaks_;
+        };
+    }
+
+    geometry::Polylines compute_paths(LSystem& lsys,
+                                      InterpretationMap& interpretation,
+                                      const DrawingParameters& parameters)
+    {
+        const auto& res = lsys.produce(parameters.n_iter);
+
+        TRACE_SCOPE("interpretation", "compute_paths");
+        return std::move(interpret(res, interpretation.get_rules(), parameters).paths);
+    }
+
+    VersionedPaths compute_paths(const LSystem::Snapshot& lsys,
+                                 const InterpretationMap::Snapshot& interpretation,
+                                 const DrawingParameters& parameters,
+                                 int max_sub_boxes)
+    {
+        const auto& res = lsys.produce(parameters.n_iter);
+
+        TRACE_SCOPE("interpretation", "compute_paths");
+        // The number of positions is not known before the interpretation: the
+        // sub-boxes are sized from an estimation.
+        auto estimate = estimate_paths(res, interpretation.rules);
+        auto turtle = interpret(res, interpretation.rules, parameters,
+                                geometry::compute_positions_per_box(estimate.n_positions, max_sub_boxes),
+                                estimate);
+
+        return { std::move(turtle.paths),
+                 turtle.boxes.get_bounding_box(),
+                 turtle.boxes.get_sub_boxes(),
+                 lsys.version,
+                 interpretation.version };
+    }
+
+    std::vector<geometry::Polylines>
+    compute_paths(const LSystem::Snapshot& lsys,
+                  const InterpretationMap::Snapshot& interpretation,
+                  const std::vector<DrawingParameters>& parameters)
+    {
+        if (parameters.empty())
+        {
+            return {};
         }
+        Expects(std::all_of(parameters.begin(), parameters.end(),
+                            [&parameters](const DrawingParameters& p)
+                            { return p.n_iter == parameters.front().n_iter; }));
+
+        const auto& res = lsys.produce(parameters.front().n_iter);
+
+        TRACE_SCOPE_ARG("interpretation", "compute_paths", "lanes", parameters.size());
 
-        return turtle.vertices;
+        // The symbols are decoded once for all the lanes.
+        TurtleLanes lanes (parameters);
+        OrderTable(interpretation.rules).execute(res, lanes);
+        return lanes.release();
     }
 }
@@ -2,10 +2,15 @@
 #define DRAWING_TURTLE_H
 
 
+#include <array>
+#include <cmath>
+#include <limits>
 #include <vector>
 #include <stack>
 
 #include "LSystem.h"
+#include "Trace.h"
+#include "geometry.h"
 #include "DrawingParameters.h"
 #include "InterpretationMap.h"
 
@@ -28,14 +33,17 @@ namespace drawing
     // flexibility.
     // Note: Turtle is placed into an implementation namespace as it
     // is only instanciated and used in 'compute_paths()' to
-    // generate the vertices.
+    // generate the paths.
     namespace impl
     {
         struct Turtle
         {
-            explicit Turtle(const DrawingParameters& parameters);
+            // The sub-boxes of the positions have 'positions_per_box'
+            // positions. By default, there is a single box.
+            explicit Turtle(const DrawingParameters& parameters,
+                            std::size_t positions_per_box = std::numeric_limits<std::size_t>::max());
             
-            // All the parameters necessary to compute the vertices.
+            // All the parameters necessary to compute the paths.
             // Note: This is a non-owning reference. As Turtle is only
             // used as a temporary object in the 'drawing' namespace,
             // the danger of lifetime management should be
@@ -50,13 +58,43 @@ namespace drawing
             };
             State state { };
 
-            // The state of a turtle can be saved and loaded in a stack.
-            std::stack<State> stack { };
+            // The state of a turtle can be saved and loaded in a stack. It is
+            // backed by a vector: nothing is allocated until the first save,
+            // and its storage is reused afterwards.
+            std::stack<State, std::vector<State>> stack { };
             
             // Each time the Turtle changes its position, the new one is saved
-            // in a vertex. However, we can jump from position to position, so
-            // it there is additional transparent vertices between jumps.
-            std::vector<sf::Vertex> vertices { };
+            // in the current polyline. Jumping from position to position
+            // starts a new polyline.
+            geometry::Polylines paths { };
+
+            // The bounding boxes of the positions, accumulated each time a
+            // position is added to 'paths'.
+            geometry::BoxAccumulator boxes { };
+        };
+
+        // The orders of the symbols in a table indexed by the symbols, so
+        // that the productions are decoded without looking up the rules.
+        // The orders are executed by a policy with the member functions
+        // 'go_forward()', 'turn(long direction)' (1 to turn right, -1 to
+        // turn left), 'save_position()' and 'load_position()': the turtles
+        // of the batch 'compute_paths()' and of 'stream_paths()'.
+        class OrderTable
+        {
+        public:
+            explicit OrderTable(const InterpretationMap::rule_map& rules);
+
+            // Execute the order of 'symbol' on 'policy', if it has one.
+            template<typename Policy>
+            void execute(char symbol, Policy& policy) const;
+
+            // Execute the orders of all the 'symbols' on 'policy'.
+            template<typename Policy>
+            void execute(const std::string& symbols, Policy& policy) const;
+
+        private:
+            static constexpr int NO_ORDER = -1;
+            std::array<int, 256> orders_;
         };
     }
 
@@ -64,9 +102,75 @@ namespace drawing
     // First, this function iterates 'parameters.n_iter' times the LSystem
     // 'lsys', using and modifying its cache. Then, it interprates the result
     // with 'interpretation' and 'parameters'.
-    std::vector<sf::Vertex> compute_vertices(LSystem& lsys,
-                                             InterpretationMap& interpretation,
-                                             const DrawingParameters& parameters);
+    geometry::Polylines compute_paths(LSystem& lsys,
+                                      InterpretationMap& interpretation,
+                                      const DrawingParameters& parameters);
+
+    // The paths computed from snapshots, with their bounding boxes, tagged
+    // with the versions of these snapshots. A result older than the current
+    // versions of the LSystem or the InterpretationMap is stale and can be
+    // dropped.
+    struct VersionedPaths
+    {
+        geometry::Polylines paths;
+        sf::FloatRect bounding_box;
+        std::vector<sf::FloatRect> sub_boxes;
+        unsigned long lsys_version;
+        unsigned long interpretation_version;
+    };
+
+    // Compute all paths of a turtle interpretation of a L-system snapshot.
+    // Same as above, but does not touch any mutable state: it can be called
+    // from any thread.
+    // The bounding box and at most 'max_sub_boxes' sub-boxes (see
+    // 'geometry::compute_sub_boxes()') are computed during the
+    // interpretation.
+    VersionedPaths compute_paths(const LSystem::Snapshot& lsys,
+                                 const InterpretationMap::Snapshot& interpretation,
+                                 const DrawingParameters& parameters,
+                                 int max_sub_boxes = 1);
+
+    // Compute the paths of the interpretation of a L-system snapshot with
+    // each one of 'parameters', returned in the same order. It is made for
+    // the exploration of parameters: the production is decoded and the stack
+    // is handled once for all the DrawingParameters, whose turtles are
+    // advanced together.
+    // Note: the angle of a turtle is computed from the number of turns
+    // instead of being accumulated turn after turn, so the positions may
+    // differ from the ones of 'compute_paths()' by rounding errors.
+    // Exception:
+    //   - Precondition: all the 'parameters' have the same 'n_iter'.
+    std::vector<geometry::Polylines>
+    compute_paths(const LSystem::Snapshot& lsys,
+                  const InterpretationMap::Snapshot& interpretation,
+                  const std::vector<DrawingParameters>& parameters);
+
+    // Interpret the L-system snapshot like 'compute_paths()', but stream the
+    // paths to 'sink' as the turtle moves instead of storing them. The paths
+    // of large drawings are then exported or measured in bounded memory.
+    //
+    // 'Sink' has two member functions, called for each drawn polyline:
+    //   - 'move_to(const sf::Vector2f& position)' lifts the pen up and starts
+    //   a new polyline at 'position'.
+    //   - 'line_to(const sf::Vector2f& position)' draws a segment from the
+    //   previous position to 'position'.
+    // The polylines of a single position, which draw nothing, are not
+    // streamed: 'move_to()' is called lazily, just before the first segment
+    // of a polyline. Otherwise, the positions are the same as the ones of
+    // 'compute_paths()'.
+    //
+    // If the iteration 'parameters.n_iter' is already produced in 'lsys', it
+    // is read from its cache. Otherwise, it is derived depth first as it is
+    // interpreted, without being stored: the memory does not depend on the
+    // size of the production. The derived iteration is not cached, so the
+    // next calls derive it again.
+    template<typename Sink>
+    void stream_paths(const LSystem::Snapshot& lsys,
+                      const InterpretationMap::Snapshot& interpretation,
+                      const DrawingParameters& parameters,
+                      Sink& sink);
+
+    #include "Turtle.tpp"
 }
 
 
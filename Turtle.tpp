@@ -0,0 +1,144 @@
+template<typename Policy>
+void impl::OrderTable::execute(char symbol, Policy& policy) const
+{
+    switch (orders_[static_cast<unsigned char>(symbol)])
+    {
+    case static_cast<int>(OrderID::GO_FORWARD):
+        policy.go_forward();
+        break;
+    case static_cast<int>(OrderID::TURN_RIGHT):
+        policy.turn(1);
+        break;
+    case static_cast<int>(OrderID::TURN_LEFT):
+        policy.turn(-1);
+        break;
+    case static_cast<int>(OrderID::SAVE_POSITION):
+        policy.save_position();
+        break;
+    case static_cast<int>(OrderID::LOAD_POSITION):
+        policy.load_position();
+        break;
+    default:
+        // Do nothing: 'symbol' does not have an associated order.
+        break;
+    }
+}
+
+template<typename Policy>
+void impl::OrderTable::execute(const std::string& symbols, Policy& policy) const
+{
+    for (auto c : symbols)
+    {
+        execute(c, policy);
+    }
+}
+
+namespace impl
+{
+    // The turtle of 'stream_paths()': it streams its positions to a sink
+    // instead of storing them.
+    template<typename Sink>
+    class SinkTurtle
+    {
+    public:
+        SinkTurtle(const DrawingParameters& parameters, Sink& sink)
+            : parameters_ {parameters}
+            , sink_ {sink}
+            , state_ {parameters.starting_position, parameters.starting_angle}
+        {
+        }
+
+        void go_forward()
+        {
+            if (!is_started_)
+            {
+                sink_.move_to(state_.position);
+                is_started_ = true;
+            }
+            float dx = parameters_.step * std::cos(state_.angle);
+            float dy = parameters_.step * std::sin(state_.angle);
+            state_.position += {dx, dy};
+            sink_.line_to(state_.position);
+        }
+
+        void turn(long direction)
+        {
+            state_.angle += direction * parameters_.delta_angle;
+        }
+
+        void save_position()
+        {
+            stack_.push_back(state_);
+        }
+
+        void load_position()
+        {
+            // Same as 'load_position_fn()': the jump starts a new polyline.
+            if (!stack_.empty())
+            {
+                state_ = stack_.back();
+                stack_.pop_back();
+                is_started_ = false;
+            }
+        }
+
+    private:
+        const DrawingParameters& parameters_;
+        Sink& sink_;
+        Turtle::State state_;
+        std::vector<Turtle::State> stack_ { };
+        // If 'true', 'move_to()' was called for the current polyline.
+        bool is_started_ { false };
+    };
+
+    // Execute the orders of the 'n'-th iteration of 'symbols' on 'policy',
+    // deriving it depth first: the symbols with a successor in 'successors'
+    // are replaced recursively, and the others are executed. Only the
+    // recursion, 'n' levels deep, is stored.
+    template<typename Policy>
+    void execute_derivation(const std::string& symbols, int n,
+                            const std::array<const std::string*, 256>& successors,
+                            const OrderTable& orders,
+                            Policy& policy)
+    {
+        for (auto c : symbols)
+        {
+            const auto* successor = successors[static_cast<unsigned char>(c)];
+            if (n > 0 && successor)
+            {
+                execute_derivation(*successor, n - 1, successors, orders, policy);
+            }
+            else
+            {
+                orders.execute(c, policy);
+            }
+        }
+    }
+}
+
+template<typename Sink>
+void stream_paths(const LSystem::Snapshot& lsys,
+                  const InterpretationMap::Snapshot& interpretation,
+                  const DrawingParameters& parameters,
+                  Sink& sink)
+{
+    TRACE_SCOPE("interpretation", "stream_paths");
+
+    impl::OrderTable orders (interpretation.rules);
+    impl::SinkTurtle<Sink> turtle (parameters, sink);
+    if (lsys.is_produced(parameters.n_iter))
+    {
+        orders.execute(lsys.produce(parameters.n_iter), turtle);
+        return;
+    }
+
+    // The successors are looked up in a table indexed by the symbols, a null
+    // successor meaning a terminal.
+    std::array<const std::string*, 256> successors;
+    successors.fill(nullptr);
+    for (const auto& rule : lsys.rules)
+    {
+        successors[static_cast<unsigned char>(rule.first)] = &rule.second;
+    }
+    impl::execute_derivation(lsys.axiom, parameters.n_iter, successors, orders, turtle);
+}
@@ -0,0 +1,112 @@
+#include <algorithm>
+
+#include "ViewProfile.h"
+
+namespace procgui
+{
+    constexpr std::size_t ViewProfile::HISTORY;
+
+    float ViewProfile::Computation::total() const
+    {
+        return production + interpretation + deduplication + index + lod;
+    }
+
+    float ViewProfile::Frame::total() const
+    {
+        return apply + conversion + submission;
+    }
+
+    void ViewProfile::record(const Computation& computation)
+    {
+        last_computation_ = computation;
+        if (computation.is_production_cached)
+        {
+            ++production_hits_;
+        }
+        else
+        {
+            ++production_misses_;
+        }
+    }
+
+    void ViewProfile::record(const Frame& frame)
+    {
+        last_frame_ = frame;
+        frame_times_[frame_offset_] = frame.total();
+        frame_offset_ = (frame_offset_ + 1) % HISTORY;
+        if (frame.is_strip_cached)
+        {
+            ++strip_hits_;
+        }
+        else
+        {
+            ++strip_misses_;
+        }
+    }
+
+    void ViewProfile::clear()
+    {
+        *this = ViewProfile();
+    }
+
+    const ViewProfile::Computation& ViewProfile::get_last_computation() const
+    {
+        return last_computation_;
+    }
+
+    const ViewProfile::Frame& ViewProfile::get_last_frame() const
+    {
+        return last_frame_;
+    }
+
+    const std::array<float, ViewProfile::HISTORY>& ViewProfile::get_frame_times() const
+    {
+        return frame_times_;
+    }
+
+    std::size_t ViewProfile::get_frame_offset() const
+    {
+        return frame_offset_;
+    }
+
+    float ViewProfile::get_max_frame_time() const
+    {
+        return *std::max_element(frame_times_.begin(), frame_times_.end());
+    }
+
+    std::size_t ViewProfile::get_production_hits() const
+    {
+        return production_hits_;
+    }
+
+    std::size_t ViewProfile::get_production_misses() const
+    {
+        return production_misses_;
+    }
+
+    std::size_t ViewProfile::get_strip_hits() const
+    {
+        return strip_hits_;
+    }
+
+    std::size_t ViewProfile::get_strip_misses() const
+    {
+        return strip_misses_;
+    }
+
+    Stopwatch::Stopwatch(bool is_enabled)
+        : is_enabled_ {is_enabled}
+        , last_ {is_enabled ? std::chrono::steady_clock::now() : std::chrono::steady_clock::time_point()}
+    {
+    }
+
+    void Stopwatch::lap(float& milliseconds)
+    {
+        if (is_enabled_)
+        {
+            auto now = std::chrono::steady_clock::now();
+            milliseconds = std::chrono::duration<float, std::milli>(now - last_).count();
+            last_ = now;
+        }
+    }
+}
@@ -0,0 +1,118 @@
+#ifndef VIEW_PROFILE_H
+#define VIEW_PROFILE_H
+
+
+#include <array>
+#include <chrono>
+#include <cstddef>
+
+namespace procgui
+{
+    // A ViewProfile records the timings of the stages of the pipeline of a
+    // LSystemView: the stages of its last computation, and the stages of
+    // its drawing for the last 'HISTORY' frames, in a ring buffer. The cache
+    // hits and misses of the production and of the vertex strip are counted.
+    //
+    // All the durations are in milliseconds.
+    class ViewProfile
+    {
+    public:
+        // The number of frames recorded.
+        static constexpr std::size_t HISTORY = 120;
+
+        // The stages of a computation of the vertices.
+        struct Computation
+        {
+            float production { 0 };
+            float interpretation { 0 };
+            float deduplication { 0 };
+            float index { 0 };
+            float lod { 0 };
+
+            // The number of symbols interpreted and of positions computed.
+            std::size_t symbols { 0 };
+            std::size_t vertices { 0 };
+
+            // 'true' if the production was already cached.
+            bool is_production_cached { false };
+
+            float total() const;
+        };
+
+        // The stages of the drawing of a frame.
+        struct Frame
+        {
+            // The application of a computed result.
+            float apply { 0 };
+            // The conversion of the paths into the vertex strip.
+            float conversion { 0 };
+            // The draw call.
+            float submission { 0 };
+
+            // The number of vertices submitted.
+            std::size_t vertices { 0 };
+
+            // 'true' if the vertex strip was reused as is.
+            bool is_strip_cached { false };
+
+            float total() const;
+        };
+
+        ViewProfile() = default;
+
+        // Record a computation and count its production cache hit or miss.
+        void record(const Computation& computation);
+
+        // Record a frame in the ring buffer, overwriting the oldest one, and
+        // count its vertex strip cache hit or miss.
+        void record(const Frame& frame);
+
+        // Reset all the records and counters.
+        void clear();
+
+        const Computation& get_last_computation() const;
+        const Frame& get_last_frame() const;
+
+        // Get the total durations of the recorded frames. The oldest one is at
+        // the index 'get_frame_offset()', the ring buffer wrapping around.
+        const std::array<float, HISTORY>& get_frame_times() const;
+        std::size_t get_frame_offset() const;
+
+        // Get the longest recorded frame.
+        float get_max_frame_time() const;
+
+        std::size_t get_production_hits() const;
+        std::size_t get_production_misses() const;
+        std::size_t get_strip_hits() const;
+        std::size_t get_strip_misses() const;
+
+    private:
+        Computation last_computation_ { };
+        Frame last_frame_ { };
+        std::array<float, HISTORY> frame_times_ { };
+        std::size_t frame_offset_ { 0 };
+
+        std::size_t production_hits_ { 0 };
+        std::size_t production_misses_ { 0 };
+        std::size_t strip_hits_ { 0 };
+        std::size_t strip_misses_ { 0 };
+    };
+
+    // Measure the durations between laps, only if it is enabled: otherwise,
+    // the clock is never read.
+    class Stopwatch
+    {
+    public:
+        explicit Stopwatch(bool is_enabled);
+
+        // Set 'milliseconds' to the duration since the last lap.
+        void lap(float& milliseconds);
+
+    private:
+        bool is_enabled_;
+        std::chrono::steady_clock::time_point last_;
+    };
+}
+
+
+#endif // VIEW_PROFILE_H
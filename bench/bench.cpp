@@ -0,0 +1,250 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <limits>
+#include <string>
+#include <vector>
+
+#include <sys/resource.h>
+
+#include "LSystem.h"
+#include "Observable.h"
+#include "Turtle.h"
+#include "InterpretationMap.h"
+#include "geometry.h"
+#include "helper_math.h"
+
+// Benchmarks of the hot paths of the core: the production of the L-systems,
+// their interpretation, the computation of the bounding boxes and the
+// notification of the observers.
+//
+// Each benchmark runs over a corpus of classic L-systems at increasing depths.
+// The results are written on the standard output as a JSON array, one object
+// per measure, with its throughput and the peak resident memory of the
+// process (a high-water mark: it never decreases).
+//
+// Usage: procgenBench.out [grammar...]
+//   Only run the given grammars of the corpus. By default, run all of them.
+
+using namespace drawing;
+using namespace math;
+
+namespace
+{
+    struct Grammar
+    {
+        std::string name;
+        std::string axiom;
+        LSystem::production_rules rules;
+        double delta_angle;
+        std::vector<int> depths;
+    };
+
+    const std::vector<Grammar> corpus {
+        { "koch", "F--F--F", { { 'F', "F+F--F+F" } },
+          degree_to_rad(60.), { 3, 4, 5, 6, 7, 8 } },
+        { "dragon", "FX", { { 'X', "X+YF+" }, { 'Y', "-FX-Y" } },
+          degree_to_rad(90.), { 8, 10, 12, 14, 16, 18 } },
+        { "hilbert", "A", { { 'A', "-BF+AFA+FB-" }, { 'B', "+AF-BFB-FA+" } },
+          degree_to_rad(90.), { 3, 4, 5, 6, 7, 8 } },
+        { "sierpinski", "F", { { 'F', "G-F-G" }, { 'G', "F+G+F" } },
+          degree_to_rad(60.), { 4, 6, 8, 10, 12 } },
+        { "plant", "X", { { 'X', "F[-X][X]F[-X]+FX" }, { 'F', "FF" } },
+          degree_to_rad(25.), { 2, 3, 4, 5, 6, 7 } },
+    };
+
+    const InterpretationMap::rule_map interpretation {
+        { 'F', go_forward },
+        { 'G', go_forward },
+        { '+', turn_left  },
+        { '-', turn_right },
+        { '[', save_position },
+        { ']', load_position } };
+
+    // Each benchmark is repeated until it ran at least 'min_runs' times and
+    // for 'min_time' seconds. The best run is kept.
+    constexpr int min_runs = 3;
+    constexpr double min_time = 0.2;
+
+    // Run 'run' and return the best duration, in seconds. 'run' returns the
+    // duration of the measured part of a run, so it can prepare the run
+    // beforehand.
+    template<typename F>
+    double measure(F run)
+    {
+        double best = std::numeric_limits<double>::max();
+        double total = 0;
+        for (int i = 0; i < min_runs || total < min_time; ++i)
+        {
+            double duration = run();
+            best = std::min(best, duration);
+            total += duration;
+        }
+        return best;
+    }
+
+    // Time 'f', in seconds.
+    template<typename F>
+    double time(F f)
+    {
+        auto start = std::chrono::steady_clock::now();
+        f();
+        return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    }
+
+    // The peak resident set size of the process, in KiB.
+    long peak_rss_kib()
+    {
+        rusage usage;
+        getrusage(RUSAGE_SELF, &usage);
+        return usage.ru_maxrss;
+    }
+
+    // The JSON members identifying the case of a benchmark.
+    std::string grammar_case(const Grammar& grammar, int depth)
+    {
+        return "\"grammar\": \"" + grammar.name + "\", \"depth\": " + std::to_string(depth);
+    }
+
+    // The number of items processed by a benchmark, named by their 'unit'.
+    struct Count
+    {
+        std::string unit;
+        std::size_t count;
+    };
+
+    // Write a result as a JSON object, with the throughput of each of the
+    // processed 'counts'.
+    bool is_first_result = true;
+    void report(const std::string& benchmark, const std::string& benchmark_case,
+                double seconds, const std::vector<Count>& counts)
+    {
+        std::printf("%s\n  {\"benchmark\": \"%s\", %s, \"seconds\": %.9f, ",
+                    is_first_result ? "" : ",",
+                    benchmark.c_str(), benchmark_case.c_str(), seconds);
+        for (const auto& count : counts)
+        {
+            std::printf("\"%s\": %zu, \"%s_per_second\": %.1f, ",
+                        count.unit.c_str(), count.count,
+                        count.unit.c_str(), count.count / seconds);
+        }
+        std::printf("\"peak_rss_kib\": %ld}", peak_rss_kib());
+        std::fflush(stdout);
+        is_first_result = false;
+    }
+
+    // Write a result as a JSON object. 'unit' is the name of the processed
+    // items, whose count is 'count'.
+    void report(const std::string& benchmark, const std::string& benchmark_case,
+                double seconds, const std::string& unit, std::size_t count)
+    {
+        report(benchmark, benchmark_case, seconds, { { unit, count } });
+    }
+
+    void bench_grammar(const Grammar& grammar)
+    {
+        InterpretationMap map { interpretation };
+        for (int depth : grammar.depths)
+        {
+            // Production of the last iteration, from the cached previous one.
+            std::size_t n_symbols = 0;
+            double seconds = measure([&]()
+                {
+                    LSystem lsys { grammar.axiom, grammar.rules };
+                    lsys.produce(depth - 1);
+                    return time([&]() { n_symbols = lsys.produce(depth).size(); });
+                });
+            report("produce", grammar_case(grammar, depth), seconds, "symbols", n_symbols);
+
+            // Interpretation, from the cached production.
+            LSystem lsys { grammar.axiom, grammar.rules };
+            auto snapshot = lsys.get_snapshot();
+            auto map_snapshot = map.get_snapshot();
+            snapshot->produce(depth);
+            DrawingParameters parameters;
+            parameters.delta_angle = grammar.delta_angle;
+            parameters.n_iter = depth;
+
+            geometry::Polylines paths;
+            seconds = measure([&]()
+                {
+                    return time([&]() { paths = compute_paths(*snapshot, *map_snapshot, parameters).paths; });
+                });
+            report("compute_paths", grammar_case(grammar, depth), seconds,
+                   { { "symbols", snapshot->produce(depth).size() },
+                     { "vertices", paths.positions.size() } });
+
+            // Bounding boxes of the interpretation.
+            sf::FloatRect box;
+            seconds = measure([&]()
+                {
+                    return time([&]() { box = geometry::compute_bounding_box(paths.positions); });
+                });
+            report("compute_bounding_box", grammar_case(grammar, depth), seconds,
+                   "vertices", paths.positions.size());
+
+            std::vector<sf::FloatRect> boxes;
+            seconds = measure([&]()
+                {
+                    return time([&]() { boxes = geometry::compute_sub_boxes(paths.positions, 8); });
+                });
+            report("compute_sub_boxes", grammar_case(grammar, depth), seconds,
+                   "vertices", paths.positions.size());
+        }
+    }
+
+    // An Observable notifying its observers on demand.
+    struct Subject : public Observable
+    {
+        void modify() { notify(); }
+    };
+
+    void bench_notify()
+    {
+        for (int n_observers : { 1, 16, 256, 4096 })
+        {
+            Subject subject;
+            std::size_t calls = 0;
+            for (int i = 0; i < n_observers; ++i)
+            {
+                subject.add_observer([&calls]() { ++calls; });
+            }
+
+            constexpr std::size_t n_notifications = 1000;
+            double seconds = measure([&]()
+                {
+                    return time([&]()
+                        {
+                            for (std::size_t i = 0; i < n_notifications; ++i)
+                            {
+                                subject.modify();
+                            }
+                        });
+                });
+            report("notify", "\"observers\": " + std::to_string(n_observers), seconds, "calls",
+                   n_notifications * n_observers);
+        }
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    std::vector<std::string> names (argv + 1, argv + argc);
+
+    std::printf("[");
+    for (const auto& grammar : corpus)
+    {
+        if (names.empty() ||
+            std::find(names.begin(), names.end(), grammar.name) != names.end())
+        {
+            bench_grammar(grammar);
+        }
+    }
+    if (names.empty())
+    {
+        bench_notify();
+    }
+    std::printf("\n]\n");
+
+    return 0;
+}
@@ -0,0 +1,660 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "LSystem.h"
+#include "Turtle.h"
+#include "InterpretationMap.h"
+#include "MemoryTracker.h"
+#include "Export.h"
+#include "Gallery.h"
+#include "Png.h"
+#include "Raster.h"
+#include "Session.h"
+#include "geometry.h"
+
+// Produce and interpret L-systems from the command line, without any window,
+// for example on render-farm nodes without a display.
+//
+// The LSystems, interpretations and views are defined in a file with the
+// format of the sessions (see 'Session.h'): the state after all its events is
+// used. A session recorded from the application is a valid definition.
+//
+// Usage: procgenCli.out <command> [options] <definitions>
+//
+// Commands:
+//   run    Compute the paths of the views, and report their timings and
+//          counts.
+//          -n <n_iter>  Override the number of iterations of the views.
+//          -v <id>      Only compute the view 'id'. Can be repeated.
+//          -o <output>  Write the paths of each view: on the standard output
+//                       if 'output' is '-', otherwise in the file
+//                       '<output>/view_<id>.txt' of the directory 'output'.
+//                       The report is then written on the standard error.
+//          -m           Report the memory usage of the LSystems.
+//   render Render the views in PNG images '<output>/view_<id>.png', with the
+//          colors of the application, and report their timings.
+//          -n <n_iter>  Override the number of iterations of the views.
+//          -v <id>      Only render the view 'id'. Can be repeated.
+//          -o <output>  The directory of the images, the current directory
+//                       by default.
+//          -W <width>   The width of the images, 1024 by default.
+//          -H <height>  The height of the images, 1024 by default.
+//          -a           Do not anti-alias the lines.
+//   gallery
+//          Render a contact sheet of each view sweeping its parameters,
+//          '<output>/gallery_<id>.png', with the timings and counts of each
+//          cell in '<output>/gallery_<id>.csv'. Each row of the sheet sweeps
+//          the angle. The parameters not swept are the ones of the view.
+//          -A <range>   The delta angles, in degree.
+//          -S <range>   The steps.
+//          -I <range>   The numbers of iterations.
+//          -v <id>      Only render the view 'id'. Can be repeated.
+//          -o <output>  The directory of the files, the current directory by
+//                       default.
+//          -W <width>   The width of the thumbnails, 128 by default.
+//          -H <height>  The height of the thumbnails, 128 by default.
+//          -a           Do not anti-alias the lines.
+//   export Export the views as vector images '<output>/view_<id>.<format>',
+//          written while the turtle moves, in bounded memory.
+//          -f <format>  'svg' (by default) or 'eps'.
+//          -n <n_iter>  Override the number of iterations of the views.
+//          -v <id>      Only export the view 'id'. Can be repeated.
+//          -o <output>  The directory of the images, the current directory
+//                       by default. If 'output' is '-', the image is written
+//                       on the standard output, and the report on the
+//                       standard error: exactly one view must be exported.
+//
+// A range is "<first>:<last>:<count>", the values being evenly spaced from
+// 'first' to 'last' included. By default, 'count' gives a step of 1, and
+// 'last' is 'first'. The steps and the numbers of iterations are rounded to
+// the nearest integer.
+//
+// The paths are written as text: one position "x y" per line, the polylines
+// being separated by an empty line (the format of gnuplot).
+
+using namespace drawing;
+
+namespace
+{
+    const char* const usage =
+        "Usage: procgenCli.out <command> [options] <definitions>\n"
+        "Commands:\n"
+        "  run [-n n_iter] [-v id]... [-o output] [-m] <definitions>\n"
+        "  render [-n n_iter] [-v id]... [-o output] [-W width] [-H height] [-a] <definitions>\n"
+        "  gallery [-A range] [-S range] [-I range] [-v id]... [-o output] [-W width] [-H height] [-a]\n"
+        "          <definitions>\n"
+        "  export [-f svg|eps] [-n n_iter] [-v id]... [-o output] <definitions>\n"
+        "A range is first[:last[:count]].\n";
+
+    // The values "<first>:<last>:<count>" of a sweep.
+    struct Range
+    {
+        double first { 0 };
+        double last { 0 };
+        int count { 0 };
+    };
+
+    // The options common to the commands.
+    struct Options
+    {
+        std::string definitions;
+        int n_iter { -1 };
+        std::vector<int> views;
+        std::string output;
+        bool memory { false };
+        // 0 for the default size of the command.
+        unsigned width { 0 };
+        unsigned height { 0 };
+        bool antialiasing { true };
+        Range delta_angles;
+        Range steps;
+        Range n_iters;
+        std::string format { "svg" };
+    };
+
+    // Parse the integer 'str' of the option 'option'.
+    // Exception:
+    //   - Throws 'std::invalid_argument' if 'str' is not an integer.
+    int parse_int(const std::string& option, const std::string& str)
+    {
+        std::size_t end = 0;
+        int value = 0;
+        try
+        {
+            value = std::stoi(str, &end);
+        }
+        catch (const std::exception&)
+        {
+        }
+        if (end == 0 || end != str.size())
+        {
+            throw std::invalid_argument("Invalid value of '" + option + "': '" + str + "'");
+        }
+        return value;
+    }
+
+    // Parse the number 'str' of the option 'option'.
+    // Exception:
+    //   - Throws 'std::invalid_argument' if 'str' is not a number.
+    double parse_double(const std::string& option, const std::string& str)
+    {
+        std::size_t end = 0;
+        double value = 0;
+        try
+        {
+            value = std::stod(str, &end);
+        }
+        catch (const std::exception&)
+        {
+        }
+        if (end == 0 || end != str.size())
+        {
+            throw std::invalid_argument("Invalid value of '" + option + "': '" + str + "'");
+        }
+        return value;
+    }
+
+    // Parse the range 'str' of the option 'option'.
+    // Exception:
+    //   - Throws 'std::invalid_argument' if 'str' is not a range.
+    Range parse_range(const std::string& option, const std::string& str)
+    {
+        std::vector<std::string> values;
+        std::size_t begin = 0;
+        for (auto end = str.find(':'); end != std::string::npos; end = str.find(':', begin))
+        {
+            values.push_back(str.substr(begin, end - begin));
+            begin = end + 1;
+        }
+        values.push_back(str.substr(begin));
+        if (values.size() > 3)
+        {
+            throw std::invalid_argument("Invalid range of '" + option + "': '" + str + "'");
+        }
+
+        Range range;
+        range.first = parse_double(option, values[0]);
+        range.last = values.size() > 1 ? parse_double(option, values[1]) : range.first;
+        range.count = values.size() > 2
+            ? parse_int(option, values[2])
+            : static_cast<int>(std::abs(range.last - range.first)) + 1;
+        if (range.count <= 0)
+        {
+            throw std::invalid_argument("Invalid range of '" + option + "': '" + str + "'");
+        }
+        return range;
+    }
+
+    // Parse the arguments of a command.
+    // Exception:
+    //   - Throws 'std::invalid_argument' if an argument is invalid.
+    Options parse_options(const std::vector<std::string>& args)
+    {
+        Options options;
+        for (std::size_t i = 0; i < args.size(); ++i)
+        {
+            const auto& arg = args[i];
+            auto value = [&args, &i, &arg]()
+                {
+                    if (i + 1 >= args.size())
+                    {
+                        throw std::invalid_argument("Missing value of '" + arg + "'");
+                    }
+                    return args[++i];
+                };
+
+            if (arg == "-n")
+            {
+                options.n_iter = parse_int(arg, value());
+            }
+            else if (arg == "-v")
+            {
+                options.views.push_back(parse_int(arg, value()));
+            }
+            else if (arg == "-o")
+            {
+                options.output = value();
+            }
+            else if (arg == "-m")
+            {
+                options.memory = true;
+            }
+            else if (arg == "-W" || arg == "-H")
+            {
+                int size = parse_int(arg, value());
+                if (size <= 0)
+                {
+                    throw std::invalid_argument("Invalid value of '" + arg + "': " + std::to_string(size));
+                }
+                if (arg == "-W")
+                {
+                    options.width = size;
+                }
+                else
+                {
+                    options.height = size;
+                }
+            }
+            else if (arg == "-a")
+            {
+                options.antialiasing = false;
+            }
+            else if (arg == "-A")
+            {
+                options.delta_angles = parse_range(arg, value());
+            }
+            else if (arg == "-S")
+            {
+                options.steps = parse_range(arg, value());
+            }
+            else if (arg == "-I")
+            {
+                options.n_iters = parse_range(arg, value());
+            }
+            else if (arg == "-f")
+            {
+                options.format = value();
+                if (options.format != "svg" && options.format != "eps")
+                {
+                    throw std::invalid_argument("Unknown format '" + options.format + "'");
+                }
+            }
+            else if (options.definitions.empty() && arg.front() != '-')
+            {
+                options.definitions = arg;
+            }
+            else
+            {
+                throw std::invalid_argument("Unknown argument '" + arg + "'");
+            }
+        }
+        if (options.definitions.empty())
+        {
+            throw std::invalid_argument("Missing definitions");
+        }
+        return options;
+    }
+
+    // Read the definitions and apply the options to the views.
+    // Exception:
+    //   - Throws 'std::runtime_error' if the file can not be read or a view
+    //   is not defined.
+    SessionState load(const Options& options)
+    {
+        std::ifstream file (options.definitions);
+        if (!file)
+        {
+            throw std::runtime_error("Could not open '" + options.definitions + "'");
+        }
+        SessionState state;
+        for (const auto& event : read_session(file))
+        {
+            state.apply(event);
+        }
+
+        for (auto id : options.views)
+        {
+            if (state.views.count(id) == 0)
+            {
+                throw std::runtime_error("The view " + std::to_string(id) + " is not defined");
+            }
+        }
+        if (!options.views.empty())
+        {
+            for (auto it = state.views.begin(); it != state.views.end(); )
+            {
+                bool is_selected = std::find(options.views.begin(), options.views.end(), it->first) != options.views.end();
+                it = is_selected ? std::next(it) : state.views.erase(it);
+            }
+        }
+        if (options.n_iter >= 0)
+        {
+            for (auto& view : state.views)
+            {
+                view.second.parameters.n_iter = options.n_iter;
+            }
+        }
+        return state;
+    }
+
+    void write_paths(std::ostream& os, const geometry::Polylines& paths)
+    {
+        auto next_break = paths.breaks.begin();
+        std::size_t i = 0;
+        for (const auto& chunk : paths.positions.chunks())
+        {
+            for (const auto& position : chunk)
+            {
+                if (next_break != paths.breaks.end() && *next_break == i)
+                {
+                    os << '\n';
+                    ++next_break;
+                }
+                os << position.x << ' ' << position.y << '\n';
+                ++i;
+            }
+        }
+    }
+
+    double milliseconds_since(std::chrono::steady_clock::time_point start)
+    {
+        return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    }
+
+    int run(const Options& options)
+    {
+        auto state = load(options);
+
+        // The report does not mix with the paths on the standard output.
+        std::ostream& report = options.output == "-" ? std::cerr : std::cout;
+
+        std::vector<int> memory_sources;
+        if (options.memory)
+        {
+            for (const auto& lsys : state.lsystems)
+            {
+                auto model = lsys.second;
+                memory_sources.push_back(
+                    MemoryTracker::global().add_source("LSystem " + std::to_string(lsys.first),
+                                                       [model]() { return model->memory_usage(); }));
+            }
+        }
+
+        for (const auto& entry : state.views)
+        {
+            const auto& view = entry.second;
+            auto& lsys = *state.lsystems.at(view.lsystem);
+            auto& map = *state.interpretations.at(view.interpretation);
+
+            // The production is cached in the LSystem, and shared by the
+            // views of the same LSystem with the same number of iterations.
+            auto start = std::chrono::steady_clock::now();
+            const auto& symbols = lsys.produce(view.parameters.n_iter);
+            double production = milliseconds_since(start);
+
+            start = std::chrono::steady_clock::now();
+            auto paths = compute_paths(lsys, map, view.parameters);
+            double interpretation = milliseconds_since(start);
+            auto box = geometry::compute_bounding_box(paths.positions);
+
+            report << "view " << entry.first << ": n_iter " << view.parameters.n_iter
+                   << ", " << symbols.size() << " symbols, "
+                   << paths.positions.size() << " positions, "
+                   << paths.breaks.size() + (paths.positions.size() > 0 ? 1 : 0) << " polylines\n"
+                   << "    production: " << production << " ms\n"
+                   << "    interpretation: " << interpretation << " ms\n"
+                   << "    bounding box: " << box.left << ' ' << box.top << ' '
+                   << box.width << ' ' << box.height << '\n';
+
+            if (options.output == "-")
+            {
+                std::cout << "# view " << entry.first << '\n';
+                write_paths(std::cout, paths);
+                std::cout << "\n\n";
+            }
+            else if (!options.output.empty())
+            {
+                auto path = options.output + "/view_" + std::to_string(entry.first) + ".txt";
+                std::ofstream file (path);
+                write_paths(file, paths);
+                if (!file)
+                {
+                    throw std::runtime_error("Could not write '" + path + "'");
+                }
+            }
+        }
+
+        if (options.memory)
+        {
+            MemoryTracker::global().dump(report);
+            for (auto id : memory_sources)
+            {
+                MemoryTracker::global().remove_source(id);
+            }
+        }
+        return 0;
+    }
+
+    int render(const Options& options)
+    {
+        auto state = load(options);
+        auto directory = options.output.empty() ? std::string(".") : options.output;
+
+        for (const auto& entry : state.views)
+        {
+            const auto& view = entry.second;
+            auto& lsys = *state.lsystems.at(view.lsystem);
+            auto& map = *state.interpretations.at(view.interpretation);
+
+            auto start = std::chrono::steady_clock::now();
+            auto paths = compute_paths(lsys, map, view.parameters);
+            double interpretation = milliseconds_since(start);
+
+            // The image is framed on the drawing.
+            raster::RasterParameters parameters;
+            parameters.width = options.width > 0 ? options.width : 1024;
+            parameters.height = options.height > 0 ? options.height : 1024;
+            parameters.view = raster::fit_view(geometry::compute_bounding_box(paths.positions),
+                                               parameters.width, parameters.height);
+            parameters.antialiasing = options.antialiasing;
+            start = std::chrono::steady_clock::now();
+            auto image = raster::rasterize(paths, parameters);
+            double rasterization = milliseconds_since(start);
+
+            auto path = directory + "/view_" + std::to_string(entry.first) + ".png";
+            start = std::chrono::steady_clock::now();
+            if (!raster::save_png(path, image))
+            {
+                throw std::runtime_error("Could not write '" + path + "'");
+            }
+            double encoding = milliseconds_since(start);
+
+            std::cout << "view " << entry.first << ": n_iter " << view.parameters.n_iter
+                      << ", " << paths.positions.size() << " positions, "
+                      << image.width << 'x' << image.height << " pixels\n"
+                      << "    production and interpretation: " << interpretation << " ms\n"
+                      << "    rasterization: " << rasterization << " ms\n"
+                      << "    encoding: " << encoding << " ms\n";
+        }
+        return 0;
+    }
+
+    // Get the integers of 'range', or 'value' if 'range' is not set.
+    std::vector<int> integer_values(const Range& range, int value)
+    {
+        if (range.count == 0)
+        {
+            return { value };
+        }
+        std::vector<int> values;
+        for (auto v : linear_range(range.first, range.last, range.count))
+        {
+            values.push_back(static_cast<int>(std::lround(v)));
+        }
+        return values;
+    }
+
+    int gallery(const Options& options)
+    {
+        auto state = load(options);
+        auto directory = options.output.empty() ? std::string(".") : options.output;
+
+        for (const auto& entry : state.views)
+        {
+            const auto& view = entry.second;
+
+            ParameterSweep sweep;
+            sweep.base = view.parameters;
+            if (options.delta_angles.count == 0)
+            {
+                sweep.delta_angles = { view.parameters.delta_angle };
+            }
+            else
+            {
+                sweep.delta_angles = linear_range(math::degree_to_rad(options.delta_angles.first),
+                                                  math::degree_to_rad(options.delta_angles.last),
+                                                  options.delta_angles.count);
+            }
+            sweep.steps = integer_values(options.steps, view.parameters.step);
+            sweep.n_iters = integer_values(options.n_iters, view.parameters.n_iter);
+            for (auto n : sweep.n_iters)
+            {
+                if (n < 0)
+                {
+                    throw std::runtime_error("Invalid number of iterations: " + std::to_string(n));
+                }
+            }
+
+            GalleryParameters parameters;
+            parameters.thumbnail.width = options.width > 0 ? options.width : 128;
+            parameters.thumbnail.height = options.height > 0 ? options.height : 128;
+            parameters.thumbnail.antialiasing = options.antialiasing;
+
+            auto start = std::chrono::steady_clock::now();
+            auto cells = compute_gallery(*state.lsystems.at(view.lsystem)->get_snapshot(),
+                                         *state.interpretations.at(view.interpretation)->get_snapshot(),
+                                         sweep, parameters);
+            double duration = milliseconds_since(start);
+
+            auto columns = static_cast<unsigned>(sweep.delta_angles.size());
+            auto path = directory + "/gallery_" + std::to_string(entry.first);
+            if (!raster::save_png(path + ".png", make_contact_sheet(cells, columns)))
+            {
+                throw std::runtime_error("Could not write '" + path + ".png'");
+            }
+            std::ofstream csv (path + ".csv");
+            write_gallery_csv(csv, cells, columns);
+            if (!csv)
+            {
+                throw std::runtime_error("Could not write '" + path + ".csv'");
+            }
+
+            std::cout << "view " << entry.first << ": " << cells.size() << " cells, "
+                      << columns << " columns, " << duration << " ms\n";
+        }
+        return 0;
+    }
+
+    int export_views(const Options& options)
+    {
+        auto state = load(options);
+        auto directory = options.output.empty() ? std::string(".") : options.output;
+        std::ostream& report = options.output == "-" ? std::cerr : std::cout;
+        // The images concatenated on the standard output would not be valid.
+        if (options.output == "-" && state.views.size() != 1)
+        {
+            throw std::runtime_error("Exporting on the standard output requires exactly one view, "
+                                     "selected with '-v'");
+        }
+
+        for (const auto& entry : state.views)
+        {
+            const auto& view = entry.second;
+            auto lsys = state.lsystems.at(view.lsystem)->get_snapshot();
+            auto interpretation = state.interpretations.at(view.interpretation)->get_snapshot();
+
+            std::ofstream file;
+            std::string path = "standard output";
+            if (options.output != "-")
+            {
+                path = directory + "/view_" + std::to_string(entry.first) + "." + options.format;
+                file.open(path, std::ios::binary);
+                if (!file)
+                {
+                    throw std::runtime_error("Could not open '" + path + "'");
+                }
+            }
+            std::ostream& os = options.output == "-" ? std::cout : file;
+
+            auto start = std::chrono::steady_clock::now();
+            std::size_t size = 0;
+            if (options.format == "svg")
+            {
+                // The view of the document is computed by a first
+                // interpretation, which does not store the paths either.
+                exporter::BoundsSink bounds;
+                stream_paths(*lsys, *interpretation, view.parameters, bounds);
+                auto box = bounds.get_bounding_box();
+                exporter::ExportParameters style;
+                float margin = std::max(box.width, box.height) * 0.02f + style.line_width;
+                sf::FloatRect document {box.left - margin, box.top - margin,
+                                        box.width + 2 * margin, box.height + 2 * margin};
+
+                exporter::SvgWriter svg (os, document, style);
+                stream_paths(*lsys, *interpretation, view.parameters, svg);
+                svg.finish();
+                size = svg.get_size();
+            }
+            else
+            {
+                exporter::EpsWriter eps (os);
+                stream_paths(*lsys, *interpretation, view.parameters, eps);
+                eps.finish();
+                size = eps.get_size();
+            }
+            double duration = milliseconds_since(start);
+            if (!os)
+            {
+                throw std::runtime_error("Could not write '" + path + "'");
+            }
+
+            report << "view " << entry.first << ": n_iter " << view.parameters.n_iter
+                   << ", " << size << " bytes written in " << path << ", "
+                   << duration << " ms\n";
+        }
+        return 0;
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    std::vector<std::string> args (argv + 1, argv + argc);
+    if (args.empty())
+    {
+        std::fprintf(stderr, "%s", usage);
+        return 1;
+    }
+    auto command = args.front();
+    args.erase(args.begin());
+
+    try
+    {
+        if (command == "run")
+        {
+            return run(parse_options(args));
+        }
+        if (command == "render")
+        {
+            return render(parse_options(args));
+        }
+        if (command == "gallery")
+        {
+            return gallery(parse_options(args));
+        }
+        if (command == "export")
+        {
+            return export_views(parse_options(args));
+        }
+        std::fprintf(stderr, "Unknown command '%s'\n%s", command.c_str(), usage);
+        return 1;
+    }
+    catch (const std::invalid_argument& e)
+    {
+        std::fprintf(stderr, "%s\n%s", e.what(), usage);
+        return 1;
+    }
+    catch (const std::exception& e)
+    {
+        std::fprintf(stderr, "%s\n", e.what());
+        return 1;
+    }
+}
@@ -1,45 +1,433 @@
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <unordered_set>
+#if defined(__SSE__)
+#include <xmmintrin.h>
+#endif
 #include <gsl/gsl>
+#include "Trace.h"
 #include "geometry.h"
 
 namespace geometry
 {
-    sf::FloatRect compute_bounding_box(const std::vector<sf::Vertex>& vertices)
+    namespace
     {
-        if (vertices.size() == 0)
+        // The bounding box of the positions [first, last].
+        sf::FloatRect box_of(const ChunkedVector<sf::Vector2f>& positions,
+                             std::size_t first, std::size_t last)
+        {
+            float left = positions[first].x, right = left;
+            float top = positions[first].y, down = top;
+            for (const auto& chunk : positions.chunks(first, last + 1))
+            {
+                for (const auto& p : chunk)
+                {
+                    left  = std::min(left, p.x);
+                    right = std::max(right, p.x);
+                    top   = std::min(top, p.y);
+                    down  = std::max(down, p.y);
+                }
+            }
+            return { left, top, right - left, down - top };
+        }
+
+        // The union of two boxes.
+        sf::FloatRect merge(const sf::FloatRect& a, const sf::FloatRect& b)
+        {
+            float left  = std::min(a.left, b.left);
+            float top   = std::min(a.top, b.top);
+            float right = std::max(a.left + a.width, b.left + b.width);
+            float down  = std::max(a.top + a.height, b.top + b.height);
+            return { left, top, right - left, down - top };
+        }
+
+        // The squared distance between 'p' and the segment [a, b].
+        float squared_distance(const sf::Vector2f& p, const sf::Vector2f& a, const sf::Vector2f& b)
+        {
+            sf::Vector2f ab = b - a;
+            sf::Vector2f ap = p - a;
+            float length = ab.x * ab.x + ab.y * ab.y;
+            float t = length > 0 ? (ap.x * ab.x + ap.y * ab.y) / length : 0;
+            t = std::max(0.f, std::min(1.f, t));
+            sf::Vector2f d = ap - ab * t;
+            return d.x * d.x + d.y * d.y;
+        }
+
+        // Douglas-Peucker on the polyline [first, last]: mark the positions
+        // to keep in 'keep'. The recursion is done with an explicit stack, as
+        // a polyline can contain millions of positions.
+        void simplify_polyline(const ChunkedVector<sf::Vector2f>& positions,
+                               std::size_t first, std::size_t last,
+                               float squared_tolerance,
+                               std::vector<bool>& keep)
+        {
+            keep[first] = true;
+            keep[last] = true;
+
+            std::vector<std::pair<std::size_t, std::size_t>> stack { {first, last} };
+            while (!stack.empty())
+            {
+                auto segment = stack.back();
+                stack.pop_back();
+                if (segment.second <= segment.first + 1)
+                {
+                    // No position between the ends.
+                    continue;
+                }
+
+                const auto& a = positions[segment.first];
+                const auto& b = positions[segment.second];
+                float farthest_distance = 0;
+                std::size_t farthest = segment.first;
+                for (const auto& chunk : positions.chunks(segment.first + 1, segment.second))
+                {
+                    for (std::size_t k = 0; k < chunk.size; ++k)
+                    {
+                        float distance = squared_distance(chunk.data[k], a, b);
+                        if (distance > farthest_distance)
+                        {
+                            farthest_distance = distance;
+                            farthest = chunk.offset + k;
+                        }
+                    }
+                }
+
+                if (farthest_distance > squared_tolerance)
+                {
+                    keep[farthest] = true;
+                    stack.push_back({segment.first, farthest});
+                    stack.push_back({farthest, segment.second});
+                }
+            }
+        }
+    }
+
+    constexpr std::size_t SegmentIndex::npos;
+    constexpr std::size_t SegmentIndex::segments_per_leaf;
+
+    std::size_t memory_usage(const Polylines& paths)
+    {
+        return paths.positions.memory_usage() + paths.breaks.capacity() * sizeof(std::size_t);
+    }
+
+    SegmentIndex::SegmentIndex(const Polylines& paths)
+    {
+        TRACE_SCOPE("geometry", "index");
+        const auto& positions = paths.positions;
+        if (positions.size() < 2)
+        {
+            return;
+        }
+        std::size_t n_segments = positions.size() - 1;
+
+        // Compute the boxes of the leaves, and build the tree over them.
+        std::size_t n_leaves = (n_segments + segments_per_leaf - 1) / segments_per_leaf;
+        std::vector<sf::FloatRect> leaf_boxes;
+        leaf_boxes.reserve(n_leaves);
+        for (std::size_t i = 0; i < n_leaves; ++i)
+        {
+            std::size_t first = i * segments_per_leaf;
+            std::size_t last = std::min(first + segments_per_leaf, n_segments);
+            leaf_boxes.push_back(box_of(positions, first, last));
+        }
+
+        nodes_.reserve(2 * n_leaves);
+        build(leaf_boxes, 0, n_leaves, n_segments);
+    }
+
+    int SegmentIndex::build(const std::vector<sf::FloatRect>& leaf_boxes,
+                            std::size_t first_leaf, std::size_t last_leaf,
+                            std::size_t n_segments)
+    {
+        int index = nodes_.size();
+        nodes_.push_back({});
+
+        Node node;
+        node.first = first_leaf * segments_per_leaf;
+        node.last = std::min(last_leaf * segments_per_leaf, n_segments);
+        if (last_leaf - first_leaf == 1)
+        {
+            node.box = leaf_boxes.at(first_leaf);
+            node.left = -1;
+            node.right = -1;
+        }
+        else
+        {
+            std::size_t middle = first_leaf + (last_leaf - first_leaf) / 2;
+            node.left = build(leaf_boxes, first_leaf, middle, n_segments);
+            node.right = build(leaf_boxes, middle, last_leaf, n_segments);
+            node.box = merge(nodes_.at(node.left).box, nodes_.at(node.right).box);
+        }
+
+        // 'nodes_' may be reallocated by the recursive calls: the node is
+        // assigned at the end.
+        nodes_.at(index) = node;
+        return index;
+    }
+
+    std::size_t SegmentIndex::find_segment(const Polylines& paths,
+                                           const sf::Vector2f& point,
+                                           float tolerance) const
+    {
+        std::size_t nearest = npos;
+        float nearest_distance = tolerance * tolerance;
+        if (nodes_.empty())
+        {
+            return nearest;
+        }
+
+        // Depth-first traversal of the nodes near 'point'.
+        sf::FloatRect area { point.x - tolerance, point.y - tolerance,
+                             2 * tolerance, 2 * tolerance };
+        std::vector<int> stack { 0 };
+        while (!stack.empty())
+        {
+            const auto& node = nodes_.at(stack.back());
+            stack.pop_back();
+
+            if (!intersects(node.box, area))
+            {
+                continue;
+            }
+            if (node.left >= 0)
+            {
+                stack.push_back(node.left);
+                stack.push_back(node.right);
+                continue;
+            }
+
+            // The next break of the leaf. The segment 'i - 1' ends at the
+            // position 'i', possibly in the next chunk.
+            Expects(node.last < paths.positions.size());
+            auto next_break = std::upper_bound(paths.breaks.begin(), paths.breaks.end(), node.first);
+            const sf::Vector2f* a = nullptr;
+            for (const auto& chunk : paths.positions.chunks(node.first, node.last + 1))
+            {
+                for (std::size_t k = 0; k < chunk.size; ++k)
+                {
+                    const auto& b = chunk.data[k];
+                    std::size_t i = chunk.offset + k;
+                    if (i > node.first)
+                    {
+                        if (next_break != paths.breaks.end() && *next_break == i)
+                        {
+                            // Not a segment: a jump between two polylines.
+                            ++next_break;
+                        }
+                        else
+                        {
+                            float distance = squared_distance(point, *a, b);
+                            if (distance <= nearest_distance)
+                            {
+                                nearest = i - 1;
+                                nearest_distance = distance;
+                            }
+                        }
+                    }
+                    a = &b;
+                }
+            }
+        }
+        return nearest;
+    }
+
+    std::vector<SegmentIndex::range> SegmentIndex::find_ranges(const sf::FloatRect& rect) const
+    {
+        std::vector<range> ranges;
+        if (nodes_.empty())
+        {
+            return ranges;
+        }
+
+        // Depth-first traversal, left child first: the leaves are found in
+        // order, so the ranges are sorted.
+        std::vector<int> stack { 0 };
+        while (!stack.empty())
+        {
+            const auto& node = nodes_.at(stack.back());
+            stack.pop_back();
+
+            if (!intersects(node.box, rect))
+            {
+                continue;
+            }
+            if (node.left >= 0)
+            {
+                stack.push_back(node.right);
+                stack.push_back(node.left);
+                continue;
+            }
+
+            // The segments [first, last) link the positions [first, last].
+            range r { node.first, node.last + 1 };
+            if (!ranges.empty() && r.first < ranges.back().second)
+            {
+                ranges.back().second = r.second;
+            }
+            else
+            {
+                ranges.push_back(r);
+            }
+        }
+        return ranges;
+    }
+
+    std::size_t SegmentIndex::memory_usage() const
+    {
+        return nodes_.capacity() * sizeof(Node);
+    }
+
+    sf::FloatRect compute_bounding_box(const std::vector<sf::Vector2f>& positions)
+    {
+        if (positions.size() == 0)
         {
             return { 0, 0, 0, 0 };
         }
-        const auto& first = vertices.at(0);
+        const auto& first = positions.at(0);
         // Warning: 'top' is at low value because of the axes defined by SFML.
-        float top = first.position.y, down = first.position.y;
-        float left = first.position.x, right = first.position.x;
+        float top = first.y, down = first.y;
+        float left = first.x, right = first.x;
 
-        // For each vertices, update the bounding box coordinates if necessary.
-        for (const auto& v : vertices)
+        // For each positions, update the bounding box coordinates if necessary.
+        for (const auto& p : positions)
         {
-            if (v.position.y < top)
+            if (p.y < top)
             {
-                top = v.position.y;
+                top = p.y;
             }
-            else if (v.position.y > down)
+            else if (p.y > down)
             {
-                down = v.position.y;
+                down = p.y;
             }
 
-            if (v.position.x > right)
+            if (p.x > right)
             {
-                right = v.position.x;
+                right = p.x;
             }
-            else if (v.position.x < left)
+            else if (p.x < left)
             {
-                left = v.position.x;
+                left = p.x;
             }
         }
         return {left, top, right - left, down - top};
     }
-    
-    std::vector<sf::FloatRect> compute_sub_boxes(const std::vector<sf::Vertex>& vertices,
-                                                 int max_boxes)
+
+    sf::FloatRect compute_bounding_box(const ChunkedVector<sf::Vector2f>& positions)
+    {
+        TRACE_SCOPE("geometry", "compute_bounding_box");
+        if (positions.size() == 0)
+        {
+            return { 0, 0, 0, 0 };
+        }
+
+        float top = positions[0].y, down = top;
+        float left = positions[0].x, right = left;
+
+        // Each chunk is a contiguous array of floats 'x0 y0 x1 y1 ...'. With
+        // SSE, two positions are reduced at once: the lanes of 'minimum' are
+        // '(left, top, left, top)' and the ones of 'maximum' are
+        // '(right, down, right, down)'.
+#if defined(__SSE__)
+        __m128 minimum = _mm_setr_ps(left, top, left, top);
+        __m128 maximum = minimum;
+#endif
+        for (const auto& chunk : positions.chunks())
+        {
+            std::size_t i = 0;
+#if defined(__SSE__)
+            const float* data = &chunk.data[0].x;
+            for (; i + 2 <= chunk.size; i += 2)
+            {
+                __m128 pair = _mm_loadu_ps(data + 2 * i);
+                minimum = _mm_min_ps(minimum, pair);
+                maximum = _mm_max_ps(maximum, pair);
+            }
+#endif
+            for (; i < chunk.size; ++i)
+            {
+                const auto& p = chunk.data[i];
+                top   = std::min(top, p.y);
+                down  = std::max(down, p.y);
+                left  = std::min(left, p.x);
+                right = std::max(right, p.x);
+            }
+        }
+#if defined(__SSE__)
+        alignas(16) float lanes[4];
+        _mm_store_ps(lanes, minimum);
+        left = std::min({left, lanes[0], lanes[2]});
+        top  = std::min({top, lanes[1], lanes[3]});
+        _mm_store_ps(lanes, maximum);
+        right = std::max({right, lanes[0], lanes[2]});
+        down  = std::max({down, lanes[1], lanes[3]});
+#endif
+        return {left, top, right - left, down - top};
+    }
+
+    BoxAccumulator::BoxAccumulator()
+        : BoxAccumulator(std::numeric_limits<std::size_t>::max())
+    {
+    }
+
+    BoxAccumulator::BoxAccumulator(std::size_t positions_per_box)
+        : positions_per_box_ {positions_per_box}
+        , boxes_ {}
+        , count_ {0}
+        , left_ {0}, top_ {0}, right_ {0}, down_ {0}
+        , last_ {0, 0}
+    {
+        Expects(positions_per_box >= 2);
+    }
+
+    void BoxAccumulator::reserve(std::size_t n_positions)
+    {
+        // Each sub-box after the first one starts at the last position of the
+        // previous one.
+        boxes_.reserve(n_positions / (positions_per_box_ - 1) + 1);
+    }
+
+    void BoxAccumulator::replace_last(const sf::Vector2f& position)
+    {
+        Expects(count_ > 0);
+        left_  = std::min(left_, position.x);
+        right_ = std::max(right_, position.x);
+        top_   = std::min(top_, position.y);
+        down_  = std::max(down_, position.y);
+        last_ = position;
+    }
+
+    std::vector<sf::FloatRect> BoxAccumulator::get_sub_boxes() const
+    {
+        std::vector<sf::FloatRect> boxes;
+        boxes.reserve(boxes_.size() + 1);
+        boxes.insert(boxes.end(), boxes_.begin(), boxes_.end());
+        if (count_ > 0)
+        {
+            boxes.push_back({left_, top_, right_ - left_, down_ - top_});
+        }
+        return boxes;
+    }
+
+    sf::FloatRect BoxAccumulator::get_bounding_box() const
+    {
+        if (count_ == 0 && boxes_.empty())
+        {
+            return { 0, 0, 0, 0 };
+        }
+        // The current sub-box is merged without copying the sub-boxes.
+        sf::FloatRect box = count_ > 0 ?
+            sf::FloatRect(left_, top_, right_ - left_, down_ - top_) :
+            boxes_.front();
+        for (const auto& b : boxes_)
+        {
+            box = merge(box, b);
+        }
+        return box;
+    }
+
+    std::size_t compute_positions_per_box(std::size_t n_positions, int max_boxes)
     {
         Expects(max_boxes > 0);
 
@@ -50,52 +438,220 @@ namespace geometry
             max_boxes = 2;
         }
 
-        std::vector<sf::FloatRect> boxes;
-
         // Each bounding_box must have rougly the same number of
-        // vertices. However, it can not be exact: the number of vertices may
+        // positions. However, it can not be exact: the number of positions may
         // not a multiple of the number of boxes. As a consequence the last
         // boxes will be the remainder of the division. That's why, to respect
         // the number of 'max_boxes', we divide by 'max_boxes-1'.
         // Edge case: If 'max_boxes' is equal to 1 or 2, it will be a single
         // bounding box, as there are not any remainder.
-        int vertices_per_box = vertices.size()  / (max_boxes-1);
+        std::size_t positions_per_box = n_positions / (max_boxes-1);
 
         // The algorithm makes overlapping boxes. We must have a least 3
-        // vertices per box.
-        // As it overlaps, several vertices are shared, so the effective number
-        // of vertices is greater than the real number. As a consequence, for
-        // low count of vertices, it returns a number of boxes greater than
+        // positions per box.
+        // As it overlaps, several positions are shared, so the effective number
+        // of positions is greater than the real number. As a consequence, for
+        // low count of positions, it returns a number of boxes greater than
         // 'max_boxes'
-        vertices_per_box = vertices_per_box < 3 ? 3 : vertices_per_box;
-        
-        int n = 0;
-        std::vector<sf::Vertex> box_vertices;
-        for (size_t i = 0; i<vertices.size(); ++i)
+        return positions_per_box < 3 ? 3 : positions_per_box;
+    }
+
+    std::vector<sf::FloatRect> compute_sub_boxes(const ChunkedVector<sf::Vector2f>& positions,
+                                                 int max_boxes)
+    {
+        TRACE_SCOPE("geometry", "compute_sub_boxes");
+        BoxAccumulator boxes (compute_positions_per_box(positions.size(), max_boxes));
+        boxes.reserve(positions.size());
+        for (const auto& chunk : positions.chunks())
+        {
+            for (const auto& p : chunk)
+            {
+                boxes.add(p);
+            }
+        }
+        return boxes.get_sub_boxes();
+    }
+
+    bool contains(const sf::FloatRect& box, const sf::Vector2f& point)
+    {
+        return point.x >= box.left && point.x <= box.left + box.width &&
+               point.y >= box.top  && point.y <= box.top + box.height;
+    }
+
+    bool intersects(const sf::FloatRect& a, const sf::FloatRect& b)
+    {
+        return a.left <= b.left + b.width  && b.left <= a.left + a.width &&
+               a.top  <= b.top  + b.height && b.top  <= a.top  + a.height;
+    }
+
+    Polylines simplify(const Polylines& paths, float tolerance)
+    {
+        TRACE_SCOPE("geometry", "simplify");
+        Expects(tolerance >= 0);
+
+        const auto& positions = paths.positions;
+        std::vector<bool> keep (positions.size(), false);
+        std::size_t first = 0;
+        for (std::size_t i = 0; i <= paths.breaks.size(); ++i)
+        {
+            std::size_t last = i < paths.breaks.size() ? paths.breaks[i] : positions.size();
+            if (first < last)
+            {
+                simplify_polyline(positions, first, last - 1, tolerance * tolerance, keep);
+            }
+            first = last;
+        }
+
+        Polylines simplified;
+        auto next_break = paths.breaks.begin();
+        for (const auto& chunk : positions.chunks())
+        {
+            for (std::size_t k = 0; k < chunk.size; ++k)
+            {
+                std::size_t j = chunk.offset + k;
+                if (next_break != paths.breaks.end() && *next_break == j)
+                {
+                    simplified.breaks.push_back(simplified.positions.size());
+                    ++next_break;
+                }
+                if (keep[j])
+                {
+                    simplified.positions.push_back(chunk.data[k]);
+                }
+            }
+        }
+        return simplified;
+    }
+
+    Polylines deduplicate(const Polylines& paths, float quantum)
+    {
+        TRACE_SCOPE("geometry", "deduplicate");
+        Expects(quantum > 0);
+
+        // The key of a quantized position: its two coordinates on the grid,
+        // on 64 bits each so that distant positions never share a key. The
+        // coordinates are clamped to not overflow the conversion.
+        struct GridPoint
+        {
+            std::int64_t x;
+            std::int64_t y;
+            bool operator==(const GridPoint& other) const { return x == other.x && y == other.y; }
+            bool operator!=(const GridPoint& other) const { return !(*this == other); }
+            bool operator<(const GridPoint& other) const { return x < other.x || (x == other.x && y < other.y); }
+        };
+        auto quantize = [quantum](float v)
+            {
+                const double limit = 4e18;
+                double q = std::max(-limit, std::min(limit, static_cast<double>(v) / quantum));
+                return static_cast<std::int64_t>(std::llround(q));
+            };
+        auto key = [&quantize](const sf::Vector2f& p)
+            {
+                return GridPoint { quantize(p.x), quantize(p.y) };
+            };
+
+        // The key of a segment does not depend on its direction.
+        struct SegmentHash
         {
-            // Create a box when the number of vertices is attained
-            if (n == vertices_per_box)
+            std::size_t operator()(const std::pair<GridPoint, GridPoint>& s) const
             {
-                n = 0;
-                i -= 2; // Go back to count several time the number of vertices
-                        // to make overlapping boxes
-                boxes.push_back(compute_bounding_box(box_vertices));
-                box_vertices.clear();
+                std::uint64_t h = static_cast<std::uint64_t>(s.first.x);
+                for (auto v : { s.first.y, s.second.x, s.second.y })
+                {
+                    h = (h ^ static_cast<std::uint64_t>(v)) * 0x9E3779B97F4A7C15ull;
+                }
+                return std::hash<std::uint64_t>()(h ^ (h >> 32));
             }
+        };
+        std::unordered_set<std::pair<GridPoint, GridPoint>, SegmentHash> segments;
+        segments.reserve(paths.positions.size());
 
-            // Add a vertex to the next box.
-            box_vertices.push_back(vertices.at(i));
-            ++n;
+        Polylines unique;
+        GridPoint last_key { 0, 0 };
+        auto next_break = paths.breaks.begin();
+        for (std::size_t i = 0; i + 1 < paths.positions.size(); ++i)
+        {
+            if (next_break != paths.breaks.end() && *next_break == i + 1)
+            {
+                // Not a segment: a jump between two polylines.
+                ++next_break;
+                continue;
+            }
+
+            const auto& a = paths.positions[i];
+            const auto& b = paths.positions[i + 1];
+            auto key_a = key(a);
+            auto key_b = key(b);
+            if (key_a == key_b ||
+                !segments.insert({std::min(key_a, key_b), std::max(key_a, key_b)}).second)
+            {
+                continue;
+            }
 
-            // For the final box, the remainder of the vertices does not attain
-            // 'vertices_per_box', so manually set it.
-            if (i == vertices.size()-1)
+            // The segment continues the last polyline if it starts where the
+            // polyline ends. Otherwise, it starts a new one.
+            if (unique.positions.empty() || last_key != key_a)
             {
-                boxes.push_back(compute_bounding_box(box_vertices));
+                if (!unique.positions.empty())
+                {
+                    unique.breaks.push_back(unique.positions.size());
+                }
+                unique.positions.push_back(a);
             }
+            unique.positions.push_back(b);
+            last_key = key_b;
         }
+        return unique;
+    }
 
-        return boxes;
+    std::size_t memory_usage(const LodLevel& level)
+    {
+        return memory_usage(level.paths) + level.index.memory_usage();
     }
 
+    std::vector<LodLevel> compute_lod_levels(const Polylines& paths,
+                                             float base_tolerance,
+                                             int max_steps,
+                                             std::size_t max_bytes)
+    {
+        TRACE_SCOPE("geometry", "compute_lod_levels");
+        Expects(base_tolerance > 0);
+        Expects(max_steps >= 0);
+
+        std::vector<LodLevel> levels;
+        levels.reserve(max_steps);
+        std::size_t bytes = 0;
+        float previous_error = 0;
+        float tolerance = base_tolerance;
+        for (int i = 0; i < max_steps; ++i, tolerance *= 2)
+        {
+            const Polylines& previous = levels.empty() ? paths : levels.back().paths;
+            auto level = simplify(previous, tolerance);
+
+            // A level saving less than a tenth of the positions is skipped.
+            if (level.positions.size() * 10 > previous.positions.size() * 9)
+            {
+                continue;
+            }
+
+            // The errors of the successive simplifications add up.
+            previous_error += tolerance;
+            SegmentIndex index (level);
+            levels.push_back({previous_error, std::move(level), std::move(index)});
+            bytes += memory_usage(levels.back());
+
+            // Over the budget, the finest levels are dropped. The last one is
+            // kept to simplify the next level from it.
+            while (bytes > max_bytes && levels.size() > 1)
+            {
+                bytes -= memory_usage(levels.front());
+                levels.erase(levels.begin());
+            }
+        }
+        if (bytes > max_bytes)
+        {
+            levels.clear();
+        }
+        return levels;
+    }
 }
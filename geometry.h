@@ -2,27 +2,271 @@
 #define GEOMETRY_H
 
 
+#include <algorithm>
+#include <utility>
 #include <vector>
 #include <SFML/Graphics.hpp>
 
+#include "ChunkedVector.h"
+
 namespace geometry
 {
-    // Compute the bounding box of a set of vertices.
-    // Complexity in time is in O(n), n being the number of vertices.
-    sf::FloatRect compute_bounding_box(const std::vector<sf::Vertex>& vertices);
-
-    // Divide the vertices into 'max_boxes_'-1 equal part (with a remainder) and
-    // compute the bounding boxes of each part. It is used to have a more
-    // fitting "hitbox" of a set of vertices. The hitboxes overlap by one
-    // vertex to not have any edge left out.
+    // A compact set of polylines, as output by the turtle. The positions of
+    // all the polylines are stored one after the other, and 'breaks' holds
+    // the index in 'positions' of the first position of each polyline but
+    // the first one, in increasing order. A jump of the turtle ends a
+    // polyline.
+    //
+    // The conversion into a renderable format is done at draw time only, with
+    // 'append_line_strip()'.
+    //
+    // The positions are stored in chunks, to not relocate huge drawings. The
+    // breaks are far less numerous and need a binary search.
+    struct Polylines
+    {
+        ChunkedVector<sf::Vector2f> positions;
+        std::vector<std::size_t> breaks;
+    };
+
+    // Get the number of bytes allocated by 'paths'.
+    std::size_t memory_usage(const Polylines& paths);
+
+    // A bounding volume hierarchy over the segments of a set of polylines.
+    // The segment 'i' links the positions 'i' and 'i+1'. If 'i+1' is a break,
+    // the segment does not exist.
+    //
+    // The segments are grouped by contiguous runs in the leaves: as the
+    // positions of a turtle interpretation are spatially coherent, this gives
+    // tight boxes, and the result of a query can be expressed as ranges of
+    // positions directly convertible to a 'sf::LineStrip'.
+    //
+    // The index does not keep a reference to the polylines: the queries
+    // needing them take the same polylines as the ones given at construction.
+    class SegmentIndex
+    {
+    public:
+        // A range of positions [first, last).
+        using range = std::pair<std::size_t, std::size_t>;
+
+        // Returned by 'find_segment()' if no segment is found.
+        static constexpr std::size_t npos = static_cast<std::size_t>(-1);
+
+        SegmentIndex() = default;
+
+        // Build the index of the segments of 'paths'.
+        // Complexity in time is in O(n), n being the number of positions.
+        explicit SegmentIndex(const Polylines& paths);
+
+        // Find the segment nearest to 'point', at most at a distance of
+        // 'tolerance'. Returns its index or 'npos' if there is none.
+        // Complexity in time is in O(log(n)) for a small 'tolerance'.
+        std::size_t find_segment(const Polylines& paths,
+                                 const sf::Vector2f& point,
+                                 float tolerance) const;
+
+        // Compute the sorted ranges of positions whose segments may intersect
+        // 'rect'. Adjacent ranges are merged.
+        std::vector<range> find_ranges(const sf::FloatRect& rect) const;
+
+        // Get the number of bytes allocated by the index.
+        std::size_t memory_usage() const;
+
+    private:
+        struct Node
+        {
+            sf::FloatRect box;
+            // The segments [first, last) of the node.
+            std::size_t first;
+            std::size_t last;
+            // The index of the children in 'nodes_', -1 for a leaf.
+            int left;
+            int right;
+        };
+
+        // Build recursively the node of the leaves [first_leaf, last_leaf)
+        // and returns its index.
+        int build(const std::vector<sf::FloatRect>& leaf_boxes,
+                  std::size_t first_leaf, std::size_t last_leaf,
+                  std::size_t n_segments);
+
+        // The number of segments in a leaf.
+        static constexpr std::size_t segments_per_leaf = 64;
+
+        // All the nodes. The root is the first one.
+        std::vector<Node> nodes_;
+    };
+
+    // Append the positions 'range' of 'paths' to 'strip', a vertex array
+    // drawn as a 'sf::LineStrip'. The polylines are linked by transparent
+    // vertices, as is 'range' to the previous content of 'strip'.
+    void append_line_strip(const Polylines& paths,
+                           SegmentIndex::range range,
+                           const sf::Color& color,
+                           std::vector<sf::Vertex>& strip);
+
+    // Accumulate the bounding boxes of a sequence of positions, one position
+    // at a time, without storing them: the boxes of the turtle's positions
+    // are computed during the interpretation.
+    //
+    // The positions are divided in parts of 'positions_per_box' positions,
+    // and the bounding box of each part, a sub-box, is computed. The parts
+    // overlap by one position to not have any edge left out. The global
+    // bounding box is the union of the sub-boxes.
+    class BoxAccumulator
+    {
+    public:
+        // Accumulate a single box.
+        BoxAccumulator();
+
+        // Accumulate sub-boxes of 'positions_per_box' positions.
+        // Exception:
+        //   - Precondition: 'positions_per_box' is at least 2.
+        explicit BoxAccumulator(std::size_t positions_per_box);
+
+        // Add a position to the current sub-box.
+        // Note: it is called for each position of a drawing, so it is
+        // inlined.
+        void add(const sf::Vector2f& position);
+
+        // Replace the last position added by 'position'. The number of
+        // positions does not change: the sub-boxes keep matching the ranges
+        // of positions. The replaced position stays in its sub-box, which is
+        // only a little larger than needed.
+        // Exception:
+        //   - Precondition: a position was added.
+        void replace_last(const sf::Vector2f& position);
+
+        // Reserve the sub-boxes of 'n_positions' positions, so that adding
+        // them does not reallocate.
+        void reserve(std::size_t n_positions);
+
+        // Get the sub-boxes of all the positions added.
+        std::vector<sf::FloatRect> get_sub_boxes() const;
+
+        // Get the bounding box of all the positions added.
+        sf::FloatRect get_bounding_box() const;
+
+    private:
+        std::size_t positions_per_box_;
+
+        // The completed sub-boxes.
+        std::vector<sf::FloatRect> boxes_;
+
+        // The current sub-box: its number of positions and its limits.
+        std::size_t count_;
+        float left_, top_, right_, down_;
+        sf::Vector2f last_;
+    };
+
+    // Compute the number of positions per sub-box to divide 'n_positions'
+    // into 'max_boxes'-1 equal part (with a remainder).
+    // Note: The algorithm breaks for low count of positions: it returns a
+    // correct number but 'max_boxes' is not respected. See the code for more
+    // informations.
+    std::size_t compute_positions_per_box(std::size_t n_positions, int max_boxes);
+
+    // Compute the bounding box of a set of positions.
+    // Complexity in time is in O(n), n being the number of positions.
+    sf::FloatRect compute_bounding_box(const std::vector<sf::Vector2f>& positions);
+    sf::FloatRect compute_bounding_box(const ChunkedVector<sf::Vector2f>& positions);
+
+    // Divide the positions into 'max_boxes_'-1 equal part (with a remainder)
+    // and compute the bounding boxes of each part. It is used to have a more
+    // fitting "hitbox" of a set of positions. The hitboxes overlap by one
+    // position to not have any edge left out.
     // 
-    // Complexity in time is in O(n), n being the number of vertices.
+    // Complexity in time is in O(n), n being the number of positions.
     //
-    // Note: The algorithm breaks for low count of vertices: it returns a
-    // correct set of bounding boxes but 'max_boxes' is not respected. See the
-    // code for more informations.
-    std::vector<sf::FloatRect> compute_sub_boxes(const std::vector<sf::Vertex>& vertices,
+    // Note: The sub-boxes of the turtle's positions are computed during the
+    // interpretation, this function is used when they are computed
+    // separately.
+    std::vector<sf::FloatRect> compute_sub_boxes(const ChunkedVector<sf::Vector2f>& positions,
                                                  int max_boxes);
+
+    // Check if 'box' contains 'point', borders included.
+    // Note: unlike 'sf::FloatRect::contains()', a box without width or height
+    // (a vertical or horizontal line) can contain points.
+    bool contains(const sf::FloatRect& box, const sf::Vector2f& point);
+
+    // Check if 'a' and 'b' overlap, borders included.
+    // Note: unlike 'sf::FloatRect::intersects()', a box without width or
+    // height can overlap other boxes.
+    bool intersects(const sf::FloatRect& a, const sf::FloatRect& b);
+
+    // Compute the rectangle of the world seen by 'view'. The rotation of
+    // the view is ignored.
+    sf::FloatRect compute_view_rect(const sf::View& view);
+
+    // Simplify the polylines with the Douglas-Peucker algorithm: each
+    // simplified polyline is never farther than 'tolerance' from the original
+    // one. The ends of the polylines are preserved.
+    // Complexity in time is in O(n*log(n)) on average, n being the number of
+    // positions.
+    Polylines simplify(const Polylines& paths, float tolerance);
+
+    // Remove the duplicated segments of the polylines: the segments linking
+    // the same two positions, in the same or in the reverse direction, and
+    // the segments of null length. The remaining segments are stitched back
+    // into polylines, in the order of their first occurrence.
+    //
+    // The positions are compared after their quantization on a grid of
+    // 'quantum' units, as the same position reached by two paths of the
+    // turtle differs by rounding errors. Two close positions on each side of
+    // the border of a cell are not considered equal, so some duplicates may
+    // remain.
+    // Complexity in time is in O(n) on average, n being the number of
+    // positions.
+    Polylines deduplicate(const Polylines& paths, float quantum);
+
+    // A level of detail: simplified polylines, their maximal distance to
+    // the original ones, and the index of their segments to draw only their
+    // visible part.
+    struct LodLevel
+    {
+        float error;
+        Polylines paths;
+        SegmentIndex index;
+    };
+
+    // Get the number of bytes allocated by 'level'.
+    std::size_t memory_usage(const LodLevel& level);
+
+    // Compute a level-of-detail pyramid of the polylines, from the finest to
+    // the coarsest level. Each level is simplified from the previous one
+    // with a tolerance doubling at each step, starting at 'base_tolerance',
+    // for at most 'max_steps' steps. A level not significantly simpler than
+    // the previous one is not worth its memory and is skipped. The polylines
+    // themselves are not part of the pyramid.
+    // The levels retained use at most 'max_bytes' bytes: the finest ones,
+    // the largest and the closest to the polylines, are dropped first.
+    std::vector<LodLevel> compute_lod_levels(const Polylines& paths,
+                                             float base_tolerance,
+                                             int max_steps,
+                                             std::size_t max_bytes);
+
+    inline void BoxAccumulator::add(const sf::Vector2f& position)
+    {
+        if (count_ == positions_per_box_)
+        {
+            // The current sub-box is complete: the next one starts at its
+            // last position.
+            boxes_.push_back({left_, top_, right_ - left_, down_ - top_});
+            left_ = right_ = last_.x;
+            top_ = down_ = last_.y;
+            count_ = 1;
+        }
+        if (count_ == 0)
+        {
+            left_ = right_ = position.x;
+            top_ = down_ = position.y;
+        }
+        left_  = std::min(left_, position.x);
+        right_ = std::max(right_, position.x);
+        top_   = std::min(top_, position.y);
+        down_  = std::max(down_, position.y);
+        last_ = position;
+        ++count_;
+    }
 }
 
 
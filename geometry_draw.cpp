@@ -0,0 +1,64 @@
+#include <algorithm>
+#include <gsl/gsl>
+#include "geometry.h"
+
+// The functions of 'geometry' converting to and from the types of the SFML
+// graphics module. They are kept apart from 'geometry.cpp', so the tools
+// without any window link the core without the graphics library.
+
+namespace geometry
+{
+    sf::FloatRect compute_view_rect(const sf::View& view)
+    {
+        const auto& center = view.getCenter();
+        const auto& size = view.getSize();
+        return { center.x - size.x / 2, center.y - size.y / 2, size.x, size.y };
+    }
+
+    void append_line_strip(const Polylines& paths,
+                           SegmentIndex::range range,
+                           const sf::Color& color,
+                           std::vector<sf::Vertex>& strip)
+    {
+        Expects(range.first <= range.second && range.second <= paths.positions.size());
+        if (range.first == range.second)
+        {
+            return;
+        }
+
+        // A transparent jump from the last position of 'strip' to 'position'.
+        auto jump = [&strip](const sf::Vector2f& position)
+            {
+                strip.push_back({strip.back().position, sf::Color::Transparent});
+                strip.push_back({position, sf::Color::Transparent});
+            };
+
+        const auto& positions = paths.positions;
+        if (!strip.empty())
+        {
+            jump(positions[range.first]);
+        }
+        // The strip may be built range after range: its capacity grows
+        // geometrically, not to reallocate it at each call.
+        std::size_t needed = strip.size() + range.second - range.first;
+        if (strip.capacity() < needed)
+        {
+            strip.reserve(std::max(needed, 2 * strip.capacity()));
+        }
+
+        // Iterate over the chunks of 'range' only.
+        auto next_break = std::upper_bound(paths.breaks.begin(), paths.breaks.end(), range.first);
+        for (const auto& chunk : positions.chunks(range.first, range.second))
+        {
+            for (std::size_t k = 0; k < chunk.size; ++k)
+            {
+                if (next_break != paths.breaks.end() && *next_break == chunk.offset + k)
+                {
+                    jump(chunk.data[k]);
+                    ++next_break;
+                }
+                strip.push_back({chunk.data[k], color});
+            }
+        }
+    }
+}
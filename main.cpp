@@ -12,7 +12,12 @@
 #include "Turtle.h"
 #include "helper_math.h"
 #include "procgui.h"
+#include "Scene.h"
+#include "Animation.h"
+#include "Session.h"
+#include "Trace.h"
 
+#include <chrono>
 #include <functional>
 
 using namespace drawing;
@@ -20,7 +25,7 @@ using namespace math;
 using namespace procgui;
 
 // Forward Declaration
-void handle_input(sf::RenderWindow& window);
+bool handle_input(sf::RenderWindow& window, Scene& scene);
 
 // Standard main() for the procgen application
 int main(/*int argc, char* argv[]*/)
@@ -60,26 +65,132 @@ int main(/*int argc, char* argv[]*/)
     plant_param.step = 5;
     plant_param.n_iter = 6;
 
-    LSystemView serpinski_view (serpinski, map, serpinski_param);
-    LSystemView plant_view (plant, map, plant_param);
+    // The memory usage of the LSystems is tracked until the end of 'main()'.
+    // The report of the tracker is dumped in 'memory_path'.
+    MemoryTracker::ScopedSource serpinski_source (MemoryTracker::global(), "Sierpinski LSystem",
+                                                  [serpinski]() { return serpinski->memory_usage(); });
+    MemoryTracker::ScopedSource plant_source (MemoryTracker::global(), "Plant LSystem",
+                                              [plant]() { return plant->memory_usage(); });
+    const std::string memory_path = "procgen_memory.txt";
+
+    // A capture of the trace spans starts at launch if 'PROCGEN_TRACE' is
+    // set to the path of the file to write. Otherwise, it can be started
+    // from the GUI.
+    std::string trace_path = "procgen_trace.json";
+    if (const char* path = std::getenv(Trace::ENVIRONMENT_VARIABLE))
+    {
+        trace_path = path;
+        Trace::global().start();
+    }
+
+    Scene scene;
+    auto& serpinski_view = scene.add_view(serpinski, map, serpinski_param);
+    auto& plant_view = scene.add_view(plant, map, plant_param);
+
+    // The editing sessions can be recorded, to be replayed as performance
+    // workloads. The parameters of the Views are recorded at each frame, if
+    // they changed.
+    SessionRecorder recorder;
+    int map_id = recorder.add_interpretation(map);
+    std::vector<std::pair<int, LSystemView*>> recorded_views
+    { { recorder.add_view(recorder.add_lsystem(serpinski), map_id, serpinski_param), &serpinski_view },
+      { recorder.add_view(recorder.add_lsystem(plant), map_id, plant_param), &plant_view } };
+    const std::string session_path = "procgen_session.txt";
     
+    // The selected View can be animated. The time spent drawing the Scene is
+    // measured for the frame budget of the animation.
+    Animation animation;
+    double draw_time = 0;
+
+    // With on-demand rendering, the Scene is rendered in 'scene_texture' only
+    // when it may have changed: after an input event, when a View has a new
+    // result or is still converting its vertices, when the 'sf::View' moved,
+    // or during an animation. Otherwise, the last frame is drawn again, and
+    // only the GUI is rendered.
+    bool on_demand = true;
+    sf::RenderTexture scene_texture;
+    unsigned long active_frames = 0;
+    unsigned long idle_frames = 0;
+
     sf::Clock delta_clock;
     while (window.isOpen())
     {
         window.clear();
-        handle_input(window);
+        bool has_input = handle_input(window, scene);
         
-        ImGui::SFML::Update(window, delta_clock.restart());
+        sf::Time delta_time = delta_clock.restart();
+        ImGui::SFML::Update(window, delta_time);
 
         procgui::new_frame();
-        
-        serpinski_view.draw(window);
-        plant_view.draw(window);
 
+        if (!animation.is_playing())
+        {
+            animation.set_view(scene.get_selected());
+        }
+        animation.update(delta_time.asSeconds(), draw_time);
+
+        if (scene_texture.getSize() != window.getSize())
+        {
+            scene_texture.create(window.getSize().x, window.getSize().y);
+            has_input = true;
+        }
+        if (!on_demand || has_input || animation.is_playing() ||
+            scene.needs_redraw(window.getView()))
+        {
+            auto draw_start = std::chrono::steady_clock::now();
+            scene_texture.setView(window.getView());
+            scene_texture.clear();
+            scene.draw(scene_texture);
+            scene_texture.display();
+            draw_time = std::chrono::duration<double>(std::chrono::steady_clock::now() - draw_start).count();
+            ++active_frames;
+        }
+        else
+        {
+            ++idle_frames;
+        }
+
+        // The texture is drawn pixel to pixel.
+        sf::View camera = window.getView();
+        window.setView(sf::View({0, 0, float(window.getSize().x), float(window.getSize().y)}));
+        window.draw(sf::Sprite(scene_texture.getTexture()));
+        window.setView(camera);
+
+        scene.interact();
         display(*map, "interpretations");
+        interact_with(animation, "Animation");
+        display(MemoryTracker::global(), memory_path, "Memory");
+        display(Trace::global(), trace_path, "Trace");
+        display(recorder, session_path, "Session");
+        for (const auto& view : recorded_views)
+        {
+            recorder.record_parameters(view.first, view.second->get_parameters());
+        }
+
+        ImGui::Begin("Rendering");
+        ImGui::Checkbox("On-demand rendering", &on_demand);
+        ImGui::Text("Active frames: %lu", active_frames);
+        ImGui::Text("Idle frames: %lu", idle_frames);
+        ImGui::End();
         
         ImGui::SFML::Render(window);
         window.display();
+
+        // The buffers of the threads are drained at each frame, so that they
+        // are not filled during long captures.
+        if (Trace::is_capturing())
+        {
+            Trace::global().collect();
+        }
+    }
+
+    if (Trace::is_capturing())
+    {
+        Trace::global().stop();
+        if (!Trace::global().save(trace_path))
+        {
+            std::cerr << "Could not write the trace in '" << trace_path << "'" << std::endl;
+        }
     }
 
     ImGui::SFML::Shutdown();
@@ -87,19 +198,23 @@ int main(/*int argc, char* argv[]*/)
     return 0;
 }
 
-// Handle input with SFML and ImGui
-void handle_input(sf::RenderWindow& window)
+// Handle input with SFML and ImGui. Returns 'true' if there was any input
+// event.
+bool handle_input(sf::RenderWindow& window, Scene& scene)
 {
     static float zoom_level = 1.f;
     static sf::Vector2i mouse_position {};
+    static sf::Vector2i click_position {};
     static bool has_focus = true;
     static bool can_move = false;
     
     sf::View view = window.getView();
     ImGuiIO& imgui_io = ImGui::GetIO();
+    bool has_input = false;
     sf::Event event;
     while (window.pollEvent(event))
     {
+        has_input = true;
         ImGui::SFML::ProcessEvent(event);
 
         if (event.type == sf::Event::Closed ||
@@ -145,8 +260,24 @@ void handle_input(sf::RenderWindow& window)
                 event.mouseButton.button == sf::Mouse::Left)
             {
                 mouse_position = sf::Mouse::getPosition(window);
+                click_position = mouse_position;
                 can_move = true;
             }
+
+            // A click without dragging selects the LSystemView drawn under
+            // the mouse, with a tolerance of a few pixels.
+            if (!imgui_io.WantCaptureMouse &&
+                event.type == sf::Event::MouseButtonReleased &&
+                event.mouseButton.button == sf::Mouse::Left)
+            {
+                sf::Vector2i release_position { event.mouseButton.x, event.mouseButton.y };
+                sf::Vector2i delta = release_position - click_position;
+                if (std::abs(delta.x) + std::abs(delta.y) < 3)
+                {
+                    scene.select_at(window.mapPixelToCoords(release_position, view),
+                                    4.f * zoom_level);
+                }
+            }
         }
     }
 
@@ -165,4 +296,6 @@ void handle_input(sf::RenderWindow& window)
     }
     
     window.setView(view);
+
+    return has_input;
 }
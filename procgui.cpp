@@ -1,5 +1,9 @@
+#include <algorithm>
 #include <cctype>
+#include <cstdio>
+#include <iostream>
 #include <cstring>
+#include <fstream>
 #include <tuple>
 #include <chrono>
 #include "procgui.h"
@@ -189,6 +193,152 @@ namespace procgui
 
     
 
+    void display(const ViewProfile& profile, const std::string& name, bool main)
+    {
+        if( !set_up(name, main) )
+        {
+            // Early out if the display zone is collapsed.
+            return;
+        }
+
+        // --- Drawing ---
+        const auto& frame = profile.get_last_frame();
+        const auto& frame_times = profile.get_frame_times();
+        char overlay[32];
+        std::snprintf(overlay, sizeof(overlay), "%.2f ms", frame.total());
+        ImGui::PlotLines("Frame time", frame_times.data(), frame_times.size(),
+                         profile.get_frame_offset(), overlay,
+                         0.f, std::max(profile.get_max_frame_time(), 1.f), ImVec2(0, 60));
+        ImGui::Text("Apply: %.3f ms", frame.apply);
+        ImGui::Text("Conversion: %.3f ms", frame.conversion);
+        ImGui::Text("Submission: %.3f ms", frame.submission);
+        ImGui::Text("Vertices drawn: %zu", frame.vertices);
+        ImGui::Text("Vertex cache: %zu hits, %zu misses",
+                    profile.get_strip_hits(), profile.get_strip_misses());
+
+        // --- Computation ---
+        const auto& computation = profile.get_last_computation();
+        ImGui::Separator();
+        ImGui::Text("Last computation: %.3f ms", computation.total());
+        ImGui::Indent();
+        ImGui::Text("Production: %.3f ms", computation.production);
+        ImGui::Text("Interpretation: %.3f ms", computation.interpretation);
+        ImGui::Text("Deduplication: %.3f ms", computation.deduplication);
+        ImGui::Text("Index: %.3f ms", computation.index);
+        ImGui::Text("Levels of detail: %.3f ms", computation.lod);
+        ImGui::Unindent();
+        ImGui::Text("Symbols: %zu", computation.symbols);
+        ImGui::Text("Vertices: %zu", computation.vertices);
+        ImGui::Text("Production cache: %zu hits, %zu misses",
+                    profile.get_production_hits(), profile.get_production_misses());
+
+        conclude(main);
+    }
+
+    void display(MemoryTracker& tracker, const std::string& path, const std::string& name, bool main)
+    {
+        if( !set_up(name, main) )
+        {
+            // Early out if the display zone is collapsed.
+            return;
+        }
+
+        auto to_kib = [](std::size_t bytes) { return bytes / 1024.f; };
+
+        std::size_t total = 0;
+        for (const auto& sample : tracker.sample())
+        {
+            total += sample.usage.total();
+            if (ImGui::TreeNode(sample.name.c_str(), "%s: %.1f KiB (high-water mark: %.1f KiB)",
+                                sample.name.c_str(),
+                                to_kib(sample.usage.total()),
+                                to_kib(sample.high_water_mark)))
+            {
+                for (const auto& item : sample.usage.items)
+                {
+                    ImGui::Text("%s: %.1f KiB", item.name.c_str(), to_kib(item.bytes));
+                }
+                ImGui::TreePop();
+            }
+        }
+        ImGui::Separator();
+        ImGui::Text("Total: %.1f KiB (high-water mark: %.1f KiB)",
+                    to_kib(total), to_kib(tracker.get_high_water_mark()));
+
+        if (ImGui::Button("Dump"))
+        {
+            std::ofstream file (path);
+            tracker.dump(file);
+            if (!file)
+            {
+                std::cerr << "Could not write the memory report in '" << path << "'" << std::endl;
+            }
+        }
+        ImGui::SameLine(); ImGui::ShowHelpMarker("Write the report of the sources and of their items in the file.");
+        ImGui::Text("File: %s", path.c_str());
+
+        conclude(main);
+    }
+
+    void display(Trace& trace, const std::string& path, const std::string& name, bool main)
+    {
+        if( !set_up(name, main) )
+        {
+            // Early out if the display zone is collapsed.
+            return;
+        }
+
+        if (!Trace::is_capturing())
+        {
+            if (ImGui::Button("Start capture"))
+            {
+                trace.start();
+            }
+        }
+        else if (ImGui::Button("Stop and save"))
+        {
+            trace.stop();
+            if (!trace.save(path))
+            {
+                std::cerr << "Could not write the trace in '" << path << "'" << std::endl;
+            }
+        }
+        ImGui::SameLine(); ImGui::ShowHelpMarker("The capture is saved in the Chrome trace-event format, to be opened in 'chrome://tracing'.");
+
+        ImGui::Text("File: %s", path.c_str());
+        ImGui::Text("Spans: %zu", trace.get_size());
+        ImGui::Text("Dropped spans: %zu", trace.get_dropped());
+
+        conclude(main);
+    }
+
+    void display(SessionRecorder& recorder, const std::string& path, const std::string& name, bool main)
+    {
+        if( !set_up(name, main) )
+        {
+            // Early out if the display zone is collapsed.
+            return;
+        }
+
+        if (!recorder.is_recording())
+        {
+            if (ImGui::Button("Start recording") && !recorder.start(path))
+            {
+                std::cerr << "Could not write the session in '" << path << "'" << std::endl;
+            }
+        }
+        else if (ImGui::Button("Stop recording"))
+        {
+            recorder.stop();
+        }
+        ImGui::SameLine(); ImGui::ShowHelpMarker("Record the modifications of the L-systems, interpretations and parameters, to replay them with 'replay/procgenReplay.out'.");
+
+        ImGui::Text("File: %s", path.c_str());
+        ImGui::Text("Events: %zu", recorder.get_size());
+
+        conclude(main);
+    }
+
     bool interact_with(drawing::DrawingParameters& parameters, const std::string& name, bool main)
     {
         if( !set_up(name, main) )
@@ -347,11 +497,109 @@ namespace procgui
         // not check the LSystem or the InterpretationMap because the
         // LSystemView is already an Observer of these classes.
         bool is_modified = interact_with(lsys_view.get_parameters(), "Drawing Parameters", false);
+        is_modified |= ImGui::Checkbox("Remove duplicated segments", &lsys_view.get_deduplication());
+
+        bool is_profiling = lsys_view.is_profiling();
+        if (ImGui::Checkbox("Profiling", &is_profiling))
+        {
+            lsys_view.set_profiling(is_profiling);
+        }
         interact_with(lsys_view.get_lsystem_buffer(), "LSystem", false);
         interact_with(lsys_view.get_interpretation_buffer(), "Interpretation Map", false);
+        if (lsys_view.is_profiling())
+        {
+            display(lsys_view.get_profile(), "Performance", false);
+        }
 
         conclude(main);
         
         return is_modified;
     }
+
+    bool interact_with(Animation& animation, const std::string& name, bool main)
+    {
+        if (!set_up(name, main))
+        {
+            // Early out if the display zone is collapsed.
+            return false;
+        }
+
+        bool is_modified = false;
+        LSystemView* view = animation.get_view();
+        if (!view)
+        {
+            ImGui::Text("Select a View to animate it.");
+            conclude(main);
+            return false;
+        }
+
+        // --- Keyframes ---
+        const auto& keyframes = animation.get_keyframes();
+        for (std::size_t i = 0; i < keyframes.size(); ++i)
+        {
+            const auto& parameters = keyframes[i].parameters;
+            ImGui::PushID(i);
+            if (ImGui::Button("Remove"))
+            {
+                animation.remove_keyframe(i);
+                is_modified = true;
+                ImGui::PopID();
+                break;
+            }
+            ImGui::SameLine();
+            ImGui::Text("%.2fs: angle delta %.1f, step %d, %d iterations",
+                        keyframes[i].time,
+                        math::rad_to_degree(parameters.delta_angle),
+                        parameters.step,
+                        parameters.n_iter);
+            ImGui::PopID();
+        }
+
+        static float keyframe_time = 0.f;
+        ImGui::DragFloat("Time", &keyframe_time, 0.1f, 0.f, 3600.f, "%.2fs");
+        ImGui::SameLine();
+        if (ImGui::Button("Add keyframe"))
+        {
+            animation.add_keyframe({keyframe_time, view->get_parameters()});
+            keyframe_time += 1.f;
+            is_modified = true;
+        }
+        ImGui::SameLine(); ImGui::ShowHelpMarker("The keyframe is the current Drawing Parameters of the selected View.");
+
+        // --- Target frame time ---
+        float target_ms = animation.get_target_frame_time() * 1000;
+        if (ImGui::DragFloat("Target frame time", &target_ms, 0.1f, 1.f, 1000.f, "%.1fms"))
+        {
+            animation.set_target_frame_time(target_ms / 1000);
+        }
+
+        // --- Play ---
+        if (animation.is_playing())
+        {
+            if (ImGui::Button("Stop"))
+            {
+                animation.stop();
+            }
+        }
+        else if (ImGui::Button("Play"))
+        {
+            animation.play();
+        }
+
+        // --- Degradations ---
+        const auto& degradations = animation.get_degradations();
+        if (!degradations.empty() && ImGui::TreeNode("Degradations"))
+        {
+            for (const auto& d : degradations)
+            {
+                ImGui::Text("%.2fs: %d fewer iterations, LOD error %.1fpx (frame cost %.1fms)",
+                            d.time, d.n_iter_reduction, d.max_pixel_error, d.cost * 1000);
+            }
+            ImGui::TreePop();
+        }
+
+        conclude(main);
+
+        return is_modified;
+    }
 }
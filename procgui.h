@@ -10,7 +10,10 @@
 #include "RuleMapBuffer.h"
 #include "LSystemBuffer.h"
 #include "LSystemView.h"
+#include "Animation.h"
 #include "InterpretationMapBuffer.h"
+#include "Session.h"
+#include "Trace.h"
 #include "Turtle.h"
 #include "helper_string.h"
 
@@ -55,6 +58,23 @@ namespace procgui {
     
     void display(const drawing::InterpretationMap& map, const std::string& name, bool main = true);
 
+    // Display the frame-time graph and the timings of the stages of a
+    // LSystemView.
+    void display(const ViewProfile& profile, const std::string& name, bool main = true);
+
+    // Display the memory usage of the sources of 'tracker' and their
+    // high-water marks, and a button to dump its report in the file 'path'.
+    // Sampling the sources updates the marks, so 'tracker' is not constant.
+    void display(MemoryTracker& tracker, const std::string& path, const std::string& name, bool main = true);
+
+    // Display the state of the capture of 'trace', and a button to start it
+    // or to stop it and save it in the file 'path'.
+    void display(Trace& trace, const std::string& path, const std::string& name, bool main = true);
+
+    // Display the state of 'recorder', and a button to start recording in
+    // the file 'path' or to stop.
+    void display(SessionRecorder& recorder, const std::string& path, const std::string& name, bool main = true);
+
     
     bool interact_with(drawing::DrawingParameters& turtle,
                        const std::string& name,
@@ -70,6 +90,10 @@ namespace procgui {
     bool interact_with(InterpretationMapBuffer& buffer, const std::string& name, bool main = true);
 
     bool interact_with(LSystemView& lsys_view, const std::string& name, bool main = true);
+
+    // Edit the keyframes of 'animation' from the parameters of its View, play
+    // it and display its degradations.
+    bool interact_with(Animation& animation, const std::string& name, bool main = true);
     
     #include "procgui.tpp"
 
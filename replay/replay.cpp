@@ -0,0 +1,111 @@
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <map>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "Session.h"
+
+// Replay recorded editing sessions without any window, and report the
+// latencies of the re-computations after their events: by kind of event, and
+// for all of them. The latencies are in milliseconds.
+//
+// The sessions are recorded from the 'Session' window of the application.
+// The regression workloads are in 'replay/sessions/'.
+//
+// Usage: procgenReplay.out [-r repeats] [-d] session...
+//   Replay each session 'repeats' times (by default, once). The first replay
+//   is not discarded: the caches start cold at each replay. With '-d', the
+//   duplicated segments of the views are removed, as with the deduplication
+//   of a LSystemView. The latencies until the previews are displayed are
+//   reported on the 'previews' line.
+
+namespace
+{
+    void print_summary(const std::string& name, const SessionReplayer::Summary& summary)
+    {
+        std::printf("  %-14s %6zu %10.3f %10.3f %10.3f %10.3f %12.3f\n",
+                    name.c_str(), summary.count,
+                    summary.p50, summary.p90, summary.p99, summary.max, summary.total);
+    }
+
+    void replay(const std::string& path, int repeats, bool deduplicate)
+    {
+        std::ifstream file (path);
+        if (!file)
+        {
+            throw std::runtime_error("Could not open '" + path + "'");
+        }
+        SessionReplayer replayer (read_session(file), deduplicate);
+
+        std::map<SessionEvent::Kind, std::vector<double>> by_kind;
+        std::vector<double> all;
+        std::vector<double> previews;
+        for (int i = 0; i < repeats; ++i)
+        {
+            for (const auto& latency : replayer.replay())
+            {
+                by_kind[latency.kind].push_back(latency.duration);
+                all.push_back(latency.duration);
+                previews.push_back(latency.preview);
+            }
+        }
+
+        std::printf("%s\n", path.c_str());
+        std::printf("  %-14s %6s %10s %10s %10s %10s %12s\n",
+                    "event", "count", "p50", "p90", "p99", "max", "total");
+        for (const auto& kind : by_kind)
+        {
+            print_summary(get_kind_name(kind.first), SessionReplayer::summarize(kind.second));
+        }
+        print_summary("all", SessionReplayer::summarize(all));
+        print_summary("previews", SessionReplayer::summarize(previews));
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    std::vector<std::string> args (argv + 1, argv + argc);
+    int repeats = 1;
+    bool deduplicate = false;
+    while (!args.empty())
+    {
+        if (args.size() >= 2 && args.front() == "-r")
+        {
+            repeats = std::max(1, std::atoi(args[1].c_str()));
+            args.erase(args.begin(), args.begin() + 2);
+        }
+        else if (args.front() == "-d")
+        {
+            deduplicate = true;
+            args.erase(args.begin());
+        }
+        else
+        {
+            break;
+        }
+    }
+    if (args.empty())
+    {
+        std::fprintf(stderr, "Usage: procgenReplay.out [-r repeats] [-d] session...\n");
+        return 1;
+    }
+
+    try
+    {
+        for (const auto& path : args)
+        {
+            replay(path, repeats, deduplicate);
+        }
+    }
+    catch (const std::exception& e)
+    {
+        std::fprintf(stderr, "%s\n", e.what());
+        return 1;
+    }
+
+    return 0;
+}
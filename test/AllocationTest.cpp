@@ -0,0 +1,151 @@
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+#include <gtest/gtest.h>
+
+#include "LSystem.h"
+#include "Turtle.h"
+#include "InterpretationMap.h"
+#include "geometry.h"
+#include "helper_math.h"
+
+// The global 'operator new' and 'operator delete' are replaced, for the whole
+// test suite, by versions counting the allocations of the current thread when
+// enabled by an 'AllocationTest'. The other threads (the workers of the
+// 'ThreadPool', ...) are never counted.
+namespace
+{
+    thread_local bool is_counting = false;
+    thread_local std::size_t allocations = 0;
+    thread_local std::size_t allocated_bytes = 0;
+
+    void* allocate(std::size_t size)
+    {
+        if (is_counting)
+        {
+            ++allocations;
+            allocated_bytes += size;
+        }
+        void* ptr = std::malloc(size > 0 ? size : 1);
+        if (!ptr)
+        {
+            throw std::bad_alloc();
+        }
+        return ptr;
+    }
+}
+
+void* operator new(std::size_t size)
+{
+    return allocate(size);
+}
+
+void* operator new[](std::size_t size)
+{
+    return allocate(size);
+}
+
+void operator delete(void* ptr) noexcept
+{
+    std::free(ptr);
+}
+
+void operator delete[](void* ptr) noexcept
+{
+    std::free(ptr);
+}
+
+void operator delete(void* ptr, std::size_t) noexcept
+{
+    std::free(ptr);
+}
+
+void operator delete[](void* ptr, std::size_t) noexcept
+{
+    std::free(ptr);
+}
+
+
+using namespace drawing;
+using namespace math;
+
+// Tests asserting the allocation budgets of the hot paths: the number of
+// allocations made by a call must not exceed its budget. If a change breaks
+// a budget, either the allocations it adds are justified and the budget is
+// raised, or they are removed.
+class AllocationTest : public ::testing::Test
+{
+public:
+    // Count the allocations made by 'f' on the current thread.
+    template<typename F>
+    std::size_t count_allocations(F f)
+    {
+        allocations = 0;
+        allocated_bytes = 0;
+        is_counting = true;
+        f();
+        is_counting = false;
+        return allocations;
+    }
+
+    std::size_t get_allocated_bytes() const
+    {
+        return allocated_bytes;
+    }
+
+    LSystem plant { "X", { { 'X', "F[-X][X]F[-X]+FX" }, { 'F', "FF" } } };
+    InterpretationMap map { { 'F', go_forward },
+                            { '+', turn_left  },
+                            { '-', turn_right },
+                            { '[', save_position },
+                            { ']', load_position } };
+    // starting_position, starting_angle, delta_angle, step, n_iter
+    DrawingParameters parameters { { 400, 800 }, degree_to_rad(-80.f), degree_to_rad(25.f), 5, 6 };
+};
+
+// The harness counts the allocations of the current thread only, and nothing
+// outside of 'count_allocations()'.
+TEST_F(AllocationTest, harness)
+{
+    auto ptr = std::make_unique<int>(0);
+    ASSERT_EQ(count_allocations([]() {}), 0u);
+    ASSERT_EQ(count_allocations([]() { std::make_unique<int[]>(16); }), 1u);
+    ASSERT_EQ(get_allocated_bytes(), 16 * sizeof(int));
+}
+
+// A derivation allocates its iteration and its entries in the caches (of the
+// iterations, and of their versions for a LSystem). The iterations of a
+// snapshot are shared with the next ones: they also allocate their shared
+// block. A cached production does not allocate.
+TEST_F(AllocationTest, produce)
+{
+    plant.produce(5);
+    ASSERT_LE(count_allocations([this]() { plant.produce(6); }), 3u);
+    ASSERT_EQ(count_allocations([this]() { plant.produce(6); }), 0u);
+
+    auto snapshot = plant.get_snapshot();
+    snapshot->produce(5);
+    ASSERT_LE(count_allocations([&snapshot]() { snapshot->produce(6); }), 3u);
+    ASSERT_EQ(count_allocations([&snapshot]() { snapshot->produce(6); }), 0u);
+}
+
+// A warm recompute of the plant at n=6, from a cached production: the
+// chunks of the positions, the breaks, the sub-boxes and their copy, and the
+// growth of the stack of the turtle.
+TEST_F(AllocationTest, compute_paths)
+{
+    auto lsys = plant.get_snapshot();
+    auto interpretation = map.get_snapshot();
+    lsys->produce(parameters.n_iter);
+
+    ASSERT_LE(count_allocations([&]() { compute_paths(*lsys, *interpretation, parameters, 64); }), 11u);
+}
+
+// The sub-boxes are reserved beforehand: only them and their copy are
+// allocated.
+TEST_F(AllocationTest, compute_sub_boxes)
+{
+    auto paths = compute_paths(plant, map, parameters);
+    ASSERT_LE(count_allocations([&paths]() { geometry::compute_sub_boxes(paths.positions, 64); }), 2u);
+}
@@ -0,0 +1,73 @@
+#include <gtest/gtest.h>
+
+#include "Animation.h"
+#include "ThreadPool.h"
+
+using namespace drawing;
+using namespace procgui;
+using namespace math;
+
+class AnimationTest : public ::testing::Test
+{
+public:
+    AnimationTest()
+    {
+        auto first = parameters;
+        auto last = parameters;
+        last.delta_angle = degree_to_rad(30.);
+        animation.add_keyframe({0.f, first});
+        animation.add_keyframe({1.f, last});
+        animation.set_view(&view);
+    }
+
+    ~AnimationTest()
+    {
+        // The computations requested must not outlive the models.
+        ThreadPool::shared().wait();
+    }
+
+    std::shared_ptr<LSystem> plant =
+        std::make_shared<LSystem>(LSystem { "X", { { 'X', "F[+X][-X]FX" }, { 'F', "FF" } } });
+    std::shared_ptr<InterpretationMap> map =
+        std::make_shared<InterpretationMap>(InterpretationMap { { 'F', go_forward },
+                                                                { '+', turn_left  },
+                                                                { '-', turn_right },
+                                                                { '[', save_position },
+                                                                { ']', load_position } });
+    DrawingParameters parameters { { 0, 0 }, 0, degree_to_rad(20.), 5, 4 };
+    LSystemView view { plant, map, parameters };
+    Animation animation;
+};
+
+// The frames over the target degrade the quality, and stopping the animation
+// restores the parameters and the quality of the View.
+TEST_F(AnimationTest, degrade_stop_restore)
+{
+    auto pixel_error = view.get_max_pixel_error();
+    animation.set_target_frame_time(1e-9);
+    animation.play();
+    for (int i = 0; i < 30; ++i)
+    {
+        animation.update(0.1f, 1.);
+        ThreadPool::shared().wait();
+        view.apply_pending_vertices();
+    }
+
+    const auto& degradations = animation.get_degradations();
+    ASSERT_FALSE(degradations.empty());
+    ASSERT_GT(degradations.back().n_iter_reduction, 0);
+    ASSERT_GT(view.get_max_pixel_error(), pixel_error);
+    ASSERT_LT(view.get_parameters().n_iter, parameters.n_iter);
+
+    animation.stop();
+    ASSERT_FALSE(animation.is_playing());
+    ASSERT_EQ(view.get_max_pixel_error(), pixel_error);
+    ASSERT_EQ(view.get_parameters().n_iter, parameters.n_iter);
+    ASSERT_EQ(view.get_parameters().delta_angle, parameters.delta_angle);
+
+    // The vertices of the restored parameters are computed.
+    ASSERT_TRUE(view.is_computing());
+    ThreadPool::shared().wait();
+    view.apply_pending_vertices();
+    ASSERT_FALSE(view.is_computing());
+}
@@ -0,0 +1,151 @@
+#include <numeric>
+#include <limits>
+#include <string>
+
+#include <gtest/gtest.h>
+
+#include "ChunkedVector.h"
+
+// Fill a ChunkedVector with chunks of 4 to 16 elements with [0, n).
+ChunkedVector<int> gen_iota(int n)
+{
+    ChunkedVector<int> v (4, 16);
+    for (int i = 0; i < n; ++i)
+    {
+        v.push_back(i);
+    }
+    return v;
+}
+
+// Restore the settings of ChunkStorage at the end of a test, even if it
+// fails.
+class StorageSettingsGuard
+{
+public:
+    StorageSettingsGuard()
+        : budget_ {ChunkStorage::get_ram_budget()}
+        , directory_ {ChunkStorage::get_spill_directory()}
+    {
+    }
+
+    ~StorageSettingsGuard()
+    {
+        ChunkStorage::set_ram_budget(budget_);
+        ChunkStorage::set_spill_directory(directory_);
+    }
+
+private:
+    std::size_t budget_;
+    std::string directory_;
+};
+
+TEST(ChunkedVectorTest, push_back_and_access)
+{
+    auto v = gen_iota(100);
+
+    ASSERT_EQ(v.size(), 100u);
+    for (int i = 0; i < 100; ++i)
+    {
+        ASSERT_EQ(v[i], i);
+    }
+    ASSERT_EQ(v.back(), 99);
+    ASSERT_THROW(v.at(100), std::out_of_range);
+}
+
+TEST(ChunkedVectorTest, stable_addresses)
+{
+    ChunkedVector<int> v (4, 16);
+    v.push_back(42);
+    const int* first = &v[0];
+
+    for (int i = 0; i < 1000; ++i)
+    {
+        v.push_back(i);
+    }
+    ASSERT_EQ(first, &v[0]);
+    ASSERT_EQ(*first, 42);
+}
+
+TEST(ChunkedVectorTest, chunks)
+{
+    auto v = gen_iota(100);
+
+    // The chunks double from 4 to 16 elements, then stay at 16.
+    std::vector<std::size_t> sizes;
+    int expected = 0;
+    for (const auto& chunk : v.chunks())
+    {
+        ASSERT_EQ(chunk.offset, std::size_t(expected));
+        for (int x : chunk)
+        {
+            ASSERT_EQ(x, expected++);
+        }
+        sizes.push_back(chunk.size);
+    }
+    std::vector<std::size_t> norm { 4, 8, 16, 16, 16, 16, 16, 8 };
+    ASSERT_EQ(sizes, norm);
+    ASSERT_EQ(expected, 100);
+}
+
+TEST(ChunkedVectorTest, chunk_ranges)
+{
+    auto v = gen_iota(100);
+
+    // The chunks of [6, 30) are the end of the second one, the third one and
+    // the start of the fourth one.
+    std::vector<std::size_t> offsets;
+    int expected = 6;
+    for (const auto& chunk : v.chunks(6, 30))
+    {
+        ASSERT_EQ(chunk.offset, std::size_t(expected));
+        for (int x : chunk)
+        {
+            ASSERT_EQ(x, expected++);
+        }
+        offsets.push_back(chunk.offset);
+    }
+    std::vector<std::size_t> norm { 6, 12, 28 };
+    ASSERT_EQ(offsets, norm);
+    ASSERT_EQ(expected, 30);
+    ASSERT_EQ(v.chunks(10, 10).begin(), v.chunks(10, 10).end());
+
+    auto chunk = v.chunk_of(13);
+    ASSERT_EQ(chunk.offset, 12u);
+    ASSERT_EQ(chunk.size, 16u);
+    ASSERT_EQ(chunk.data[1], 13);
+}
+
+TEST(ChunkedVectorTest, copy_and_move)
+{
+    auto v = gen_iota(50);
+
+    auto copy = v;
+    ASSERT_EQ(copy, v);
+    copy[10] = -1;
+    ASSERT_NE(copy, v);
+
+    auto moved = std::move(copy);
+    ASSERT_EQ(moved[10], -1);
+    ASSERT_TRUE(copy.empty());
+
+    ASSERT_EQ(std::accumulate(v.begin(), v.end(), 0), 49 * 50 / 2);
+}
+
+TEST(ChunkedVectorTest, spill)
+{
+    StorageSettingsGuard guard;
+    std::size_t mapped = ChunkStorage::get_mapped_usage();
+
+    // Without any RAM budget left, all the chunks are mapped.
+    ChunkStorage::set_ram_budget(0);
+    {
+        auto v = gen_iota(100);
+        ASSERT_GT(ChunkStorage::get_mapped_usage(), mapped);
+        ASSERT_EQ(v[99], 99);
+
+        ChunkStorage::set_spill_directory("/tmp");
+        auto w = gen_iota(100);
+        ASSERT_EQ(w, v);
+    }
+    ASSERT_EQ(ChunkStorage::get_mapped_usage(), mapped);
+}
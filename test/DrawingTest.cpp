@@ -19,7 +19,7 @@ public:
         : turtle(parameters)
         {
             // Turtle is normally initialized inside
-            // drawing::compute_vertices. Manually initialized here to
+            // drawing::compute_paths. Manually initialized here to
             // test smaller the functions.
         }
     
@@ -35,32 +35,18 @@ public:
     impl::Turtle turtle;
 };
 
-// SFML does not provide an equality operator for sf::Vertex. It is
-// defined inside the 'sf' namespace to help googletest find it.
-namespace sf
-{
-    inline bool operator== (const sf::Vertex& left, const sf::Vertex& right)
-    {
-        return
-            left.position == right.position &&
-            left.color == right.color &&
-            left.texCoords == right.texCoords;
-    }
-}
-
 // Test the go_forward order.
 TEST_F(DrawingTest, go_forward)
 {
-    sf::Vertex begin { parameters.starting_position };
+    sf::Vector2f begin { parameters.starting_position };
     float newx = parameters.step * std::cos(turtle.state.angle);
     float newy = parameters.step * std::sin(turtle.state.angle);
-    sf::Vector2f end_pos = begin.position + sf::Vector2f (newx, newy);
-    sf::Vertex end { end_pos } ;
+    sf::Vector2f end = begin + sf::Vector2f (newx, newy);
 
     go_forward_fn(turtle);
     
-    ASSERT_EQ(turtle.vertices.at(0), begin);
-    ASSERT_EQ(turtle.vertices.at(1), end);
+    ASSERT_EQ(turtle.paths.positions.at(0), begin);
+    ASSERT_EQ(turtle.paths.positions.at(1), end);
 }
 
 // Test the turn_right order.
@@ -95,6 +81,31 @@ TEST_F(DrawingTest, stack_test)
 
 }
 
+// Loading a position starts a new polyline, without any additional position.
+TEST_F(DrawingTest, polyline_breaks)
+{
+    save_position_fn(turtle);
+    go_forward_fn(turtle);
+    load_position_fn(turtle);
+    go_forward_fn(turtle);
+
+    std::vector<std::size_t> breaks { 2 };
+    ASSERT_EQ(turtle.paths.positions.size(), 4u);
+    ASSERT_EQ(turtle.paths.breaks, breaks);
+    ASSERT_EQ(turtle.paths.positions.at(2), parameters.starting_position);
+
+    // A polyline of a single position is replaced by the next one.
+    save_position_fn(turtle);
+    save_position_fn(turtle);
+    go_forward_fn(turtle);
+    load_position_fn(turtle);
+    load_position_fn(turtle);
+
+    breaks.push_back(5);
+    ASSERT_EQ(turtle.paths.positions.size(), 6u);
+    ASSERT_EQ(turtle.paths.breaks, breaks);
+}
+
 // The L-system defined returns the string: "F+G" with 1 iteration.
 // The turtle interpretation of "F+G" in this case is:
 //   1. go_forward
@@ -106,13 +117,115 @@ TEST_F(DrawingTest, compute_paths)
     turn_left_fn (turtle);
     go_forward_fn(turtle);
 
-    std::vector<sf::Vertex> norm { turtle.vertices.at(0),
-                                   turtle.vertices.at(1),
-                                   turtle.vertices.at(2)  };
+    std::vector<sf::Vector2f> norm { turtle.paths.positions.at(0),
+                                     turtle.paths.positions.at(1),
+                                     turtle.paths.positions.at(2)  };
     
 
     parameters.n_iter = 1;
-    auto res = compute_vertices(lsys, interpretation, parameters);
+    auto res = compute_paths(lsys, interpretation, parameters);
 
-    ASSERT_EQ(res, norm);
+    ASSERT_EQ(std::vector<sf::Vector2f>(res.positions.begin(), res.positions.end()), norm);
+    ASSERT_TRUE(res.breaks.empty());
+}
+
+// The interpretation of snapshots is the same as the interpretation of the
+// L-system.
+TEST_F(DrawingTest, compute_paths_snapshot)
+{
+    parameters.n_iter = 3;
+    auto norm = compute_paths(lsys, interpretation, parameters);
+    auto res = compute_paths(*lsys.get_snapshot(), *interpretation.get_snapshot(), parameters);
+
+    ASSERT_EQ(res.paths.positions, norm.positions);
+    ASSERT_EQ(res.paths.breaks, norm.breaks);
+    ASSERT_EQ(res.lsys_version, lsys.get_version());
+    ASSERT_EQ(res.interpretation_version, interpretation.get_version());
+}
+
+// The bounding boxes computed during the interpretation are the same as the
+// ones computed separately.
+TEST_F(DrawingTest, compute_paths_boxes)
+{
+    parameters.n_iter = 5;
+    auto res = compute_paths(*lsys.get_snapshot(), *interpretation.get_snapshot(), parameters, 4);
+
+    ASSERT_EQ(res.bounding_box, geometry::compute_bounding_box(res.paths.positions));
+    ASSERT_EQ(res.sub_boxes, geometry::compute_sub_boxes(res.paths.positions, 4));
+}
+
+// The jumps to a saved position keep the sub-boxes aligned on the positions,
+// even when a polyline of a single position is replaced.
+TEST_F(DrawingTest, load_position_boxes)
+{
+    LSystem plant { "X", { { 'X', "F[+X][-X]FX" } } };
+    impl::Turtle boxed_turtle (parameters, 3);
+    for (char c : plant.produce(3))
+    {
+        if (interpretation.has_predecessor(c))
+        {
+            interpretation.get_rule(c).second(boxed_turtle);
+        }
+    }
+
+    // Each sub-box after the first one starts at the last position of the
+    // previous one.
+    const auto& positions = boxed_turtle.paths.positions;
+    auto sub_boxes = boxed_turtle.boxes.get_sub_boxes();
+    ASSERT_EQ(sub_boxes.size(), positions.size() / 2);
+    for (std::size_t i = 0; i < positions.size(); ++i)
+    {
+        auto box = std::min(i / 2, sub_boxes.size() - 1);
+        ASSERT_TRUE(geometry::contains(sub_boxes[box], positions[i]));
+    }
+}
+
+// The batch interpretation gives the same paths as the interpretation of each
+// DrawingParameters.
+TEST_F(DrawingTest, compute_paths_batch)
+{
+    LSystem plant { "X", { { 'X', "F[+X][-X]FX" }, { 'F', "FF" } } };
+    interpretation.add_rule('X', go_forward);
+    std::vector<DrawingParameters> batch;
+    for (int i = 0; i < 5; ++i)
+    {
+        parameters.n_iter = 3;
+        parameters.delta_angle = degree_to_rad(20.f + 5 * i);
+        parameters.step = 5 + i;
+        batch.push_back(parameters);
+    }
+
+    auto res = compute_paths(*plant.get_snapshot(), *interpretation.get_snapshot(), batch);
+
+    ASSERT_EQ(res.size(), batch.size());
+    for (std::size_t i = 0; i < batch.size(); ++i)
+    {
+        auto norm = compute_paths(*plant.get_snapshot(), *interpretation.get_snapshot(), batch[i]);
+        ASSERT_EQ(res[i].breaks, norm.paths.breaks);
+        ASSERT_EQ(res[i].positions.size(), norm.paths.positions.size());
+        for (std::size_t j = 0; j < norm.paths.positions.size(); ++j)
+        {
+            ASSERT_NEAR(res[i].positions[j].x, norm.paths.positions[j].x, 1e-3);
+            ASSERT_NEAR(res[i].positions[j].y, norm.paths.positions[j].y, 1e-3);
+        }
+    }
+}
+
+// The parameters are interpolated between the keyframes, except the number of
+// iterations.
+TEST(DrawingParametersTest, interpolate)
+{
+    DrawingParameters first { { 0, 0 }, 0.f, 1.f, 10, 2 };
+    DrawingParameters second { { 100, 50 }, 1.f, 2.f, 20, 4 };
+    std::vector<Keyframe> keyframes { { 1.f, first }, { 3.f, second } };
+
+    auto middle = interpolate(keyframes, 2.f);
+    ASSERT_EQ(middle.starting_position, sf::Vector2f(50, 25));
+    ASSERT_FLOAT_EQ(middle.starting_angle, 0.5f);
+    ASSERT_FLOAT_EQ(middle.delta_angle, 1.5f);
+    ASSERT_EQ(middle.step, 15);
+    ASSERT_EQ(middle.n_iter, 2);
+
+    ASSERT_EQ(interpolate(keyframes, 0.f).step, 10);
+    ASSERT_EQ(interpolate(keyframes, 5.f).n_iter, 4);
 }
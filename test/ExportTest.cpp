@@ -0,0 +1,185 @@
+#include <sstream>
+
+#include <gtest/gtest.h>
+
+#include "Export.h"
+#include "Turtle.h"
+
+using namespace drawing;
+using namespace exporter;
+
+// Count the occurrences of 'pattern' in 'str'.
+static std::size_t count(const std::string& str, const std::string& pattern)
+{
+    std::size_t n = 0;
+    for (auto pos = str.find(pattern); pos != std::string::npos; pos = str.find(pattern, pos + 1))
+    {
+        ++n;
+    }
+    return n;
+}
+
+// A sink storing the streamed polylines.
+struct PolylinesSink
+{
+    void move_to(const sf::Vector2f& position)
+    {
+        if (paths.positions.size() > 0)
+        {
+            paths.breaks.push_back(paths.positions.size());
+        }
+        paths.positions.push_back(position);
+    }
+
+    void line_to(const sf::Vector2f& position)
+    {
+        paths.positions.push_back(position);
+    }
+
+    geometry::Polylines paths;
+};
+
+class ExportTest : public ::testing::Test
+{
+public:
+    LSystem plant { "X", { { 'X', "F[+X][-X]FX" }, { 'F', "FF" } } };
+    InterpretationMap interpretation { { 'F', go_forward },
+                                       { '+', turn_left  },
+                                       { '-', turn_right },
+                                       { '[', save_position },
+                                       { ']', load_position } };
+    DrawingParameters parameters { { 0, 0 }, 0, math::degree_to_rad(25.7), 5, 4 };
+};
+
+// The streamed positions are the ones of 'compute_paths()', without the
+// polylines of a single position.
+TEST_F(ExportTest, stream_paths)
+{
+    PolylinesSink sink;
+    stream_paths(*plant.get_snapshot(), *interpretation.get_snapshot(), parameters, sink);
+    auto expected = compute_paths(plant, interpretation, parameters);
+
+    std::vector<sf::Vector2f> positions;
+    std::vector<std::size_t> breaks;
+    for (std::size_t i = 0; i <= expected.breaks.size(); ++i)
+    {
+        std::size_t first = i == 0 ? 0 : expected.breaks[i - 1];
+        std::size_t last = i < expected.breaks.size() ? expected.breaks[i] : expected.positions.size();
+        if (last - first < 2)
+        {
+            continue;
+        }
+        if (!positions.empty())
+        {
+            breaks.push_back(positions.size());
+        }
+        for (auto j = first; j < last; ++j)
+        {
+            positions.push_back(expected.positions[j]);
+        }
+    }
+
+    ASSERT_EQ(sink.paths.breaks, breaks);
+    ASSERT_EQ(sink.paths.positions.size(), positions.size());
+    for (std::size_t i = 0; i < positions.size(); ++i)
+    {
+        ASSERT_EQ(sink.paths.positions[i], positions[i]);
+    }
+}
+
+// The iterations not produced are derived while they are streamed, and the
+// positions are the same as the ones of a produced iteration.
+TEST_F(ExportTest, stream_paths_derivation)
+{
+    auto snapshot = plant.get_snapshot();
+    ASSERT_FALSE(snapshot->is_produced(parameters.n_iter));
+    PolylinesSink derived;
+    stream_paths(*snapshot, *interpretation.get_snapshot(), parameters, derived);
+    ASSERT_FALSE(snapshot->is_produced(parameters.n_iter));
+
+    snapshot->produce(parameters.n_iter);
+    PolylinesSink produced;
+    stream_paths(*snapshot, *interpretation.get_snapshot(), parameters, produced);
+
+    ASSERT_EQ(derived.paths.breaks, produced.paths.breaks);
+    ASSERT_EQ(derived.paths.positions, produced.paths.positions);
+}
+
+TEST_F(ExportTest, buffered_writer)
+{
+    std::ostringstream os;
+    {
+        // The buffer is smaller than the text, and is flushed several times.
+        BufferedWriter writer (os, 4);
+        writer.write("abcdefghij");
+        writer.write(' ');
+        for (double value : {12.5, -3., 0.05, -0.004, 1234.567, 0.})
+        {
+            writer.write_number(value, 2);
+            writer.write(' ');
+        }
+        writer.write_number(2.5, 0);
+        ASSERT_EQ(writer.get_size(), 37u);
+    }
+    ASSERT_EQ(os.str(), "abcdefghij 12.5 -3 0.05 0 1234.57 0 3");
+}
+
+TEST_F(ExportTest, svg)
+{
+    std::ostringstream os;
+    ExportParameters style;
+    style.max_path_commands = 4;
+    {
+        SvgWriter svg (os, {0, 0, 10, 20}, style);
+        svg.move_to({0, 0});
+        svg.line_to({1, 0});
+        svg.line_to({1, 1});
+        svg.move_to({5, 5});
+        svg.line_to({6, 5});
+        svg.line_to({6, 6});
+    }
+    auto str = os.str();
+
+    ASSERT_EQ(str.substr(0, 5), "<?xml");
+    ASSERT_NE(str.find("viewBox=\"0 0 10 20\" width=\"10\" height=\"20\""), std::string::npos);
+    ASSERT_NE(str.find("stroke=\"#000000\""), std::string::npos);
+    // The second polyline overflows the first path, and continues in a new
+    // one from its last position.
+    ASSERT_NE(str.find("<path d=\"M0 0L1 0L1 1\nM5 5\"/>\n<path d=\"M5 5L6 5L6 6\"/>\n"), std::string::npos);
+    ASSERT_EQ(count(str, "<path"), 2u);
+    ASSERT_EQ(str.substr(str.size() - 12), "</g>\n</svg>\n");
+}
+
+TEST_F(ExportTest, eps)
+{
+    std::ostringstream os;
+    EpsWriter eps (os);
+    eps.move_to({0, 0});
+    eps.line_to({10, 0});
+    eps.line_to({10, 20.5});
+    eps.finish();
+    auto str = os.str();
+
+    ASSERT_EQ(str.substr(0, 23), "%!PS-Adobe-3.0 EPSF-3.0");
+    ASSERT_NE(str.find("%%BoundingBox: (atend)\n"), std::string::npos);
+    ASSERT_NE(str.find("0 0 m\n10 0 l\n10 -20.5 l\nstroke\n"), std::string::npos);
+    // The y axis is flipped, and the box includes the width of the lines.
+    ASSERT_NE(str.find("%%Trailer\n%%BoundingBox: -1 -21 11 1\n"
+                       "%%HiResBoundingBox: -0.5 -21 10.5 0.5\n%%EOF\n"), std::string::npos);
+}
+
+// A whole drawing is exported as it is interpreted.
+TEST_F(ExportTest, stream_svg)
+{
+    BoundsSink bounds;
+    stream_paths(*plant.get_snapshot(), *interpretation.get_snapshot(), parameters, bounds);
+    auto paths = compute_paths(plant, interpretation, parameters);
+    ASSERT_EQ(bounds.get_bounding_box(), geometry::compute_bounding_box(paths.positions));
+
+    std::ostringstream os;
+    SvgWriter svg (os, bounds.get_bounding_box());
+    stream_paths(*plant.get_snapshot(), *interpretation.get_snapshot(), parameters, svg);
+    svg.finish();
+    ASSERT_EQ(svg.get_size(), os.str().size());
+    ASSERT_EQ(count(os.str(), "M"), paths.breaks.size() + 1);
+}
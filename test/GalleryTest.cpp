@@ -0,0 +1,101 @@
+#include <sstream>
+
+#include <gtest/gtest.h>
+
+#include "Gallery.h"
+#include "Turtle.h"
+
+using namespace drawing;
+
+class GalleryTest : public ::testing::Test
+{
+public:
+    GalleryTest()
+    {
+        sweep.delta_angles = linear_range(math::degree_to_rad(20.), math::degree_to_rad(30.), 3);
+        sweep.steps = {5, 10};
+        sweep.n_iters = {3, 1};
+        parameters.thumbnail.width = 32;
+        parameters.thumbnail.height = 24;
+        parameters.batch_size = 2;
+    }
+
+    LSystem plant { "X", { { 'X', "F[+X][-X]FX" }, { 'F', "FF" } } };
+    InterpretationMap interpretation { { 'F', go_forward },
+                                       { '+', turn_left  },
+                                       { '-', turn_right },
+                                       { '[', save_position },
+                                       { ']', load_position } };
+    ParameterSweep sweep;
+    GalleryParameters parameters;
+};
+
+TEST_F(GalleryTest, linear_range)
+{
+    ASSERT_EQ(linear_range(1, 2, 3), std::vector<double>({1, 1.5, 2}));
+    ASSERT_EQ(linear_range(4, 8, 1), std::vector<double>({4}));
+}
+
+// The cells sweep the angles, then the steps, then the iterations.
+TEST_F(GalleryTest, sweep)
+{
+    ASSERT_EQ(sweep.size(), 12u);
+    auto cell = sweep.at(7);
+    ASSERT_DOUBLE_EQ(cell.delta_angle, sweep.delta_angles[1]);
+    ASSERT_EQ(cell.step, 5);
+    ASSERT_EQ(cell.n_iter, 1);
+}
+
+// Each cell is computed as by 'compute_paths()' with its parameters.
+TEST_F(GalleryTest, compute_gallery)
+{
+    ThreadPool pool (2);
+    auto lsys = plant.get_snapshot();
+    auto cells = compute_gallery(*lsys, *interpretation.get_snapshot(), sweep, parameters, pool);
+
+    ASSERT_EQ(cells.size(), sweep.size());
+    for (std::size_t i = 0; i < cells.size(); ++i)
+    {
+        auto expected = sweep.at(i);
+        ASSERT_EQ(cells[i].parameters.n_iter, expected.n_iter);
+        ASSERT_EQ(cells[i].parameters.step, expected.step);
+
+        auto paths = compute_paths(*lsys, *interpretation.get_snapshot(), expected).paths;
+        ASSERT_EQ(cells[i].n_symbols, lsys->produce(expected.n_iter).size());
+        ASSERT_EQ(cells[i].n_positions, paths.positions.size());
+        ASSERT_EQ(cells[i].n_polylines, paths.breaks.size() + 1);
+        ASSERT_EQ(cells[i].thumbnail.width, 32u);
+        ASSERT_EQ(cells[i].thumbnail.height, 24u);
+    }
+}
+
+TEST_F(GalleryTest, contact_sheet)
+{
+    ThreadPool pool (2);
+    auto cells = compute_gallery(*plant.get_snapshot(), *interpretation.get_snapshot(), sweep, parameters, pool);
+
+    auto sheet = make_contact_sheet(cells, 3, 2);
+    ASSERT_EQ(sheet.width, 3 * 32u + 4 * 2u);
+    ASSERT_EQ(sheet.height, 4 * 24u + 5 * 2u);
+    ASSERT_EQ(sheet.pixels.size(), sheet.width * sheet.height * 4u);
+    // The top-left corner is the spacing, the next pixel in diagonal is the
+    // first thumbnail.
+    ASSERT_EQ(sheet.pixels[0], 64);
+    auto first = (2 * sheet.width + 2) * 4;
+    ASSERT_EQ(sheet.pixels[first + 3], cells[0].thumbnail.pixels[3]);
+
+    std::ostringstream os;
+    write_gallery_csv(os, cells, 3);
+    std::istringstream is (os.str());
+    std::string line;
+    std::getline(is, line);
+    ASSERT_EQ(line.substr(0, 19), "row,column,n_iter,s");
+    std::getline(is, line);
+    ASSERT_EQ(line.substr(0, 11), "0,0,3,5,20,");
+    std::size_t n_lines = 1;
+    while (std::getline(is, line))
+    {
+        ++n_lines;
+    }
+    ASSERT_EQ(n_lines, cells.size());
+}
@@ -109,3 +109,75 @@ TEST(LSystemTest, wild_derivation)
     ASSERT_EQ(lsys.produce(5), iter_5);
 }
 
+
+// A modification of a rule only discards the iterations depending on it.
+TEST(LSystemTest, partial_invalidation)
+{
+    LSystem lsys { "F", { { 'F', "F+G" } } };
+    lsys.produce(3);
+    auto version = lsys.get_version();
+
+    // 'X' does not appear in any iteration: the cache is left untouched.
+    lsys.add_rule('X', "XX");
+    ASSERT_EQ(lsys.get_cache().size(), 4u);
+    ASSERT_LE(lsys.get_iteration_version(3), version);
+
+    // 'G' appears first in the iteration 1: the iterations 2 and 3 are
+    // discarded.
+    lsys.add_rule('G', "G-F");
+    ASSERT_EQ(lsys.get_cache().size(), 2u);
+    ASSERT_EQ(lsys.produce(3), "F+G+G-F+G-F-F+G");
+    ASSERT_GT(lsys.get_iteration_version(3), version);
+
+    lsys.remove_rule('X');
+    ASSERT_EQ(lsys.get_cache().size(), 4u);
+}
+
+TEST(LSystemTest, snapshot)
+{
+    LSystem lsys { "F", { { 'F', "F+G" }, { 'G', "G-F" } } };
+
+    auto snapshot = lsys.get_snapshot();
+    ASSERT_EQ(snapshot->version, 0u);
+    ASSERT_EQ(snapshot->axiom, "F");
+    ASSERT_EQ(snapshot->produce(3), "F+G+G-F+G-F-F+G");
+
+    // A modification publishes a new snapshot but does not touch the old one.
+    lsys.set_axiom("G");
+    lsys.add_rule('F', "FF");
+    auto new_snapshot = lsys.get_snapshot();
+    ASSERT_EQ(new_snapshot->version, lsys.get_version());
+    ASSERT_EQ(new_snapshot->axiom, "G");
+    ASSERT_EQ(new_snapshot->produce(2), lsys.produce(2));
+    ASSERT_EQ(snapshot->axiom, "F");
+    ASSERT_EQ(snapshot->produce(1), "F+G");
+
+    // The rules are shared with the snapshot of the RuleMap.
+    const RuleMap<std::string>& rules = lsys;
+    ASSERT_EQ(&new_snapshot->rules, &rules.get_snapshot()->rules);
+    ASSERT_EQ(new_snapshot->rules.at('F'), "FF");
+}
+
+// The iterations still valid after a modification are shared with the next
+// snapshot, as in the cache of the LSystem.
+TEST(LSystemTest, snapshot_partial_invalidation)
+{
+    LSystem lsys { "F", { { 'F', "F+G" } } };
+    auto snapshot = lsys.get_snapshot();
+    snapshot->produce(3);
+
+    // 'G' appears first in the iteration 1: the iterations 2 and 3 are
+    // discarded.
+    lsys.add_rule('G', "G-F");
+    auto new_snapshot = lsys.get_snapshot();
+    ASSERT_TRUE(new_snapshot->is_produced(1));
+    ASSERT_FALSE(new_snapshot->is_produced(2));
+    ASSERT_EQ(&new_snapshot->produce(1), &snapshot->produce(1));
+    ASSERT_EQ(new_snapshot->produce(3), "F+G+G-F+G-F-F+G");
+    ASSERT_EQ(snapshot->produce(3), "F+G+G+G");
+
+    // A new axiom discards everything.
+    lsys.set_axiom("G");
+    ASSERT_FALSE(lsys.get_snapshot()->is_produced(1));
+    ASSERT_EQ(lsys.get_snapshot()->produce(1), "G-F");
+}
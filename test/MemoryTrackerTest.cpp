@@ -0,0 +1,76 @@
+#include <sstream>
+
+#include <gtest/gtest.h>
+
+#include "MemoryTracker.h"
+#include "LSystem.h"
+
+TEST(MemoryTrackerTest, heap_bytes)
+{
+    std::string small = "F";
+    std::string large (1000, 'F');
+    std::vector<int> v (100);
+
+    ASSERT_EQ(heap_bytes(small), 0u);
+    ASSERT_EQ(heap_bytes(large), large.capacity() + 1);
+    ASSERT_EQ(heap_bytes(v), 100 * sizeof(int));
+}
+
+// The high-water marks stay at the highest sampled usage, even after the
+// removal of a source.
+TEST(MemoryTrackerTest, high_water_marks)
+{
+    MemoryTracker tracker;
+    std::size_t bytes = 100;
+    int a = tracker.add_source("a", [&bytes]() { MemoryUsage u; u.add("x", bytes); return u; });
+    tracker.add_source("b", []() { MemoryUsage u; u.add("y", 10); u.add("z", 5); return u; });
+
+    auto samples = tracker.sample();
+    ASSERT_EQ(samples.size(), 2u);
+    ASSERT_EQ(samples.at(0).name, "a");
+    ASSERT_EQ(samples.at(1).usage.total(), 15u);
+    ASSERT_EQ(tracker.get_high_water_mark(), 115u);
+
+    bytes = 50;
+    samples = tracker.sample();
+    ASSERT_EQ(samples.at(0).usage.total(), 50u);
+    ASSERT_EQ(samples.at(0).high_water_mark, 100u);
+
+    tracker.remove_source(a);
+    std::ostringstream oss;
+    tracker.dump(oss);
+    ASSERT_EQ(oss.str(), "b: 15 bytes (high-water mark: 15 bytes)\n"
+                         "    y: 10 bytes\n"
+                         "    z: 5 bytes\n"
+                         "Total: 15 bytes (high-water mark: 115 bytes)\n");
+}
+
+// A scoped source is removed at the destruction of its last handle, and
+// releases the objects it captures.
+TEST(MemoryTrackerTest, scoped_source)
+{
+    MemoryTracker tracker;
+    auto lsys = std::make_shared<LSystem>(LSystem { "F", { { 'F', "F+F" } } });
+    {
+        MemoryTracker::ScopedSource source (tracker, "lsys", [lsys]() { return lsys->memory_usage(); });
+        ASSERT_EQ(lsys.use_count(), 2);
+        MemoryTracker::ScopedSource moved (std::move(source));
+        ASSERT_EQ(tracker.sample().size(), 1u);
+    }
+    ASSERT_TRUE(tracker.sample().empty());
+    ASSERT_EQ(lsys.use_count(), 1);
+}
+
+// Each cached iteration of a LSystem is accounted.
+TEST(MemoryTrackerTest, lsystem)
+{
+    LSystem lsys { "F", { { 'F', "F+F-F-F+F" } } };
+    auto before = lsys.memory_usage();
+    lsys.produce(4);
+    auto after = lsys.memory_usage();
+
+    ASSERT_EQ(after.items.size(), before.items.size() + 4);
+    ASSERT_EQ(after.items.at(4).name, "iteration 4");
+    ASSERT_GT(after.items.at(4).bytes, lsys.produce(4).size());
+    ASSERT_GT(after.total(), before.total());
+}
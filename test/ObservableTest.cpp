@@ -1,7 +1,16 @@
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
 #include <gtest/gtest.h>
 
 #include "Observer.h"
 #include "Observable.h"
+#include "RuleMap.h"
+#include "ThreadPool.h"
 
 using namespace std;
 
@@ -121,3 +130,173 @@ TEST(ObservableTest, multiple)
     ASSERT_TRUE(a2->empty());
     ASSERT_TRUE(b3->empty());
 }
+
+TEST(ObservableTest, change_descriptor)
+{
+    auto map = std::make_shared<RuleMap<int>>(RuleMap<int>{ { 'A', 0 } });
+    Observable::Change last;
+    map->add_observer([&last](const Observable::Change& c){ last = c; });
+
+    map->add_rule('B', 1);
+    ASSERT_EQ(last.kind, Observable::Change::Kind::RULE_ADDED);
+    ASSERT_EQ(last.predecessor, 'B');
+    ASSERT_EQ(last.old_version, 0u);
+    ASSERT_EQ(last.new_version, 1u);
+
+    map->add_rule('A', 2);
+    ASSERT_EQ(last.kind, Observable::Change::Kind::RULE_CHANGED);
+    ASSERT_EQ(last.predecessor, 'A');
+
+    map->remove_rule('A');
+    ASSERT_EQ(last.kind, Observable::Change::Kind::RULE_REMOVED);
+    ASSERT_EQ(last.predecessor, 'A');
+
+    map->clear_rules();
+    ASSERT_EQ(last.kind, Observable::Change::Kind::RULES_CLEARED);
+    ASSERT_EQ(last.old_version, 3u);
+    ASSERT_EQ(last.new_version, 4u);
+    ASSERT_EQ(map->get_version(), 4u);
+}
+
+// A callback removed during a notification is not called by it.
+TEST(ObservableTest, remove_during_notify)
+{
+    auto a = std::make_shared<A>(0);
+    int id1 = -1, id2 = -1;
+    int calls = 0;
+    id1 = a->add_observer([&](){ ++calls; a->remove_observer(id2); });
+    id2 = a->add_observer([&](){ ++calls; a->remove_observer(id1); });
+
+    a->increment();
+    ASSERT_EQ(calls, 1);
+    ASSERT_FALSE(a->empty());
+}
+
+// A callback added during a notification is not called by it.
+TEST(ObservableTest, add_during_notify)
+{
+    auto a = std::make_shared<A>(0);
+    int calls = 0;
+    a->add_observer([&](){ a->add_observer([&](){ ++calls; }); });
+
+    a->increment();
+    ASSERT_EQ(calls, 0);
+    a->increment();
+    ASSERT_EQ(calls, 1);
+}
+
+TEST(ObservableTest, executor)
+{
+    auto a = std::make_shared<A>(0);
+    std::vector<std::function<void()>> tasks;
+    auto queue = [&tasks](std::function<void()> task){ tasks.push_back(task); };
+
+    unsigned long version = 0;
+    int id = a->add_observer([&version](const Observable::Change& c){ version = c.new_version; }, queue);
+    a->increment();
+    ASSERT_EQ(version, 0u);
+    ASSERT_EQ(tasks.size(), 1u);
+    tasks.at(0)();
+    ASSERT_EQ(version, 1u);
+
+    // A removed callback is cancelled even if its task is waiting.
+    a->increment();
+    a->remove_observer(id);
+    tasks.at(1)();
+    ASSERT_EQ(version, 1u);
+}
+
+// The removal of a callback waits for its call running on another thread, so
+// the objects it uses can be destroyed right after.
+TEST(ObservableTest, remove_during_executor_call)
+{
+    auto a = std::make_shared<A>(0);
+    ThreadPool pool (1);
+    std::mutex mutex;
+    std::condition_variable condition;
+    bool is_running = false;
+    bool is_released = false;
+    std::atomic<bool> is_finished { false };
+
+    int id = a->add_observer([&]()
+        {
+            std::unique_lock<std::mutex> lock (mutex);
+            is_running = true;
+            condition.notify_all();
+            condition.wait(lock, [&]() { return is_released; });
+            is_finished = true;
+        }, pool.executor());
+    a->increment();
+    {
+        std::unique_lock<std::mutex> lock (mutex);
+        condition.wait(lock, [&]() { return is_running; });
+    }
+
+    // The callback is blocked: it is released by another thread while the
+    // removal waits for it.
+    std::thread releaser ([&]()
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(50));
+            std::lock_guard<std::mutex> lock (mutex);
+            is_released = true;
+            condition.notify_all();
+        });
+    a->remove_observer(id);
+    bool is_waited = is_finished;
+    releaser.join();
+    pool.wait();
+    ASSERT_TRUE(is_waited);
+}
+
+// A callback running on an executor can remove itself without waiting for
+// its own call.
+TEST(ObservableTest, remove_itself_on_executor)
+{
+    auto a = std::make_shared<A>(0);
+    ThreadPool pool (1);
+    std::atomic<int> calls { 0 };
+    int id = -1;
+    id = a->add_observer([&]() { ++calls; a->remove_observer(id); }, pool.executor());
+    a->increment();
+    pool.wait();
+    a->increment();
+    pool.wait();
+    ASSERT_EQ(calls, 1);
+    ASSERT_TRUE(a->empty());
+}
+
+TEST(ObservableTest, concurrent_observers)
+{
+    auto a = std::make_shared<A>(0);
+    std::atomic<int> calls { 0 };
+    const int n_threads = 4;
+    const int n_loops = 200;
+
+    std::vector<std::thread> threads;
+    for (int i=0; i<n_threads; ++i)
+    {
+        threads.emplace_back([&]()
+                             {
+                                 for (int j=0; j<n_loops; ++j)
+                                 {
+                                     C c (a);
+                                     int id = a->add_observer([&calls](){ ++calls; });
+                                     a->remove_observer(id);
+                                 }
+                             });
+    }
+    threads.emplace_back([&]()
+                         {
+                             for (int j=0; j<n_loops; ++j)
+                             {
+                                 a->add_observer([&calls](){ ++calls; });
+                             }
+                         });
+    for (auto& t : threads)
+    {
+        t.join();
+    }
+
+    a->increment();
+    ASSERT_EQ(calls, n_loops);
+}
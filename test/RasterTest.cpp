@@ -0,0 +1,364 @@
+#include <sstream>
+#include <stdexcept>
+#include <string>
+
+#include <gtest/gtest.h>
+
+#include "Raster.h"
+#include "Png.h"
+
+using namespace raster;
+
+// The red channel of the pixel (x, y) of 'image'.
+static int red(const Image& image, unsigned x, unsigned y)
+{
+    return image.pixels.at((y * image.width + x) * 4);
+}
+
+// A 64x64 image of the world [0, 64]x[0, 64], tiled in 16x16 tiles.
+static RasterParameters parameters()
+{
+    RasterParameters parameters;
+    parameters.width = 64;
+    parameters.height = 64;
+    parameters.view = {0, 0, 64, 64};
+    parameters.tile_size = 16;
+    return parameters;
+}
+
+// A minimal inflater of the zlib streams, for the stored and the fixed
+// Huffman blocks only: the ones of 'write_png()'. Throws
+// 'std::runtime_error' on the other blocks and on the corrupted streams.
+class Inflater
+{
+public:
+    explicit Inflater(const std::string& stream)
+        : stream_ {stream}
+    {
+    }
+
+    std::string inflate()
+    {
+        if (stream_.size() < 6 || byte(0) != 0x78 || ((byte(0) << 8) | byte(1)) % 31 != 0)
+        {
+            throw std::runtime_error("Invalid zlib header");
+        }
+        position_ = 16;
+        bool is_last = false;
+        while (!is_last)
+        {
+            is_last = bits(1);
+            auto type = bits(2);
+            if (type == 0)
+            {
+                stored_block();
+            }
+            else if (type == 1)
+            {
+                fixed_block();
+            }
+            else
+            {
+                throw std::runtime_error("Unsupported block");
+            }
+        }
+
+        // The Adler-32 checksum follows, aligned on a byte.
+        position_ = (position_ + 7) / 8 * 8;
+        std::uint32_t adler = 0;
+        for (int i = 0; i < 4; ++i)
+        {
+            adler = (adler << 8) | bits(8);
+        }
+        if (adler != raster::adler32(reinterpret_cast<const std::uint8_t*>(out_.data()), out_.size()))
+        {
+            throw std::runtime_error("Invalid checksum");
+        }
+        return out_;
+    }
+
+private:
+    unsigned byte(std::size_t i) const
+    {
+        if (i >= stream_.size())
+        {
+            throw std::runtime_error("Truncated stream");
+        }
+        return static_cast<std::uint8_t>(stream_[i]);
+    }
+
+    // Read 'n' bits, from the least significant.
+    unsigned bits(int n)
+    {
+        unsigned value = 0;
+        for (int i = 0; i < n; ++i, ++position_)
+        {
+            value |= ((byte(position_ / 8) >> (position_ % 8)) & 1) << i;
+        }
+        return value;
+    }
+
+    // Read the 'n' bits of a Huffman code, from the most significant.
+    unsigned bits_msb(int n)
+    {
+        unsigned value = 0;
+        for (int i = 0; i < n; ++i)
+        {
+            value = (value << 1) | bits(1);
+        }
+        return value;
+    }
+
+    void stored_block()
+    {
+        position_ = (position_ + 7) / 8 * 8;
+        auto length = bits(16);
+        auto complement = bits(16);
+        if ((length ^ 0xffff) != complement)
+        {
+            throw std::runtime_error("Invalid stored block");
+        }
+        for (unsigned i = 0; i < length; ++i)
+        {
+            out_.push_back(static_cast<char>(bits(8)));
+        }
+    }
+
+    // Decode a symbol of the fixed literal/length codes.
+    unsigned literal()
+    {
+        unsigned code = bits_msb(7);
+        if (code <= 0x17)
+        {
+            return 256 + code;
+        }
+        code = (code << 1) | bits(1);
+        if (code >= 0x30 && code <= 0xbf)
+        {
+            return code - 0x30;
+        }
+        if (code >= 0xc0 && code <= 0xc7)
+        {
+            return 280 + code - 0xc0;
+        }
+        code = (code << 1) | bits(1);
+        return 144 + code - 0x190;
+    }
+
+    void fixed_block()
+    {
+        static const unsigned length_bases[] = { 3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31,
+                                                 35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258 };
+        static const int length_extras[] = { 0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2,
+                                             3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0 };
+        static const unsigned distance_bases[] = { 1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193,
+                                                   257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145,
+                                                   8193, 12289, 16385, 24577 };
+        for (auto symbol = literal(); symbol != 256; symbol = literal())
+        {
+            if (symbol < 256)
+            {
+                out_.push_back(static_cast<char>(symbol));
+                continue;
+            }
+            if (symbol > 285)
+            {
+                throw std::runtime_error("Invalid length");
+            }
+            auto length = length_bases[symbol - 257] + bits(length_extras[symbol - 257]);
+            auto code = bits_msb(5);
+            if (code > 29)
+            {
+                throw std::runtime_error("Invalid distance");
+            }
+            auto distance = distance_bases[code] + bits(code < 4 ? 0 : code / 2 - 1);
+            if (distance > out_.size())
+            {
+                throw std::runtime_error("Distance before the start");
+            }
+            for (unsigned i = 0; i < length; ++i)
+            {
+                out_.push_back(out_[out_.size() - distance]);
+            }
+        }
+    }
+
+    const std::string& stream_;
+    std::size_t position_ { 0 };
+    std::string out_ { };
+};
+
+TEST(RasterTest, checksums)
+{
+    std::string str = "123456789";
+    auto data = reinterpret_cast<const std::uint8_t*>(str.data());
+    ASSERT_EQ(crc32(data, str.size()), 0xcbf43926u);
+    ASSERT_EQ(crc32(data + 4, 5, crc32(data, 4)), 0xcbf43926u);
+
+    str = "Wikipedia";
+    data = reinterpret_cast<const std::uint8_t*>(str.data());
+    ASSERT_EQ(adler32(data, str.size()), 0x11e60398u);
+}
+
+// The segments are drawn in all the tiles they cross, with the colors of the
+// parameters.
+TEST(RasterTest, rasterize)
+{
+    geometry::Polylines paths;
+    // An horizontal line on the row 10, and a diagonal crossing the tiles.
+    paths.positions = {{0.5f, 10.5f}, {63.5f, 10.5f}};
+    paths.positions.push_back({0.5f, 20.5f});
+    paths.positions.push_back({40.5f, 60.5f});
+    paths.breaks = {2};
+
+    for (bool antialiasing : {true, false})
+    {
+        auto p = parameters();
+        p.antialiasing = antialiasing;
+        auto image = rasterize(paths, p);
+
+        ASSERT_EQ(image.width, 64u);
+        ASSERT_EQ(image.height, 64u);
+        ASSERT_EQ(image.pixels.size(), 64u * 64u * 4u);
+        for (unsigned x = 0; x < 64; ++x)
+        {
+            ASSERT_EQ(red(image, x, 10), 255);
+            ASSERT_EQ(red(image, x, 9), 0);
+        }
+        for (unsigned i = 0; i <= 40; ++i)
+        {
+            ASSERT_EQ(red(image, i, 20 + i), 255);
+        }
+        ASSERT_EQ(red(image, 50, 50), 0);
+        ASSERT_EQ(image.pixels[3], 255);
+    }
+}
+
+// The segment crossing a break is not drawn.
+TEST(RasterTest, breaks)
+{
+    geometry::Polylines paths;
+    paths.positions = {{10.5f, 0.5f}, {10.5f, 30.5f}, {50.5f, 0.5f}, {50.5f, 30.5f}};
+    paths.breaks = {2};
+
+    auto image = rasterize(paths, parameters(), nullptr);
+    ASSERT_EQ(red(image, 10, 15), 255);
+    ASSERT_EQ(red(image, 50, 15), 255);
+    for (unsigned x = 12; x < 49; ++x)
+    {
+        for (unsigned y = 0; y < 31; ++y)
+        {
+            ASSERT_EQ(red(image, x, y), 0);
+        }
+    }
+}
+
+// The view is fitted to the aspect ratio of the image.
+// The segments far out of the image are clipped to it: only their part in
+// the image is drawn.
+TEST(RasterTest, huge_coordinates)
+{
+    geometry::Polylines paths;
+    paths.positions = {{-1e30f, 30.5f}, {1e30f, 30.5f}, {40.5f, -1e20f}, {40.5f, 1e20f}};
+    paths.breaks = {2};
+
+    for (bool antialiasing : {true, false})
+    {
+        auto p = parameters();
+        p.antialiasing = antialiasing;
+        auto image = rasterize(paths, p);
+        for (unsigned i = 0; i < 64; ++i)
+        {
+            ASSERT_EQ(red(image, i, 30), 255);
+            ASSERT_EQ(red(image, 40, i), 255);
+        }
+        ASSERT_EQ(red(image, 10, 10), 0);
+    }
+}
+
+TEST(RasterTest, fit_view)
+{
+    auto view = fit_view({0, 0, 10, 5}, 100, 100, 0.f);
+    ASSERT_FLOAT_EQ(view.left, 0.f);
+    ASSERT_FLOAT_EQ(view.top, -2.5f);
+    ASSERT_FLOAT_EQ(view.width, 10.f);
+    ASSERT_FLOAT_EQ(view.height, 10.f);
+}
+
+TEST(RasterTest, write_png)
+{
+    Image image;
+    image.width = 3;
+    image.height = 2;
+    image.pixels.assign(3 * 2 * 4, 128);
+
+    std::ostringstream os;
+    write_png(os, image);
+    auto png = os.str();
+
+    ASSERT_EQ(png.substr(0, 8), std::string("\x89PNG\r\n\x1a\n"));
+    // The IHDR chunk.
+    ASSERT_EQ(png.substr(8, 8), std::string("\0\0\0\x0dIHDR", 8));
+    ASSERT_EQ(png.substr(16, 8), std::string("\0\0\0\x03\0\0\0\x02", 8));
+    ASSERT_EQ(png.substr(24, 5), std::string("\x08\x06\0\0\0", 5));
+    auto header = reinterpret_cast<const std::uint8_t*>(png.data() + 12);
+    auto crc = static_cast<std::uint32_t>(static_cast<std::uint8_t>(png[29])) << 24 |
+        static_cast<std::uint8_t>(png[30]) << 16 |
+        static_cast<std::uint8_t>(png[31]) << 8 |
+        static_cast<std::uint8_t>(png[32]);
+    ASSERT_EQ(crc, crc32(header, 17));
+
+    ASSERT_EQ(png.substr(37, 4), "IDAT");
+    ASSERT_EQ(png.substr(png.size() - 12), std::string("\0\0\0\0IEND\xae\x42\x60\x82", 12));
+}
+
+// The pixels decoded from the PNG are the ones of the image.
+TEST(RasterTest, write_png_round_trip)
+{
+    // A background with a gradient and a repeated pattern, to have literals,
+    // matches with the previous pixel and matches with the pixel above.
+    Image image;
+    image.width = 37;
+    image.height = 23;
+    image.pixels.resize(image.width * image.height * 4);
+    for (unsigned y = 0; y < image.height; ++y)
+    {
+        for (unsigned x = 0; x < image.width; ++x)
+        {
+            auto pixel = &image.pixels[(y * image.width + x) * 4];
+            pixel[0] = x < 20 ? 255 : static_cast<std::uint8_t>(x * 7);
+            pixel[1] = y % 3 == 0 ? 255 : static_cast<std::uint8_t>(x ^ y);
+            pixel[2] = 255;
+            pixel[3] = static_cast<std::uint8_t>(x == y ? 0 : 255);
+        }
+    }
+
+    std::ostringstream os;
+    write_png(os, image);
+    auto png = os.str();
+
+    // The IDAT chunks are concatenated.
+    std::string stream;
+    for (std::size_t i = 8; i + 12 <= png.size(); )
+    {
+        auto byte = [&png](std::size_t j) { return static_cast<std::uint32_t>(static_cast<std::uint8_t>(png[j])); };
+        auto size = byte(i) << 24 | byte(i + 1) << 16 | byte(i + 2) << 8 | byte(i + 3);
+        if (png.substr(i + 4, 4) == "IDAT")
+        {
+            stream += png.substr(i + 8, size);
+        }
+        i += size + 12;
+    }
+
+    auto rows = Inflater(stream).inflate();
+    const std::size_t stride = image.width * 4 + 1;
+    ASSERT_EQ(rows.size(), stride * image.height);
+    for (unsigned y = 0; y < image.height; ++y)
+    {
+        ASSERT_EQ(rows[y * stride], 0);
+        for (std::size_t i = 0; i < stride - 1; ++i)
+        {
+            ASSERT_EQ(static_cast<std::uint8_t>(rows[y * stride + 1 + i]), image.pixels[y * (stride - 1) + i]);
+        }
+    }
+}
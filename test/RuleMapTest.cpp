@@ -90,3 +90,17 @@ TEST(RuleMapTest, clear_rules)
     ASSERT_EQ(map.get_rules(), empty_rules);
 }
 
+TEST(RuleMapTest, snapshot)
+{
+    RuleMap<int> map { { 'A', 0 } };
+    auto snapshot = map.get_snapshot();
+
+    map.add_rule('B', 1);
+    auto new_snapshot = map.get_snapshot();
+    RuleMap<int>::rule_map old_rules { { 'A', 0 } };
+
+    ASSERT_EQ(snapshot->version, 0u);
+    ASSERT_EQ(snapshot->rules, old_rules);
+    ASSERT_EQ(new_snapshot->version, map.get_version());
+    ASSERT_EQ(new_snapshot->rules, map.get_rules());
+}
@@ -0,0 +1,132 @@
+#include <sstream>
+#include <stdexcept>
+
+#include <gtest/gtest.h>
+
+#include "Session.h"
+
+using namespace drawing;
+using Kind = SessionEvent::Kind;
+
+class SessionTest : public ::testing::Test
+{
+public:
+    std::shared_ptr<LSystem> lsys = std::make_shared<LSystem>(LSystem { "F", { { 'F', "F+F" } } });
+    std::shared_ptr<InterpretationMap> map =
+        std::make_shared<InterpretationMap>(InterpretationMap { { 'F', go_forward },
+                                                                { '+', turn_left } });
+    // starting_position, starting_angle, delta_angle, step, n_iter
+    DrawingParameters parameters { { 100, 100 }, 0.5f, 1.5, 10, 3 };
+};
+
+// The initial state and the modifications of the models are recorded, and
+// read back.
+TEST_F(SessionTest, record)
+{
+    SessionRecorder recorder;
+    int lsys_id = recorder.add_lsystem(lsys);
+    int map_id = recorder.add_interpretation(map);
+    int view = recorder.add_view(lsys_id, map_id, parameters);
+
+    lsys->add_rule('G', "GG");
+    std::ostringstream os;
+    recorder.start(os);
+    lsys->add_rule('F', "F-F");
+    lsys->set_axiom("F F");
+    map->add_rule('-', turn_right);
+    map->remove_rule('+');
+    recorder.record_parameters(view, parameters);
+    parameters.n_iter = 4;
+    recorder.record_parameters(view, parameters);
+    recorder.stop();
+    lsys->remove_rule('G');
+
+    std::istringstream is (os.str());
+    auto events = read_session(is);
+    ASSERT_EQ(events.size(), recorder.get_size());
+
+    std::vector<Kind> expected_kinds
+    { Kind::CLEAR_RULES, Kind::AXIOM, Kind::RULE, Kind::RULE,
+      Kind::CLEAR_ORDERS, Kind::ORDER, Kind::ORDER,
+      Kind::VIEW, Kind::PARAMETERS,
+      Kind::RULE, Kind::AXIOM, Kind::ORDER, Kind::REMOVE_ORDER, Kind::PARAMETERS };
+    std::vector<Kind> kinds;
+    for (const auto& event : events)
+    {
+        kinds.push_back(event.kind);
+    }
+    ASSERT_EQ(kinds, expected_kinds);
+
+    ASSERT_EQ(events[3].predecessor, 'G');
+    ASSERT_EQ(events[3].symbols, "GG");
+    ASSERT_EQ(events[9].symbols, "F-F");
+    ASSERT_EQ(events[10].symbols, "F F");
+    ASSERT_EQ(events[11].order, OrderID::TURN_RIGHT);
+    ASSERT_EQ(events[12].predecessor, '+');
+    ASSERT_EQ(events[13].parameters.n_iter, 4);
+    ASSERT_FLOAT_EQ(events[13].parameters.starting_angle, 0.5f);
+    ASSERT_LE(events[0].time, events[13].time);
+}
+
+TEST_F(SessionTest, read_errors)
+{
+    std::istringstream no_header ("0 lsystem 0 clear\n");
+    ASSERT_THROW(read_session(no_header), std::runtime_error);
+
+    std::istringstream unknown_order ("procgen-session 1\n0 interpretation 0 rule F jump\n");
+    ASSERT_THROW(read_session(unknown_order), std::runtime_error);
+
+    std::istringstream missing_argument ("procgen-session 1\n0 parameters 0 1 2\n");
+    ASSERT_THROW(read_session(missing_argument), std::runtime_error);
+}
+
+// Each event is timed, with the views it affects.
+TEST_F(SessionTest, replay)
+{
+    std::istringstream is ("procgen-session 1\n"
+                           "# Two views of the same LSystem.\n"
+                           "0 lsystem 0 axiom F\n"
+                           "0 lsystem 0 rule F F+F\n"
+                           "0 interpretation 0 rule F go_forward\n"
+                           "0 view 0 0 0\n"
+                           "0 view 1 0 0\n"
+                           "0 parameters 1 0 0 0 1.5 5 4\n"
+                           "1 lsystem 0 remove F\n");
+    SessionReplayer replayer (read_session(is));
+    auto latencies = replayer.replay();
+
+    ASSERT_EQ(latencies.size(), 7u);
+    ASSERT_EQ(latencies[0].views, 0u);
+    ASSERT_EQ(latencies[3].views, 1u);
+    ASSERT_EQ(latencies[5].kind, Kind::PARAMETERS);
+    ASSERT_EQ(latencies[5].views, 1u);
+    ASSERT_EQ(latencies[6].views, 2u);
+    for (const auto& latency : latencies)
+    {
+        ASSERT_LE(latency.preview, latency.duration);
+    }
+
+    // The deduplication of the views is replayed too.
+    is.clear();
+    is.seekg(0);
+    SessionReplayer deduplicating (read_session(is), true);
+    ASSERT_EQ(deduplicating.replay().size(), 7u);
+}
+
+TEST_F(SessionTest, summarize)
+{
+    std::vector<double> durations;
+    for (int i = 100; i > 0; --i)
+    {
+        durations.push_back(i);
+    }
+    auto summary = SessionReplayer::summarize(durations);
+    ASSERT_EQ(summary.count, 100u);
+    ASSERT_DOUBLE_EQ(summary.p50, 50);
+    ASSERT_DOUBLE_EQ(summary.p90, 90);
+    ASSERT_DOUBLE_EQ(summary.p99, 99);
+    ASSERT_DOUBLE_EQ(summary.max, 100);
+    ASSERT_DOUBLE_EQ(summary.total, 5050);
+
+    ASSERT_EQ(SessionReplayer::summarize({}).count, 0u);
+}
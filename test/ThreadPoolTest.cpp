@@ -0,0 +1,46 @@
+#include <atomic>
+
+#include <gtest/gtest.h>
+
+#include "ThreadPool.h"
+
+TEST(ThreadPoolTest, submit_and_wait)
+{
+    ThreadPool pool (4);
+    std::atomic<int> count { 0 };
+
+    for (int i=0; i<1000; ++i)
+    {
+        pool.submit([&count](){ ++count; });
+    }
+    pool.wait();
+
+    ASSERT_EQ(pool.size(), 4u);
+    ASSERT_EQ(count, 1000);
+}
+
+// The destructor finishes the submitted tasks.
+TEST(ThreadPoolTest, destructor)
+{
+    std::atomic<int> count { 0 };
+    {
+        ThreadPool pool (2);
+        for (int i=0; i<100; ++i)
+        {
+            pool.submit([&count](){ ++count; });
+        }
+    }
+    ASSERT_EQ(count, 100);
+}
+
+TEST(ThreadPoolTest, executor)
+{
+    ThreadPool pool (2);
+    auto ex = pool.executor();
+    std::atomic<int> count { 0 };
+
+    ex([&count](){ ++count; });
+    pool.wait();
+
+    ASSERT_EQ(count, 1);
+}
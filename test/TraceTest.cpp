@@ -0,0 +1,69 @@
+#include <sstream>
+#include <thread>
+
+#include <gtest/gtest.h>
+
+#include "Trace.h"
+
+// Count the occurrences of 'pattern' in 'str'.
+static std::size_t count(const std::string& str, const std::string& pattern)
+{
+    std::size_t n = 0;
+    for (auto pos = str.find(pattern); pos != std::string::npos; pos = str.find(pattern, pos + 1))
+    {
+        ++n;
+    }
+    return n;
+}
+
+// The spans of all the threads are collected, only during a capture.
+TEST(TraceTest, capture)
+{
+    auto& trace = Trace::global();
+    {
+        TRACE_SCOPE("test", "before");
+    }
+
+    trace.start();
+    {
+        TRACE_SCOPE_ARG("test", "outer", "n", 42);
+        TRACE_SCOPE("test", "inner");
+    }
+    std::thread thread ([]()
+                        {
+                            TRACE_SCOPE("test", "thread");
+                        });
+    thread.join();
+    trace.stop();
+    {
+        TRACE_SCOPE("test", "after");
+    }
+
+    std::ostringstream os;
+    trace.write(os);
+    auto json = os.str();
+
+    ASSERT_EQ(trace.get_size(), 3u);
+    ASSERT_EQ(count(json, "\"ph\":\"X\""), 3u);
+    ASSERT_EQ(count(json, "\"name\":\"outer\""), 1u);
+    ASSERT_EQ(count(json, "\"args\":{\"n\":42}"), 1u);
+    ASSERT_EQ(count(json, "\"name\":\"thread\""), 1u);
+    ASSERT_EQ(count(json, "\"name\":\"before\""), 0u);
+    ASSERT_EQ(count(json, "\"name\":\"after\""), 0u);
+}
+
+// The spans overflowing the buffer of a thread are dropped and counted.
+TEST(TraceTest, dropped)
+{
+    auto& trace = Trace::global();
+    trace.start();
+    for (std::size_t i = 0; i < Trace::BUFFER_CAPACITY + 10; ++i)
+    {
+        TRACE_SCOPE("test", "span");
+    }
+    trace.stop();
+    trace.collect();
+
+    ASSERT_EQ(trace.get_size(), Trace::BUFFER_CAPACITY);
+    ASSERT_EQ(trace.get_dropped(), 10u);
+}
@@ -0,0 +1,46 @@
+#include <gtest/gtest.h>
+
+#include "ViewProfile.h"
+
+using namespace procgui;
+
+// The frames are recorded in a ring buffer, the oldest being overwritten.
+TEST(ViewProfileTest, frames)
+{
+    ViewProfile profile;
+    for (std::size_t i = 0; i < ViewProfile::HISTORY + 2; ++i)
+    {
+        ViewProfile::Frame frame;
+        frame.conversion = i;
+        frame.submission = 1;
+        frame.is_strip_cached = i % 2;
+        profile.record(frame);
+    }
+
+    ASSERT_EQ(profile.get_frame_offset(), 2u);
+    ASSERT_FLOAT_EQ(profile.get_frame_times()[0], ViewProfile::HISTORY + 1);
+    ASSERT_FLOAT_EQ(profile.get_frame_times()[2], 3);
+    ASSERT_FLOAT_EQ(profile.get_max_frame_time(), ViewProfile::HISTORY + 2);
+    ASSERT_FLOAT_EQ(profile.get_last_frame().total(), ViewProfile::HISTORY + 2);
+    ASSERT_EQ(profile.get_strip_hits(), ViewProfile::HISTORY / 2 + 1);
+    ASSERT_EQ(profile.get_strip_misses(), ViewProfile::HISTORY / 2 + 1);
+}
+
+TEST(ViewProfileTest, computations)
+{
+    ViewProfile profile;
+    ViewProfile::Computation computation;
+    computation.production = 1;
+    computation.interpretation = 2;
+    computation.is_production_cached = false;
+    profile.record(computation);
+    computation.is_production_cached = true;
+    profile.record(computation);
+
+    ASSERT_FLOAT_EQ(profile.get_last_computation().total(), 3);
+    ASSERT_EQ(profile.get_production_hits(), 1u);
+    ASSERT_EQ(profile.get_production_misses(), 1u);
+
+    profile.clear();
+    ASSERT_EQ(profile.get_production_hits(), 0u);
+}
@@ -1,4 +1,5 @@
 #include <cmath>
+#include <limits>
 #include <gtest/gtest.h>
 #include "helper_math.h"
 #include "geometry.h"
@@ -6,13 +7,13 @@
 using namespace geometry;
 
 // Create a circle
-std::vector<sf::Vertex> gen_circle()
+std::vector<sf::Vector2f> gen_circle()
 {
     const float PI = 3.1415;
-    std::vector<sf::Vertex> circle;
+    std::vector<sf::Vector2f> circle;
     for(float i = 0; i <= 2*PI; i += PI/12.f)
     {
-        circle.push_back({{std::cos(i), std::sin(i)}});
+        circle.push_back({std::cos(i), std::sin(i)});
     }
     return circle;
 }
@@ -26,3 +27,207 @@ TEST(geometry, bounding_box)
 
 // compute_sub_boxes is not tested due to the bad behaviour with a low count of
 // vertices. 
+
+TEST(geometry, contains_intersects)
+{
+    // A vertical line.
+    sf::FloatRect line { 0, 0, 0, 10 };
+    sf::FloatRect box { -5, 5, 10, 10 };
+    sf::FloatRect far { 20, 20, 1, 1 };
+
+    ASSERT_TRUE(contains(line, {0, 5}));
+    ASSERT_FALSE(contains(line, {1, 5}));
+    ASSERT_TRUE(intersects(line, box));
+    ASSERT_TRUE(intersects(box, line));
+    ASSERT_FALSE(intersects(box, far));
+}
+
+// A horizontal line of 1000 positions, broken in two polylines in the
+// middle.
+Polylines gen_line()
+{
+    Polylines line;
+    for (int i = 0; i <= 1000; ++i)
+    {
+        line.positions.push_back({float(i), 0});
+    }
+    line.breaks.push_back(500);
+    return line;
+}
+
+TEST(geometry, segment_index_find_segment)
+{
+    auto line = gen_line();
+    SegmentIndex index (line);
+
+    ASSERT_EQ(index.find_segment(line, {10.5, 0.5}, 1), 10u);
+    ASSERT_EQ(index.find_segment(line, {10.5, 5}, 1), SegmentIndex::npos);
+    // There is no segment between two polylines.
+    ASSERT_EQ(index.find_segment(line, {499.5, 0}, 0.1), SegmentIndex::npos);
+}
+
+TEST(geometry, segment_index_find_ranges)
+{
+    auto line = gen_line();
+    SegmentIndex index (line);
+
+    auto all = index.find_ranges({-10, -10, 2000, 20});
+    ASSERT_EQ(all.size(), 1u);
+    ASSERT_EQ(all.at(0), SegmentIndex::range(0, 1001));
+
+    auto part = index.find_ranges({200, -1, 10, 2});
+    ASSERT_EQ(part.size(), 1u);
+    ASSERT_LE(part.at(0).first, 200u);
+    ASSERT_GE(part.at(0).second, 211u);
+    ASSERT_LT(part.at(0).second - part.at(0).first, 200u);
+
+    ASSERT_TRUE(index.find_ranges({0, 10, 10, 10}).empty());
+}
+
+TEST(geometry, simplify)
+{
+    auto line = gen_line();
+    auto simplified = simplify(line, 0.1);
+
+    // The ends of the polylines are preserved.
+    ChunkedVector<sf::Vector2f> positions { {0, 0}, {499, 0}, {500, 0}, {1000, 0} };
+    std::vector<std::size_t> breaks { 2 };
+    ASSERT_EQ(simplified.positions, positions);
+    ASSERT_EQ(simplified.breaks, breaks);
+
+    // A zigzag of amplitude 1 is kept under its amplitude.
+    Polylines zigzag;
+    for (int i = 0; i <= 100; ++i)
+    {
+        zigzag.positions.push_back({float(i), float(i % 2)});
+    }
+    ASSERT_EQ(simplify(zigzag, 0.5).positions.size(), zigzag.positions.size());
+    ASSERT_EQ(simplify(zigzag, 2).positions.size(), 2u);
+}
+
+TEST(geometry, lod_levels)
+{
+    Polylines zigzag;
+    for (int i = 0; i <= 1000; ++i)
+    {
+        zigzag.positions.push_back({float(i), float(i % 2)});
+    }
+
+    // The first step does not simplify the zigzag and is skipped.
+    const auto unlimited = std::numeric_limits<std::size_t>::max();
+    auto levels = compute_lod_levels(zigzag, 0.5, 8, unlimited);
+    ASSERT_EQ(levels.size(), 1u);
+    ASSERT_EQ(levels.at(0).paths.positions.size(), 2u);
+    ASSERT_FLOAT_EQ(levels.at(0).error, 1);
+    Polylines circle;
+    for (const auto& p : gen_circle())
+    {
+        circle.positions.push_back(p);
+    }
+    ASSERT_TRUE(compute_lod_levels(circle, 0.0001, 1, unlimited).empty());
+}
+
+// Over the memory budget, the finest levels are dropped, and the coarsest ones
+// are kept as they are.
+TEST(geometry, lod_levels_memory)
+{
+    Polylines circle;
+    for (int i = 0; i <= 10000; ++i)
+    {
+        float angle = i * 2 * math::pi / 10000;
+        circle.positions.push_back({1000 * std::cos(angle), 1000 * std::sin(angle)});
+    }
+
+    auto levels = compute_lod_levels(circle, 0.01, 10, std::numeric_limits<std::size_t>::max());
+    ASSERT_GT(levels.size(), 2u);
+    std::size_t coarsest = memory_usage(levels.back()) + memory_usage(levels.at(levels.size() - 2));
+
+    auto capped = compute_lod_levels(circle, 0.01, 10, coarsest);
+    ASSERT_EQ(capped.size(), 2u);
+    ASSERT_EQ(capped.at(0).error, levels.at(levels.size() - 2).error);
+    ASSERT_EQ(capped.at(1).paths.positions, levels.back().paths.positions);
+    ASSERT_LE(memory_usage(capped.at(0)) + memory_usage(capped.at(1)), coarsest);
+
+    ASSERT_TRUE(compute_lod_levels(circle, 0.01, 10, 0).empty());
+}
+
+TEST(geometry, append_line_strip)
+{
+    auto line = gen_line();
+    std::vector<sf::Vertex> strip;
+
+    // Two transparent vertices link the polylines.
+    append_line_strip(line, {498, 502}, sf::Color::White, strip);
+    ASSERT_EQ(strip.size(), 6u);
+    ASSERT_EQ(strip.at(1).color, sf::Color::White);
+    ASSERT_EQ(strip.at(2).position, sf::Vector2f(499, 0));
+    ASSERT_EQ(strip.at(2).color, sf::Color::Transparent);
+    ASSERT_EQ(strip.at(3).position, sf::Vector2f(500, 0));
+    ASSERT_EQ(strip.at(3).color, sf::Color::Transparent);
+    ASSERT_EQ(strip.at(4).color, sf::Color::White);
+
+    // And the next ranges.
+    append_line_strip(line, {600, 601}, sf::Color::White, strip);
+    ASSERT_EQ(strip.size(), 9u);
+    ASSERT_EQ(strip.back().position, sf::Vector2f(600, 0));
+}
+
+TEST(geometry, box_accumulator)
+{
+    ChunkedVector<sf::Vector2f> circle;
+    BoxAccumulator boxes (4);
+    for (const auto& p : gen_circle())
+    {
+        circle.push_back(p);
+        boxes.add(p);
+    }
+
+    // The boxes are the same as the ones computed separately.
+    ASSERT_EQ(boxes.get_bounding_box(), compute_bounding_box(circle));
+    ASSERT_EQ(boxes.get_bounding_box(), compute_bounding_box(gen_circle()));
+    ASSERT_EQ(boxes.get_sub_boxes(), compute_sub_boxes(circle, 7));
+
+    // The sub-boxes overlap by one position.
+    auto sub_boxes = boxes.get_sub_boxes();
+    ASSERT_EQ(sub_boxes.size(), 8u);
+    ASSERT_TRUE(contains(sub_boxes.at(0), circle[3]));
+    ASSERT_TRUE(contains(sub_boxes.at(1), circle[3]));
+}
+
+TEST(geometry, deduplicate)
+{
+    // A path going back and forth, and a second polyline retracing a part of
+    // the first one.
+    Polylines paths;
+    for (auto p : { sf::Vector2f{0, 0}, {1, 0}, {2, 0}, {1, 0}, {0.0001, 0},
+                    {1, 0}, {2, 0}, {2, 1}, {2, 1} })
+    {
+        paths.positions.push_back(p);
+    }
+    paths.breaks.push_back(5);
+
+    auto unique = deduplicate(paths, 0.01);
+
+    ChunkedVector<sf::Vector2f> positions { {0, 0}, {1, 0}, {2, 0}, {2, 1} };
+    ASSERT_EQ(unique.positions, positions);
+    ASSERT_TRUE(unique.breaks.empty());
+}
+
+// Distant segments are not merged, even 2^32 quanta apart: their keys would be
+// the same on 32 bits.
+TEST(geometry, deduplicate_far_apart)
+{
+    float far = 4294967296.f;
+    Polylines paths;
+    for (auto p : { sf::Vector2f{0, 0}, {512, 0}, {far, 0}, {far + 512, 0},
+                    {-far, -far}, {-far + 512, -far} })
+    {
+        paths.positions.push_back(p);
+    }
+    paths.breaks = {2, 4};
+
+    auto unique = deduplicate(paths, 1);
+
+    ASSERT_EQ(unique.positions, paths.positions);
+    ASSERT_EQ(unique.breaks, paths.breaks);
+}